@@ -0,0 +1,286 @@
+// -*- mode:c++; indent-tabs-mode:nil; c-basic-offset:4; -*-
+//======================================================================================
+/*
+    This file is part of DIMPLE, the Dynamic Interactive Musically PhysicaL Environment,
+
+    This code is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License("GPL") version 2
+    as published by the Free Software Foundation.  See the file LICENSE
+    for more information.
+
+    sinclair@music.mcgill.ca
+    http://www.music.mcgill.ca/~sinclair/content/dimple
+*/
+//======================================================================================
+
+#ifndef _ASSET_CACHE_H_
+#define _ASSET_CACHE_H_
+
+#include <string>
+#include <map>
+#include <set>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <stdio.h>
+#include <sys/stat.h>
+
+#include <world/CMultiMesh.h>
+#include <materials/CTexture2d.h>
+#include <materials/CNormalMap.h>
+
+#include "MeshCache.h"
+
+/*! Class for sharing the meshes and textures loaded from files by all
+ *  simulations in the process, so that each file is parsed once no
+ *  matter how many objects use it.  Assets are keyed by path and
+ *  modification time, so a file that changes on disk is loaded
+ *  again.  The cache holds assets weakly: each is freed when the last
+ *  object using it is destroyed.
+ *
+ *  Assets are immutable once loaded.  Objects share a mesh's vertex
+ *  and triangle arrays and its collision trees, but have their own
+ *  cMesh nodes carrying their transform and material.
+ *
+ *  Loading blocks the caller, and is meant to be done on a loader
+ *  thread.  Requests for an asset that another thread is loading
+ *  wait for it rather than loading it twice. */
+
+class AssetCache
+{
+  public:
+    //! A texture image and the normal map computed from it.
+    struct Texture
+    {
+        cTexture2dPtr texture;
+        cNormalMapPtr normalMap;
+    };
+
+    //! A mesh file as parsed, without collision trees.
+    struct MeshFile
+    {
+        MeshFile() : mesh(NULL) {}
+        ~MeshFile() { if (mesh) delete mesh; }
+
+        cMultiMesh *mesh;
+        //! Dimensions and diagonal of the bounding box.
+        cVector3d extent;
+        double size;
+        //! Path and modification time the file was loaded with.
+        std::string key;
+    };
+
+    //! A mesh file scaled to a size, with collision trees built.
+    struct Mesh
+    {
+        Mesh() : mesh(NULL) {}
+        ~Mesh() { if (mesh) delete mesh; }
+
+        std::shared_ptr<const MeshFile> file;
+        cMultiMesh *mesh;
+    };
+
+    static AssetCache& instance()
+    {
+        static AssetCache cache;
+        return cache;
+    }
+
+    //! Load a texture image, or return NULL if it cannot be loaded.
+    std::shared_ptr<const Texture> texture(const std::string &path)
+    {
+        std::string key;
+        if (!fileKey(path, key))
+            return std::shared_ptr<const Texture>();
+        return get(m_textures, key, path, NULL, &AssetCache::loadTexture);
+    }
+
+    //! Load a mesh file, or return NULL if it cannot be loaded.
+    std::shared_ptr<const MeshFile> meshFile(const std::string &path)
+    {
+        std::string key;
+        if (!fileKey(path, key))
+            return std::shared_ptr<const MeshFile>();
+        return get(m_meshFiles, key, path, NULL, &AssetCache::loadMeshFile);
+    }
+
+    /*! Load a mesh file scaled so that its bounding box has the given
+     *  size, or return NULL if it cannot be loaded. */
+    std::shared_ptr<const Mesh> mesh(const std::string &path,
+                                     const cVector3d &size)
+    {
+        std::string key;
+        if (!fileKey(path, key))
+            return std::shared_ptr<const Mesh>();
+        return get(m_meshes, sizeKey(key, size), path, &size,
+                   &AssetCache::loadMesh);
+    }
+
+    /*! Return the same mesh file scaled to another size if that is
+     *  already loaded, or NULL, without touching the disk. */
+    std::shared_ptr<const Mesh> findMesh(const Mesh &mesh,
+                                         const cVector3d &size)
+    {
+        std::string key(sizeKey(mesh.file->key, size));
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        MeshMap::iterator it = m_meshes.find(key);
+        if (it == m_meshes.end())
+            return std::shared_ptr<const Mesh>();
+        return it->second.lock();
+    }
+
+    /*! Add meshes to target that share the geometry and collision
+     *  trees of a cached mesh.  They must be removed by detach()
+     *  rather than deleted directly. */
+    static void attach(const Mesh &mesh, cMultiMesh *target)
+    {
+        for (int i=0; i < mesh.mesh->getNumMeshes(); i++) {
+            cMesh *source = mesh.mesh->getMesh(i);
+            cMesh *m = source->copy(true, false, false, false);
+            m->setCollisionDetector(source->getCollisionDetector());
+            target->addMesh(m);
+        }
+    }
+
+    //! Delete the meshes added to target by attach().
+    static void detach(cMultiMesh *target)
+    {
+        // The collision trees belong to the cached mesh.
+        for (int i=0; i < target->getNumMeshes(); i++)
+            target->getMesh(i)->setCollisionDetector(NULL);
+        target->deleteAllMeshes();
+    }
+
+  protected:
+    typedef std::map<std::string, std::weak_ptr<const Texture> > TextureMap;
+    typedef std::map<std::string, std::weak_ptr<const MeshFile> > MeshFileMap;
+    typedef std::map<std::string, std::weak_ptr<const Mesh> > MeshMap;
+
+    std::mutex m_mutex;
+    std::condition_variable m_loaded;
+    //! Keys of assets being loaded by some thread.
+    std::set<std::string> m_loading;
+
+    TextureMap m_textures;
+    MeshFileMap m_meshFiles;
+    MeshMap m_meshes;
+
+    //! Make a key from a path and its modification time.
+    static bool fileKey(const std::string &path, std::string &key)
+    {
+        struct stat st;
+        if (stat(path.c_str(), &st))
+            return false;
+
+        char s[32];
+        snprintf(s, 32, "\n%ld", (long)st.st_mtime);
+        key = path + s;
+        return true;
+    }
+
+    //! Make a key for a file scaled to a size.
+    static std::string sizeKey(const std::string &key, const cVector3d &size)
+    {
+        char s[96];
+        snprintf(s, 96, "\n%.9g %.9g %.9g", size.x(), size.y(), size.z());
+        return key + s;
+    }
+
+    /*! Return the asset for a key, loading it if no object holds it,
+     *  or waiting for it if another thread is loading it. */
+    template <class T>
+    std::shared_ptr<const T> get(std::map<std::string, std::weak_ptr<const T> > &assets,
+                                 const std::string &key, const std::string &path,
+                                 const cVector3d *size,
+                                 T* (AssetCache::*load)(const std::string&,
+                                                        const std::string&,
+                                                        const cVector3d*))
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (m_loading.count(key))
+            m_loaded.wait(lock);
+
+        typename std::map<std::string, std::weak_ptr<const T> >::iterator it
+            = assets.find(key);
+        if (it != assets.end()) {
+            std::shared_ptr<const T> asset = it->second.lock();
+            if (asset)
+                return asset;
+            assets.erase(it);
+        }
+
+        // Failures are not cached, so a missing file may be retried.
+        m_loading.insert(key);
+        lock.unlock();
+        std::shared_ptr<const T> asset((this->*load)(path, key, size));
+        lock.lock();
+        m_loading.erase(key);
+        if (asset)
+            assets[key] = asset;
+        m_loaded.notify_all();
+        return asset;
+    }
+
+    Texture *loadTexture(const std::string &path, const std::string&,
+                         const cVector3d*)
+    {
+        cTexture2dPtr texture = cTexture2d::create();
+        if (!texture->loadFromFile(path))
+            return NULL;
+
+        Texture *t = new Texture;
+        t->texture = texture;
+        t->normalMap = cNormalMap::create();
+        t->normalMap->createMap(texture);
+        return t;
+    }
+
+    MeshFile *loadMeshFile(const std::string &path, const std::string &key,
+                           const cVector3d*)
+    {
+        MeshFile *f = new MeshFile;
+        f->key = key;
+        f->mesh = new cMultiMesh();
+
+        // Parse the file only if its binary cache is missing or stale.
+        if (!MeshCache::load(path, f->mesh)) {
+            f->mesh->deleteAllMeshes();
+            if (!f->mesh->loadFromFile(path)) {
+                delete f;
+                return NULL;
+            }
+            MeshCache::save(path, f->mesh);
+        }
+
+        f->mesh->computeBoundaryBox(true);
+        f->extent = f->mesh->getBoundaryMax() - f->mesh->getBoundaryMin();
+        f->size = f->extent.length();
+        return f;
+    }
+
+    Mesh *loadMesh(const std::string &path, const std::string&,
+                   const cVector3d *size)
+    {
+        std::shared_ptr<const MeshFile> file = meshFile(path);
+        if (!file)
+            return NULL;
+
+        Mesh *m = new Mesh;
+        m->file = file;
+        m->mesh = file->mesh->copy(true, false, true, false);
+
+        // Vertices are scaled about the file's origin so that the
+        // bounding box matches the size.
+        const cVector3d &extent = file->extent;
+        m->mesh->scaleXYZ(extent.x() > 0 ? size->x() / extent.x() : 1,
+                          extent.y() > 0 ? size->y() / extent.y() : 1,
+                          extent.z() > 0 ? size->z() / extent.z() : 1);
+
+        /* setup collision detector */
+        m->mesh->createAABBCollisionDetector(0.01 /* TODO make variable OSC-accessible? */);
+        return m;
+    }
+};
+
+#endif // _ASSET_CACHE_H_
@@ -0,0 +1,179 @@
+// -*- mode:c++; indent-tabs-mode:nil; c-basic-offset:4; -*-
+//======================================================================================
+/*
+    This file is part of DIMPLE, the Dynamic Interactive Musically PhysicaL Environment,
+
+    This code is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License("GPL") version 2
+    as published by the Free Software Foundation.  See the file LICENSE
+    for more information.
+
+    sinclair@music.mcgill.ca
+    http://www.music.mcgill.ca/~sinclair/content/dimple
+*/
+//======================================================================================
+
+#ifndef _ASSET_LOADER_H_
+#define _ASSET_LOADER_H_
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+
+/*! Class for loading files on a background thread, so that a
+ *  simulation's own thread never waits on the disk.  Each job is
+ *  loaded in the background by load(), then handed back to the
+ *  simulation, which calls finish() between steps to swap the result
+ *  into its object.
+ *
+ *  Jobs are tagged with an owner; cancelling an owner, for example
+ *  when its object is destroyed, guarantees that finish() is never
+ *  called for its jobs.  The thread is started by start(), or else
+ *  by the first job. */
+
+class AssetLoader
+{
+  public:
+    class Job
+    {
+      public:
+        Job(const void *owner) : m_owner(owner), m_bCancelled(false) {}
+        virtual ~Job() {}
+
+        //! Load the asset (loader thread).
+        virtual void load() = 0;
+        //! Use the loaded asset (simulation thread).
+        virtual void finish() = 0;
+
+      protected:
+        const void *m_owner;
+        bool m_bCancelled;
+        friend class AssetLoader;
+    };
+
+    AssetLoader() : m_bDone(false), m_current(NULL) {}
+
+    ~AssetLoader()
+    {
+        if (m_thread.joinable()) {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_bDone = true;
+            }
+            m_cond.notify_all();
+            m_thread.join();
+        }
+
+        std::deque<Job*>::iterator it;
+        for (it=m_pending.begin(); it!=m_pending.end(); it++)
+            delete *it;
+        for (it=m_loaded.begin(); it!=m_loaded.end(); it++)
+            delete *it;
+    }
+
+    /*! Start the loader thread.  It inherits the scheduling and CPU
+     *  affinity of the calling thread, so it should be started before
+     *  a simulation's real-time options are applied, otherwise it
+     *  would compete with the simulation loop. */
+    void start()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (!m_thread.joinable())
+            m_thread = std::thread(run, this);
+    }
+
+    //! Queue a job to be loaded.  The loader takes ownership of it.
+    void submit(Job *job)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (!m_thread.joinable())
+            m_thread = std::thread(run, this);
+        m_pending.push_back(job);
+        m_cond.notify_all();
+    }
+
+    //! Cancel all jobs of an owner that have not yet finished.
+    void cancel(const void *owner)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        std::deque<Job*>::iterator it;
+        for (it=m_pending.begin(); it!=m_pending.end(); it++)
+            if ((*it)->m_owner == owner)
+                (*it)->m_bCancelled = true;
+        for (it=m_loaded.begin(); it!=m_loaded.end(); it++)
+            if ((*it)->m_owner == owner)
+                (*it)->m_bCancelled = true;
+        if (m_current && m_current->m_owner == owner)
+            m_current->m_bCancelled = true;
+    }
+
+    /*! Finish all jobs that have been loaded and delete them.  Must
+     *  be called from the simulation thread, between steps.  Returns
+     *  the number of jobs finished. */
+    int finish()
+    {
+        std::vector<Job*> loaded;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if (m_loaded.empty())
+                return 0;
+            loaded.assign(m_loaded.begin(), m_loaded.end());
+            m_loaded.clear();
+        }
+
+        // cancel() is only called from this thread, so the flags
+        // cannot change while the lock is released.
+        int count = 0;
+        std::vector<Job*>::iterator it;
+        for (it=loaded.begin(); it!=loaded.end(); it++) {
+            if (!(*it)->m_bCancelled) {
+                (*it)->finish();
+                count++;
+            }
+            delete *it;
+        }
+        return count;
+    }
+
+  protected:
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    bool m_bDone;
+
+    //! Jobs waiting to be loaded, and loaded jobs waiting to finish.
+    std::deque<Job*> m_pending;
+    std::deque<Job*> m_loaded;
+    //! The job being loaded, if any.
+    Job *m_current;
+
+    static void run(AssetLoader *me)
+    {
+        std::unique_lock<std::mutex> lock(me->m_mutex);
+        while (true)
+        {
+            while (!me->m_bDone && me->m_pending.empty())
+                me->m_cond.wait(lock);
+            if (me->m_bDone)
+                break;
+
+            Job *job = me->m_pending.front();
+            me->m_pending.pop_front();
+
+            // Cancelled jobs are still passed back to be deleted in
+            // the simulation thread.
+            if (!job->m_bCancelled) {
+                me->m_current = job;
+                lock.unlock();
+                job->load();
+                lock.lock();
+                me->m_current = NULL;
+            }
+            me->m_loaded.push_back(job);
+        }
+    }
+};
+
+#endif // _ASSET_LOADER_H_
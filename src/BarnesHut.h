@@ -0,0 +1,253 @@
+// -*- mode:c++; indent-tabs-mode:nil; c-basic-offset:4; -*-
+//======================================================================================
+/*
+    This file is part of DIMPLE, the Dynamic Interactive Musically PhysicaL Environment,
+
+    This code is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License("GPL") version 2
+    as published by the Free Software Foundation.  See the file LICENSE
+    for more information.
+
+    sinclair@music.mcgill.ca
+    http://www.music.mcgill.ca/~sinclair/content/dimple
+*/
+//======================================================================================
+
+#ifndef _BARNES_HUT_H_
+#define _BARNES_HUT_H_
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+/*! Class for computing the mutual attraction of a set of point
+ *  charges in O(n log n) time.  The points are sorted into an octree
+ *  whose cells record their total charge and its center.  The
+ *  attraction on each point is then summed from the cells which are
+ *  small compared to their distance, treating each as a single
+ *  charge, and opening the others.  Cells of a few points are summed
+ *  directly.
+ *
+ *  The attraction between charges qi and qj at distance r is
+ *  qi*qj/(r^2 + e^2), where e is a softening distance which keeps
+ *  the force finite for points passing close to each other. */
+
+class BarnesHut
+{
+  public:
+    //! Maximum number of points in a cell that is not split.
+    enum { LEAF_SIZE = 8, MAX_DEPTH = 32 };
+
+    BarnesHut() : m_theta(0.5), m_softening(0.01) {}
+
+    /*! Set the opening angle: cells whose size divided by their
+     *  distance is less than theta are treated as a single charge.
+     *  Zero sums every pair exactly. */
+    void setTheta(double theta) { m_theta = theta; }
+    void setSoftening(double e) { m_softening = e; }
+
+    /*! Compute the attraction on each of count points given as
+     *  consecutive x, y, z values with the given charges, and write
+     *  it to force, 3 values per point.  Points with a charge of
+     *  zero or less neither attract nor are attracted. */
+    void compute(const double *points, const double *charges, int count,
+                 double *force)
+    {
+        std::fill(force, force + count*3, 0.0);
+
+        m_points = points;
+        m_charges = charges;
+        m_nodes.clear();
+        m_order.clear();
+        for (int i=0; i<count; i++)
+            if (charges[i] > 0)
+                m_order.push_back(i);
+        if (m_order.size() < 2)
+            return;
+
+        // The root cell is the bounding cube of all points.
+        double lo[3], hi[3];
+        for (int k=0; k<3; k++)
+            lo[k] = hi[k] = point(m_order[0])[k];
+        for (unsigned int n=1; n<m_order.size(); n++)
+            for (int k=0; k<3; k++) {
+                lo[k] = std::min(lo[k], point(m_order[n])[k]);
+                hi[k] = std::max(hi[k], point(m_order[n])[k]);
+            }
+        double half = 0;
+        Node root;
+        for (int k=0; k<3; k++) {
+            root.center[k] = (lo[k] + hi[k]) / 2;
+            half = std::max(half, (hi[k] - lo[k]) / 2);
+        }
+        root.half = half;
+        root.begin = 0;
+        root.end = m_order.size();
+
+        m_nodes.reserve(m_order.size());
+        m_nodes.push_back(root);
+        m_scratch.resize(m_order.size());
+        build(0, 0);
+
+        double theta2 = m_theta * m_theta;
+        double e2 = m_softening * m_softening;
+        for (unsigned int n=0; n<m_order.size(); n++) {
+            int i = m_order[n];
+            double f[3] = { 0, 0, 0 };
+            accumulate(i, theta2, e2, f);
+            for (int k=0; k<3; k++)
+                force[i*3+k] = f[k] * charges[i];
+        }
+    }
+
+  protected:
+    struct Node
+    {
+        double center[3];
+        double half;
+        double charge;
+        double com[3];   //!< Center of charge
+        int begin, end;
+        int child;   //!< Index of the first of 8 children, or -1
+    };
+
+    const double *m_points;
+    const double *m_charges;
+    double m_theta;
+    double m_softening;
+    std::vector<Node> m_nodes;
+    std::vector<int> m_order;
+    std::vector<int> m_scratch;
+    std::vector<int> m_stack;
+
+    const double *point(int i) { return &m_points[i*3]; }
+
+    int octant(const Node &node, int i)
+    {
+        const double *p = point(i);
+        return (p[0] > node.center[0] ? 1 : 0)
+             | (p[1] > node.center[1] ? 2 : 0)
+             | (p[2] > node.center[2] ? 4 : 0);
+    }
+
+    //! Split a cell into octants and sum its charge, recursively.
+    void build(int index, int depth)
+    {
+        int begin = m_nodes[index].begin, end = m_nodes[index].end;
+        m_nodes[index].child = -1;
+
+        if (end - begin > LEAF_SIZE && depth < MAX_DEPTH)
+        {
+            // Sort the cell's points by octant.
+            int counts[9] = { 0 };
+            for (int n=begin; n<end; n++)
+                counts[octant(m_nodes[index], m_order[n]) + 1]++;
+            for (int o=0; o<8; o++)
+                counts[o+1] += counts[o];
+            int next[8];
+            for (int o=0; o<8; o++)
+                next[o] = begin + counts[o];
+            for (int n=begin; n<end; n++)
+                m_scratch[next[octant(m_nodes[index], m_order[n])]++]
+                    = m_order[n];
+            std::copy(m_scratch.begin() + begin, m_scratch.begin() + end,
+                      m_order.begin() + begin);
+
+            int child = m_nodes.size();
+            m_nodes[index].child = child;
+            for (int o=0; o<8; o++) {
+                Node c;
+                const Node &parent = m_nodes[index];
+                c.half = parent.half / 2;
+                for (int k=0; k<3; k++)
+                    c.center[k] = parent.center[k]
+                        + ((o >> k) & 1 ? c.half : -c.half);
+                c.begin = begin + counts[o];
+                c.end = begin + counts[o+1];
+                m_nodes.push_back(c);
+            }
+
+            double charge = 0, com[3] = { 0, 0, 0 };
+            for (int o=0; o<8; o++) {
+                build(child + o, depth + 1);
+                const Node &c = m_nodes[child + o];
+                charge += c.charge;
+                for (int k=0; k<3; k++)
+                    com[k] += c.com[k] * c.charge;
+            }
+            Node &node = m_nodes[index];
+            node.charge = charge;
+            for (int k=0; k<3; k++)
+                node.com[k] = com[k] / charge;
+            return;
+        }
+
+        double charge = 0, com[3] = { 0, 0, 0 };
+        for (int n=begin; n<end; n++) {
+            int i = m_order[n];
+            charge += m_charges[i];
+            for (int k=0; k<3; k++)
+                com[k] += point(i)[k] * m_charges[i];
+        }
+        Node &node = m_nodes[index];
+        node.charge = charge;
+        for (int k=0; k<3; k++)
+            node.com[k] = charge > 0 ? com[k] / charge : node.center[k];
+    }
+
+    //! Add the attraction towards a charge at to on a unit charge at
+    //! from to f.
+    void attract(const double *from, const double *to, double charge,
+                 double e2, double *f)
+    {
+        double d[3] = { to[0]-from[0], to[1]-from[1], to[2]-from[2] };
+        double r2 = d[0]*d[0] + d[1]*d[1] + d[2]*d[2] + e2;
+        if (r2 <= 0)
+            return;
+        double s = charge / (r2 * sqrt(r2));
+        f[0] += d[0]*s;
+        f[1] += d[1]*s;
+        f[2] += d[2]*s;
+    }
+
+    //! Sum the attraction on point i from all cells.
+    void accumulate(int i, double theta2, double e2, double *f)
+    {
+        const double *p = point(i);
+        m_stack.clear();
+        m_stack.push_back(0);
+        while (!m_stack.empty())
+        {
+            const Node &node = m_nodes[m_stack.back()];
+            m_stack.pop_back();
+            if (node.begin == node.end)
+                continue;
+
+            if (node.child < 0) {
+                for (int n=node.begin; n<node.end; n++) {
+                    int j = m_order[n];
+                    if (j != i)
+                        attract(p, point(j), m_charges[j], e2, f);
+                }
+                continue;
+            }
+
+            // A cell containing the point is always opened, so that
+            // a point never attracts itself.
+            bool inside = fabs(p[0]-node.center[0]) <= node.half
+                && fabs(p[1]-node.center[1]) <= node.half
+                && fabs(p[2]-node.center[2]) <= node.half;
+            double d[3] = { node.com[0]-p[0], node.com[1]-p[1],
+                            node.com[2]-p[2] };
+            double r2 = d[0]*d[0] + d[1]*d[1] + d[2]*d[2];
+            double size = node.half * 2;
+            if (!inside && size*size < theta2 * r2)
+                attract(p, node.com, node.charge, e2, f);
+            else
+                for (int o=0; o<8; o++)
+                    m_stack.push_back(node.child + o);
+        }
+    }
+};
+
+#endif // _BARNES_HUT_H_
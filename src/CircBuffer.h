@@ -18,6 +18,7 @@
 
 #include <string.h>
 #include <math.h>
+#include <atomic>
 #ifdef WIN32
 #include <float.h>
 #define ilogb(a) ((int)_logb((double)a))
@@ -26,7 +27,9 @@
 /*! Class for writing to a circular buffer from one thread and reading
  *  from another without requiring locking. This code is adapted from
  *  the Linux kernel's kfifo.c.  It may only be called from one reader
- *  and one writer. */
+ *  and one writer.  Each side publishes its position with a release
+ *  store after copying the data, and reads the other's with an
+ *  acquire load, in place of kfifo's memory barriers. */
 
 class CircBufferNoLock
 {
@@ -38,12 +41,12 @@ class CircBufferNoLock
         m_size = 1 << (ilogb(size-1)+1); /* Ensure size is a power of two */
         m_readpos = 0;
         m_writepos = 0;
-        m_buffer = new unsigned char[size];
-        memset(m_buffer, 0, size);
+        m_buffer = new unsigned char[m_size];
+        memset(m_buffer, 0, m_size);
     }
     ~CircBufferNoLock() {
         if (m_buffer)
-            delete m_buffer;
+            delete[] m_buffer;
     }
 
     /*! Write bytes to the buffer. Return true if successful. */
@@ -51,20 +54,21 @@ class CircBufferNoLock
                      unsigned int len)
     {
         unsigned int left, rightside;
+        unsigned int writepos = m_writepos.load(std::memory_order_relaxed);
         
-        left = m_size - m_writepos + m_readpos;
+        left = m_size - writepos + m_readpos.load(std::memory_order_acquire);
         if (left < len)
             return false;
 
         /* first put the data starting from m_writepos to buffer end */
-        rightside = m_size - (m_writepos & (m_size - 1));
+        rightside = m_size - (writepos & (m_size - 1));
         rightside = (len<rightside) ? len : rightside;
-        memcpy(m_buffer + (m_writepos & (m_size - 1)), data, rightside);
+        memcpy(m_buffer + (writepos & (m_size - 1)), data, rightside);
         
         /* then put the rest (if any) at the beginning of the buffer */
         memcpy(m_buffer, data + rightside, len - rightside);
         
-        m_writepos += len;
+        m_writepos.store(writepos + len, std::memory_order_release);
         
         return true;
     }
@@ -74,20 +78,21 @@ class CircBufferNoLock
                     unsigned int len)
     {
         unsigned int left, rightside;
+        unsigned int readpos = m_readpos.load(std::memory_order_relaxed);
 
-        left = m_writepos - m_readpos;
+        left = m_writepos.load(std::memory_order_acquire) - readpos;
         if (left < len)
             return false;
         
         /* first get the data from m_readpos until the end of the data */
-        rightside = m_size - (m_readpos & (m_size - 1));
+        rightside = m_size - (readpos & (m_size - 1));
         rightside = (len<rightside) ? len : rightside;
-        memcpy(data, m_buffer + (m_readpos & (m_size - 1)), rightside);
+        memcpy(data, m_buffer + (readpos & (m_size - 1)), rightside);
         
         /* then get the rest (if any) from the beginning of the data */
         memcpy(data + rightside, m_buffer, len - rightside);
         
-        m_readpos += len;
+        m_readpos.store(readpos + len, std::memory_order_release);
         
         return true;
     }
@@ -97,8 +102,8 @@ class CircBufferNoLock
 
   protected:
     unsigned int m_size;
-    unsigned int m_readpos;
-    unsigned int m_writepos;
+    std::atomic<unsigned int> m_readpos;
+    std::atomic<unsigned int> m_writepos;
     unsigned char* m_buffer;
 };
 
@@ -0,0 +1,268 @@
+// -*- mode:c++; indent-tabs-mode:nil; c-basic-offset:4; -*-
+//======================================================================================
+/*
+    This file is part of DIMPLE, the Dynamic Interactive Musically PhysicaL Environment,
+
+    This code is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License("GPL") version 2
+    as published by the Free Software Foundation.  See the file LICENSE
+    for more information.
+
+    sinclair@music.mcgill.ca
+    http://www.music.mcgill.ca/~sinclair/content/dimple
+*/
+//======================================================================================
+
+#ifndef _CONVEX_HULL_H_
+#define _CONVEX_HULL_H_
+
+#include <vector>
+#include <set>
+#include <algorithm>
+#include <utility>
+#include <cmath>
+
+/*! Class for computing the convex hull of a point cloud, built
+ *  incrementally by adding one point at a time and replacing the
+ *  faces it can see.  The result is a set of triangles, wound
+ *  counter-clockwise when seen from outside, indexing into the list
+ *  of points on the hull.
+ *
+ *  Large clouds are first reduced to their furthest points along a
+ *  fixed set of directions, so the hull may be slightly smaller than
+ *  the exact one but has a bounded number of vertices. */
+
+class ConvexHull
+{
+  public:
+    /*! Compute the hull of count points given as consecutive x, y, z
+     *  values, using at most about maxPoints of them.  Return false
+     *  if the points do not span a volume. */
+    bool compute(const float *points, int count, int maxPoints=256)
+    {
+        m_vertices.clear();
+        m_triangles.clear();
+        m_points = points;
+        m_faces.clear();
+        m_dead = 0;
+
+        if (count < 4)
+            return false;
+
+        // Tolerance relative to the size of the cloud.
+        double lo[3], hi[3];
+        for (int k=0; k<3; k++)
+            lo[k] = hi[k] = points[k];
+        for (int i=1; i<count; i++)
+            for (int k=0; k<3; k++) {
+                lo[k] = std::min(lo[k], (double)points[i*3+k]);
+                hi[k] = std::max(hi[k], (double)points[i*3+k]);
+            }
+        m_epsilon = 1e-7 * (hi[0]-lo[0] + hi[1]-lo[1] + hi[2]-lo[2]);
+
+        std::vector<bool> used(count, count <= maxPoints);
+        if (count > maxPoints)
+            selectSupport(count, maxPoints, used);
+
+        int simplex[4];
+        if (!findSimplex(count, simplex))
+            return false;
+
+        // Start with a tetrahedron, each face oriented away from the
+        // opposite vertex.
+        const int tet[4][4] = { {0,1,2,3}, {0,3,1,2}, {0,2,3,1}, {1,3,2,0} };
+        for (int f=0; f<4; f++) {
+            addFace(simplex[tet[f][0]], simplex[tet[f][1]],
+                    simplex[tet[f][2]]);
+            if (distance(m_faces.back(), simplex[tet[f][3]]) > 0)
+                flip(m_faces.back());
+        }
+
+        for (int i=0; i<count; i++) {
+            if (!used[i] || i==simplex[0] || i==simplex[1]
+                || i==simplex[2] || i==simplex[3])
+                continue;
+            addPoint(i);
+        }
+
+        // Keep only live faces and renumber their vertices.
+        std::vector<int> index(count, -1);
+        std::vector<Face>::iterator it;
+        for (it=m_faces.begin(); it!=m_faces.end(); it++) {
+            if (it->dead)
+                continue;
+            for (int k=0; k<3; k++) {
+                int v = it->v[k];
+                if (index[v] < 0) {
+                    index[v] = m_vertices.size();
+                    m_vertices.push_back(v);
+                }
+                m_triangles.push_back(index[v]);
+            }
+        }
+        m_faces.clear();
+
+        return true;
+    }
+
+    //! Indexes into the input of the points lying on the hull.
+    const std::vector<int>& vertices() { return m_vertices; }
+
+    //! Three indexes into vertices() per triangle.
+    const std::vector<int>& triangles() { return m_triangles; }
+
+  protected:
+    struct Face
+    {
+        int v[3];
+        double n[3];
+        double d;
+        bool dead;
+    };
+
+    const float *m_points;
+    double m_epsilon;
+    std::vector<Face> m_faces;
+    int m_dead;
+    std::vector<int> m_vertices;
+    std::vector<int> m_triangles;
+
+    const float *point(int i) { return &m_points[i*3]; }
+
+    double distance(const Face &f, int i)
+    {
+        const float *p = point(i);
+        return f.n[0]*p[0] + f.n[1]*p[1] + f.n[2]*p[2] - f.d;
+    }
+
+    void plane(Face &f)
+    {
+        const float *a = point(f.v[0]), *b = point(f.v[1]), *c = point(f.v[2]);
+        double u[3] = { b[0]-a[0], b[1]-a[1], b[2]-a[2] };
+        double w[3] = { c[0]-a[0], c[1]-a[1], c[2]-a[2] };
+        f.n[0] = u[1]*w[2] - u[2]*w[1];
+        f.n[1] = u[2]*w[0] - u[0]*w[2];
+        f.n[2] = u[0]*w[1] - u[1]*w[0];
+        double len = sqrt(f.n[0]*f.n[0] + f.n[1]*f.n[1] + f.n[2]*f.n[2]);
+        if (len > 0)
+            for (int k=0; k<3; k++)
+                f.n[k] /= len;
+        f.d = f.n[0]*a[0] + f.n[1]*a[1] + f.n[2]*a[2];
+    }
+
+    void addFace(int a, int b, int c)
+    {
+        Face f;
+        f.v[0] = a; f.v[1] = b; f.v[2] = c;
+        f.dead = false;
+        plane(f);
+        m_faces.push_back(f);
+    }
+
+    static bool isDead(const Face &f) { return f.dead; }
+
+    void flip(Face &f)
+    {
+        std::swap(f.v[1], f.v[2]);
+        plane(f);
+    }
+
+    /*! Mark the furthest point along each of a set of directions
+     *  spread evenly over the sphere. */
+    void selectSupport(int count, int directions, std::vector<bool> &used)
+    {
+        const double golden = M_PI * (3 - sqrt(5.0));
+        for (int j=0; j<directions; j++) {
+            double z = 1 - (2*j + 1.0) / directions;
+            double r = sqrt(1 - z*z);
+            double dir[3] = { r*cos(golden*j), r*sin(golden*j), z };
+
+            int best = 0;
+            double bestDot = -HUGE_VAL;
+            for (int i=0; i<count; i++) {
+                const float *p = point(i);
+                double d = dir[0]*p[0] + dir[1]*p[1] + dir[2]*p[2];
+                if (d > bestDot) { bestDot = d; best = i; }
+            }
+            used[best] = true;
+        }
+    }
+
+    //! Find four points spanning a volume.
+    bool findSimplex(int count, int simplex[4])
+    {
+        // The two points furthest apart along X.
+        int a = 0, b = 0;
+        for (int i=1; i<count; i++) {
+            if (point(i)[0] < point(a)[0]) a = i;
+            if (point(i)[0] > point(b)[0]) b = i;
+        }
+        if (a == b)
+            return false;
+
+        // The point furthest from the line ab.
+        const float *pa = point(a), *pb = point(b);
+        double ab[3] = { pb[0]-pa[0], pb[1]-pa[1], pb[2]-pa[2] };
+        int c = -1;
+        double best = m_epsilon*m_epsilon;
+        for (int i=0; i<count; i++) {
+            const float *p = point(i);
+            double ap[3] = { p[0]-pa[0], p[1]-pa[1], p[2]-pa[2] };
+            double x[3] = { ab[1]*ap[2] - ab[2]*ap[1],
+                            ab[2]*ap[0] - ab[0]*ap[2],
+                            ab[0]*ap[1] - ab[1]*ap[0] };
+            double d = x[0]*x[0] + x[1]*x[1] + x[2]*x[2];
+            if (d > best) { best = d; c = i; }
+        }
+        if (c < 0)
+            return false;
+
+        // The point furthest from the plane abc.
+        Face f;
+        f.v[0] = a; f.v[1] = b; f.v[2] = c;
+        plane(f);
+        int d = -1;
+        best = m_epsilon;
+        for (int i=0; i<count; i++) {
+            double dist = fabs(distance(f, i));
+            if (dist > best) { best = dist; d = i; }
+        }
+        if (d < 0)
+            return false;
+
+        simplex[0] = a; simplex[1] = b; simplex[2] = c; simplex[3] = d;
+        return true;
+    }
+
+    //! Replace the faces visible from point i with a cone to it.
+    void addPoint(int i)
+    {
+        // Drop replaced faces once they outnumber the live ones.
+        if (m_dead*2 > (int)m_faces.size()) {
+            m_faces.erase(std::remove_if(m_faces.begin(), m_faces.end(),
+                                         isDead), m_faces.end());
+            m_dead = 0;
+        }
+
+        std::set< std::pair<int,int> > edges;
+        int faces = m_faces.size();
+        for (int f=0; f<faces; f++) {
+            if (m_faces[f].dead || distance(m_faces[f], i) <= m_epsilon)
+                continue;
+            m_faces[f].dead = true;
+            m_dead++;
+            for (int k=0; k<3; k++)
+                edges.insert(std::make_pair(m_faces[f].v[k],
+                                            m_faces[f].v[(k+1)%3]));
+        }
+
+        // Edges not shared by two visible faces form the horizon.
+        std::set< std::pair<int,int> >::iterator it;
+        for (it=edges.begin(); it!=edges.end(); it++)
+            if (edges.find(std::make_pair(it->second, it->first))
+                == edges.end())
+                addFace(it->first, it->second, i);
+    }
+};
+
+#endif // _CONVEX_HULL_H_
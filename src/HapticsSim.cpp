@@ -59,22 +59,87 @@ bool HapticsMeshFactory::create(const char *name, const char *filename,
     return true;
 }
 
+bool HapticsPlaneFactory::create(const char *name, float x, float y, float z)
+{
+    OscPlaneCHAI *obj = new OscPlaneCHAI(simulation()->world(),
+                                         name, m_parent);
+
+    if (!(obj && simulation()->add_object(*obj)))
+            return false;
+
+    obj->m_position.setValue(x, y, z);
+
+    return true;
+}
+
+bool HapticsCapsuleFactory::create(const char *name, float x, float y, float z)
+{
+    OscCapsuleCHAI *obj = new OscCapsuleCHAI(simulation()->world(),
+                                             name, m_parent);
+
+    if (!(obj && simulation()->add_object(*obj)))
+            return false;
+
+    obj->m_position.setValue(x, y, z);
+
+    return true;
+}
+
+bool HapticsCylinderFactory::create(const char *name, float x, float y, float z)
+{
+    OscCylinderCHAI *obj = new OscCylinderCHAI(simulation()->world(),
+                                               name, m_parent);
+
+    if (!(obj && simulation()->add_object(*obj)))
+            return false;
+
+    obj->m_position.setValue(x, y, z);
+
+    return true;
+}
+
+bool HapticsHeightfieldFactory::create(const char *name, int columns, int rows,
+                                       float x, float y, float z)
+{
+    OscHeightfieldCHAI *obj = new OscHeightfieldCHAI(simulation()->world(),
+                                                     name, columns, rows,
+                                                     m_parent);
+
+    if (!(obj && simulation()->add_object(*obj)))
+            return false;
+
+    obj->m_position.setValue(x, y, z);
+
+    return true;
+}
+
 
 /****** HapticsSim ******/
 
 HapticsSim::HapticsSim(const char *port)
     : Simulation(port, ST_HAPTICS),
-      m_workspaceScale(1,1,1)
+      m_workspaceScale(1,1,1),
+      m_hapticIndex(0.05),
+      m_outbox(1024)
 {
     m_pPrismFactory = new HapticsPrismFactory(this);
     m_pSphereFactory = new HapticsSphereFactory(this);
     m_pMeshFactory = new HapticsMeshFactory(this);
+    m_pPlaneFactory = new HapticsPlaneFactory(this);
+    m_pCapsuleFactory = new HapticsCapsuleFactory(this);
+    m_pCylinderFactory = new HapticsCylinderFactory(this);
+    m_pHeightfieldFactory = new HapticsHeightfieldFactory(this);
 
     m_workspace_size.setValue(2,2,2);
     m_workspace_center.setValue(0,0,0);
 
     m_fTimestep = haptics_timestep_ms/1000.0;
     printf("CHAI timestep: %f\n", m_fTimestep);
+
+    // Cull once per physics step, since objects move at that rate.
+    m_cullInterval = std::max(1, (int)(physics_timestep_ms/haptics_timestep_ms));
+    m_cullCounter = 0;
+    m_cullPass = 0;
 }
 
 HapticsSim::~HapticsSim()
@@ -95,6 +160,10 @@ void HapticsSim::initialize()
     // create an OscObject to point to the cursor
     m_cursor = new OscCursorCHAI(m_chaiWorld, "cursor", this);
 
+    // Started before the thread options are applied, so that it
+    // keeps normal priority.
+    m_outbox.start(timestep());
+
     // special case:
     // we know that the libnifalcon driver times itself, so don't
     // allow the Simulation to time itself before each step().
@@ -200,7 +269,7 @@ void HapticsSim::updateWorkspace(cVector3d &pos, cVector3d &vel)
 
 void HapticsSim::step()
 {
-    m_chaiWorld->computeGlobalPositions(true);
+    updateTransforms();
 
     cToolCursor *cursor = m_cursor->object();
     cursor->updateFromDevice();
@@ -218,6 +287,11 @@ void HapticsSim::step()
     m_cursor->m_velocity.setValue(vel, false);
     m_cursor->m_accel.setValue(acc, false);
 
+    if (++m_cullCounter >= m_cullInterval) {
+        m_cullCounter = 0;
+        cullObjects();
+    }
+
     if (m_pGrabbedObject) {
         cursor->setDeviceGlobalForce(0,0,0);
         m_cursor->addCursorGrabbedForce(m_pGrabbedObject);
@@ -262,42 +336,85 @@ void HapticsSim::step()
                                                         inter.m_localSurfacePos);
         }
 
-        sendtotype(Simulation::ST_VISUAL, true,
-                   "/world/cursor/position","fff",
-                   pos.x(), pos.y(), pos.z());
+        post(Simulation::ST_VISUAL, true,
+             "/world/cursor/position","fff",
+             pos.x(), pos.y(), pos.z());
     }
 
     if (m_pGrabbedObject)
     {
         pos = cursor->getDeviceGlobalPos();
-        sendtotype(Simulation::ST_PHYSICS, true,
-                   "/world/cursor/position","fff",
-                   pos.x(), pos.y(), pos.z());
+        post(Simulation::ST_PHYSICS, true,
+             "/world/cursor/position","fff",
+             pos.x(), pos.y(), pos.z());
     }
 
     findContactObject();
 
     if (m_pContactObject) {
-        sendtotype(Simulation::ST_PHYSICS, true,
-                   (m_pContactObject->path()+"/push").c_str(), "ffffff",
-                   -m_lastForce.x(),
-                   -m_lastForce.y(),
-                   -m_lastForce.z(),
-                   m_lastContactPoint.x(),
-                   m_lastContactPoint.y(),
-                   m_lastContactPoint.z());
-
-        bool co1 = m_pContactObject->collidedWith(m_cursor, m_counter);
-        bool co2 = m_cursor->collidedWith(m_pContactObject, m_counter);
+        // One longer than the outbox allows, so it drops long paths.
+        char path[Outbox::MAX_PATH+1];
+        snprintf(path, sizeof(path), "%s/push", m_pContactObject->c_path());
+        post(Simulation::ST_PHYSICS, true, path, "ffffff",
+             -m_lastForce.x(),
+             -m_lastForce.y(),
+             -m_lastForce.z(),
+             m_lastContactPoint.x(),
+             m_lastContactPoint.y(),
+             m_lastContactPoint.z());
+
+        bool co1 = m_pContactObject->newCollision(m_cursor, m_counter);
+        bool co2 = m_cursor->newCollision(m_pContactObject, m_counter);
+        if (co1)
+            postCollision(m_pContactObject, m_cursor);
+        if (co2)
+            postCollision(m_cursor, m_pContactObject);
         if ( (co1 || co2) && m_collide.m_value ) {
-            lo_send(address_send, "/world/collide", "ssf",
-                    m_pContactObject->c_name(), m_cursor->c_name(),
-                    (double)(m_pContactObject->m_velocity
-                             - m_cursor->m_velocity).length());
+            post(0, false, "/world/collide", "ssf",
+                 m_pContactObject->c_name(), m_cursor->c_name(),
+                 (double)(m_pContactObject->m_velocity
+                          - m_cursor->m_velocity).length());
         }
     }
 }
 
+void HapticsSim::post(int type, bool throttle, const char *path,
+                      const char *types, ...)
+{
+    va_list ap;
+    if (!type) {
+        va_start(ap, types);
+        m_outbox.write(NULL, throttle, path, types, ap);
+        va_end(ap);
+        return;
+    }
+
+    std::vector<SimulationReceiver*>::iterator it;
+    for (it=m_receiverList.begin();
+         it!=m_receiverList.end();
+         it++)
+    {
+        if ((*it)->type() & type)
+        {
+            va_start(ap, types);
+            m_outbox.write(*it, throttle, path, types, ap);
+            va_end(ap);
+        }
+    }
+}
+
+void HapticsSim::postCollision(OscObject *o, OscObject *other)
+{
+    if (!o->m_collide.m_value)
+        return;
+
+    // One longer than the outbox allows, so it drops long paths.
+    char path[Outbox::MAX_PATH+1];
+    snprintf(path, sizeof(path), "%s/collide", o->c_path());
+    post(0, false, path, "sf", other->c_name(),
+         (double)(o->m_velocity - other->m_velocity).length());
+}
+
 void HapticsSim::findContactObject()
 {
     m_pContactObject = NULL;
@@ -339,6 +456,12 @@ void HapticsSim::set_grabbed(OscObject *pGrabbed)
     if (m_pGrabbedObject) {
         ob = dynamic_cast<CHAIObject*>(m_pGrabbedObject->special());
         if (ob) ob->chai_object()->setHapticEnabled(true, true);
+
+        // Let the next culling pass disable it again if it is far.
+        if (ob && ob->m_pHaptics && !ob->m_bHapticActive) {
+            ob->m_bHapticActive = true;
+            m_hapticActive.push_back(ob);
+        }
     }
 
     Simulation::set_grabbed(pGrabbed);
@@ -356,6 +479,164 @@ void HapticsSim::set_grabbed(OscObject *pGrabbed)
                ob ? 0 : 1);
 }
 
+void HapticsSim::addHapticObject(CHAIObject *o)
+{
+    // Lists of objects are sized here, so that culling them in the
+    // haptic loop never allocates.
+    m_hapticIndex.insert(o);
+    m_hapticActive.reserve(m_hapticIndex.size());
+    m_hapticMoved.reserve(m_hapticIndex.size());
+    m_transformDirty.reserve(m_hapticIndex.size());
+
+    // New CHAI objects have haptics enabled.
+    o->m_bHapticActive = true;
+    m_hapticActive.push_back(o);
+    moveHapticObject(o);
+    transformHapticObject(o);
+}
+
+void HapticsSim::removeHapticObject(CHAIObject *o)
+{
+    m_hapticIndex.remove(o);
+
+    std::vector<CHAIObject*>::iterator it;
+    it = std::find(m_hapticMoved.begin(), m_hapticMoved.end(), o);
+    if (it != m_hapticMoved.end())
+        m_hapticMoved.erase(it);
+    it = std::find(m_hapticActive.begin(), m_hapticActive.end(), o);
+    if (it != m_hapticActive.end())
+        m_hapticActive.erase(it);
+    it = std::find(m_transformDirty.begin(), m_transformDirty.end(), o);
+    if (it != m_transformDirty.end())
+        m_transformDirty.erase(it);
+}
+
+void HapticsSim::moveHapticObject(CHAIObject *o)
+{
+    if (!o->m_bMoved) {
+        o->m_bMoved = true;
+        m_hapticMoved.push_back(o);
+    }
+}
+
+void HapticsSim::transformHapticObject(CHAIObject *o)
+{
+    if (!o->m_bTransformDirty) {
+        o->m_bTransformDirty = true;
+        m_transformDirty.push_back(o);
+    }
+}
+
+void HapticsSim::updateTransforms()
+{
+    // Objects are children of the world, which is never moved, so
+    // each subtree can be updated on its own from the identity.
+    std::vector<CHAIObject*>::iterator it;
+    for (it=m_transformDirty.begin(); it!=m_transformDirty.end(); it++)
+    {
+        (*it)->m_bTransformDirty = false;
+        (*it)->chai_object()->computeGlobalPositions(true);
+    }
+    m_transformDirty.clear();
+
+    m_cursor->object()->computeGlobalPositions(true);
+}
+
+struct HapticsSim::CullVisitor
+{
+    HapticsSim *sim;
+    CHAIObject *grabbed;
+    void operator()(CHAIObject *o) { sim->foundHapticObject(o, grabbed); }
+};
+
+void HapticsSim::cullObjects()
+{
+    /* Objects are indexed by a sphere around their origin containing
+     * their bounding box, so that rotating them does not change their
+     * place in the index. */
+    unsigned int moving = 0;
+    for (unsigned int i=0; i<m_hapticMoved.size(); i++)
+    {
+        CHAIObject *o = m_hapticMoved[i];
+        cGenericObject *c = o->chai_object();
+        c->computeBoundaryBox(true);
+        cVector3d bmin = c->getBoundaryMin(), bmax = c->getBoundaryMax();
+        cVector3d extent(std::max(fabs(bmin.x()), fabs(bmax.x())),
+                         std::max(fabs(bmin.y()), fabs(bmax.y())),
+                         std::max(fabs(bmin.z()), fabs(bmax.z())));
+        cVector3d p = c->getLocalPos();
+
+        /* The object may keep moving as fast until it is indexed
+         * again, so the sphere is widened by how far it went since
+         * the last pass, like the cursor's reach below.  Its indexed
+         * position is either from that pass or where it stood still
+         * until then. */
+        double travel = o->m_bIndexed ? (p - o->m_indexedPos).length() : 0;
+        double r = extent.length() + travel * 2;
+        double lo[3] = { p.x()-r, p.y()-r, p.z()-r };
+        double hi[3] = { p.x()+r, p.y()+r, p.z()+r };
+        m_hapticIndex.update(o, lo, hi);
+        o->m_indexedPos = p;
+        o->m_bIndexed = true;
+
+        // Moving objects are indexed again on the next pass, so that
+        // their sphere shrinks once they stop.
+        if (travel > 0)
+            m_hapticMoved[moving++] = o;
+        else
+            o->m_bMoved = false;
+    }
+    m_hapticMoved.resize(moving);
+
+    // A grabbed object stays disabled until it is released.
+    CHAIObject *grabbed = m_pGrabbedObject
+        ? dynamic_cast<CHAIObject*>(m_pGrabbedObject->special()) : NULL;
+
+    m_cullPass++;
+    CullVisitor visit = { this, grabbed };
+
+    /* The cursor can reach objects within the margin of its current
+     * position, plus however far it may move before the next pass. */
+    if (m_haptics_margin.m_value > 0) {
+        double reach = m_haptics_margin.m_value
+            + m_cursor->m_velocity.length() * m_fTimestep * m_cullInterval * 2;
+        const cVector3d &p = m_cursor->m_position;
+        double lo[3] = { p.x()-reach, p.y()-reach, p.z()-reach };
+        double hi[3] = { p.x()+reach, p.y()+reach, p.z()+reach };
+        m_hapticIndex.query(lo, hi, visit);
+    }
+    else
+        m_hapticIndex.all(visit);
+
+    unsigned int kept = 0;
+    for (unsigned int i=0; i<m_hapticActive.size(); i++)
+    {
+        CHAIObject *o = m_hapticActive[i];
+        if (o->m_cullPass == m_cullPass)
+            m_hapticActive[kept++] = o;
+        else {
+            if (o != grabbed)
+                o->chai_object()->setHapticEnabled(false, true);
+            o->m_bHapticActive = false;
+        }
+    }
+    m_hapticActive.resize(kept);
+}
+
+void HapticsSim::foundHapticObject(CHAIObject *o, CHAIObject *grabbed)
+{
+    // Objects spanning several cells are found more than once.
+    if (o->m_cullPass == m_cullPass)
+        return;
+
+    o->m_cullPass = m_cullPass;
+    if (!o->m_bHapticActive && o != grabbed) {
+        o->chai_object()->setHapticEnabled(true, true);
+        o->m_bHapticActive = true;
+        m_hapticActive.push_back(o);
+    }
+}
+
 const cHapticDeviceInfo& HapticsSim::getSpecs()
 {
     return m_cursor->getSpecs();
@@ -401,14 +682,28 @@ void HapticsSim::on_workspace_standard()
 
 /****** CHAIObject ******/
 
-CHAIObject::CHAIObject(OscObject *obj, cGenericObject *chai_obj, cWorld *world)
+CHAIObject::CHAIObject(OscObject *obj, cGenericObject *chai_obj, cWorld *world,
+                       bool culled)
 {
     m_object = obj;
     m_chai_object = chai_obj;
+    m_scale.set(1, 1, 1);
+    m_pHaptics = NULL;
+    m_bMoved = false;
+    m_bTransformDirty = false;
+    m_bHapticActive = false;
+    m_bIndexed = false;
+    m_cullPass = 0;
 
     if (!obj || !chai_obj)
         return;
 
+    // The visual simulation uses the same objects but has no cursor.
+    if (culled)
+        m_pHaptics = dynamic_cast<HapticsSim*>(obj->simulation());
+    if (m_pHaptics)
+        m_pHaptics->addHapticObject(this);
+
     obj->m_position.setSetCallback(CHAIObject::on_set_position, this);
     obj->m_rotation.setSetCallback(CHAIObject::on_set_rotation, this);
     obj->m_visible.setSetCallback(CHAIObject::on_set_visible, this);
@@ -419,6 +714,12 @@ CHAIObject::CHAIObject(OscObject *obj, cGenericObject *chai_obj, cWorld *world)
 
 CHAIObject::~CHAIObject()
 {
+    // A texture may still be loading for this object.
+    if (m_object)
+        m_object->simulation()->loader().cancel(this);
+
+    if (m_pHaptics)
+        m_pHaptics->removeHapticObject(this);
 }
 
 void CHAIObject::on_set_stiffness(void* _me, OscScalar &s)
@@ -436,43 +737,80 @@ void CHAIObject::on_set_stiffness(void* _me, OscScalar &s)
         me->m_chai_object->m_material->getStiffness(), false);
 }
 
+/*! Loads a texture image and computes its normal map in the
+ *  background, unless another object already uses it. */
+class TextureLoadJob : public AssetLoader::Job
+{
+public:
+    TextureLoadJob(CHAIObject *obj, const std::string &filename)
+        : AssetLoader::Job(obj), m_pObject(obj), m_filename(filename) {}
+
+    virtual void load()
+        { m_texture = AssetCache::instance().texture(m_filename); }
+
+    virtual void finish()
+        { m_pObject->on_texture_loaded(m_filename, m_texture); }
+
+protected:
+    CHAIObject *m_pObject;
+    std::string m_filename;
+    std::shared_ptr<const AssetCache::Texture> m_texture;
+};
+
 void CHAIObject::on_set_texture_image(void* _me, OscString &s)
 {
     CHAIObject* me = static_cast<CHAIObject*>(_me);
+    AssetLoader &loader = me->obj()->simulation()->loader();
+
+    // Only the latest image is applied.
+    loader.cancel(me);
 
     if (!s.empty())
     {
-        me->chai_object()->m_texture = cTexture2d::create();
-        if (!me->m_chai_object->m_texture->loadFromFile(s))
-        {
-            printf("[%s] Error loading texture image \"%s\".\n",
-                   me->obj()->simulation()->type_str(), s.c_str());
-            return;
-        }
-
-        // white color for texture mixing
-        me->chai_object()->m_material->setWhite();
-
-        // create normal map from texture data
-        cNormalMapPtr normalMap = cNormalMap::create();
-        normalMap->createMap(me->chai_object()->m_texture);
-        me->chai_object()->m_normalMap = normalMap;
-
-        // enable texture mapping
-        me->chai_object()->setUseTexture(true);
-        me->chai_object()->m_material->setTextureLevel(me->m_object->m_texture_level.m_value);
-        me->chai_object()->m_texture->setEnabled(true);
+        // The object keeps its current texture until the new one is
+        // loaded.
+        loader.submit(new TextureLoadJob(me, s));
     }
     else
     {
+        // The texture may be shared, so it is left enabled.
         me->m_chai_object->setUseTexture(false);
-        if (me->m_chai_object->m_texture)
-            me->m_chai_object->m_texture->setEnabled(false);
+        me->m_texture.reset();
         const cVector3d &c(me->obj()->m_color);
         me->chai_object()->m_material->m_diffuse.set(c.x(), c.y(), c.z());
     }
 }
 
+void CHAIObject::on_texture_loaded(const std::string &filename,
+                                   std::shared_ptr<const AssetCache::Texture> texture)
+{
+    Simulation *sim = obj()->simulation();
+    if (sim->type() == Simulation::ST_HAPTICS)
+        lo_send(address_send,
+                ("/world/"+obj()->name()+"/texture/image/loaded").c_str(),
+                "si", filename.c_str(), texture ? 1 : 0);
+
+    if (!texture)
+    {
+        printf("[%s] Error loading texture image \"%s\".\n",
+               sim->type_str(), filename.c_str());
+        return;
+    }
+
+    // The image is shared with other objects using the same file.
+    m_texture = texture;
+    chai_object()->m_texture = texture->texture;
+    chai_object()->m_normalMap = texture->normalMap;
+
+    // white color for texture mixing
+    chai_object()->m_material->setWhite();
+
+    // enable texture mapping
+    chai_object()->setUseTexture(true);
+    chai_object()->m_material->setTextureLevel(m_object->m_texture_level.m_value);
+    chai_object()->m_texture->setEnabled(true);
+}
+
 /****** OscSphereCHAI ******/
 
 OscSphereCHAI::OscSphereCHAI(cWorld *world, const char *name, OscBase *parent)
@@ -508,6 +846,13 @@ OscSphereCHAI::~OscSphereCHAI()
         m_pSphere->getParent()->deleteChild(m_pSphere);
 }
 
+void CHAIObject::setScale(const cVector3d &scale)
+{
+    m_scale = scale;
+    m_chai_object->setLocalRot(scaled(m_object->m_rotation));
+    moved();
+}
+
 void OscSphereCHAI::on_radius()
 {
     printf("OscSphereCHAI::on_radius(). radius = %f\n", m_radius.m_value);
@@ -516,6 +861,9 @@ void OscSphereCHAI::on_radius()
         return;
 
     m_pSphere->setRadius(m_radius.m_value);
+
+    if (m_pSpecial)
+        static_cast<CHAIObject*>(m_pSpecial)->moved();
 }
 
 void OscSphereCHAI::on_grab()
@@ -528,9 +876,9 @@ void OscSphereCHAI::on_grab()
 OscPrismCHAI::OscPrismCHAI(cWorld *world, const char *name, OscBase *parent)
     : OscPrism(NULL, name, parent)
 {
-    m_pPrism = new cMesh();
-    createPrism();
-    m_pPrism->computeBoundaryBox();
+    // An analytic box, so that the cost of haptic interaction with a
+    // prism is small and does not depend on a triangle count.
+    m_pPrism = new cShapeBox(m_size.x(), m_size.y(), m_size.z());
     m_pPrism->m_material->setBlueLight();
 
     world->addChild(m_pPrism);
@@ -539,14 +887,8 @@ OscPrismCHAI::OscPrismCHAI(cWorld *world, const char *name, OscBase *parent)
     // during object contact.
     m_pPrism->m_userData = this;
 
-    // We use two force algorithms because the finger proxy algorithm
-    // handles better near corners, but potential field recovers
-    // better from pop-through issues.
-    m_pPrism->createBruteForceCollisionDetector();
     m_pPrism->createEffectSurface();
 
-    // We divide the stiffness by 2 because there are two force
-    // algorithms engaged which are additive.
     HapticsSim *hap = dynamic_cast<HapticsSim*>(simulation());
     if (hap)
     {
@@ -571,162 +913,12 @@ OscPrismCHAI::~OscPrismCHAI()
     }
 }
 
-// This function borrowed from dynamic_ode example in CHAI.
-void OscPrismCHAI::createPrism(bool openbox)
-{
-    int n;
-    int cur_index = 0;
-    int start_index = 0;
-
-    // +x face
-    m_pPrism->newVertex( m_size.x()/2,  m_size.y()/2, -m_size.z()/2);
-    m_pPrism->newVertex( m_size.x()/2,  m_size.y()/2,  m_size.z()/2);
-    m_pPrism->newVertex( m_size.x()/2, -m_size.y()/2, -m_size.z()/2);
-    m_pPrism->newTriangle(cur_index,cur_index+1,cur_index+2);
-    cur_index+=3;
-
-    m_pPrism->newVertex( m_size.x()/2, -m_size.y()/2, -m_size.z()/2);
-    m_pPrism->newVertex( m_size.x()/2,  m_size.y()/2,  m_size.z()/2);
-    m_pPrism->newVertex( m_size.x()/2, -m_size.y()/2,  m_size.z()/2);
-    m_pPrism->newTriangle(cur_index,cur_index+1,cur_index+2);
-    cur_index+=3;
-
-    for(n=start_index; n<cur_index; n++) {
-        m_pPrism->m_vertices->setTexCoord(n,
-            (m_pPrism->m_vertices->getLocalPos(n).y() + m_size.x()/2) / (2.0 * m_size.z()/2),
-            (m_pPrism->m_vertices->getLocalPos(n).z() + m_size.x()/2) / (2.0 * m_size.y()/2)
-            );
-        m_pPrism->m_vertices->setNormal(n,1,0,0);
-    }
-
-    start_index += 6;
-
-    // -x face
-    m_pPrism->newVertex(-m_size.x()/2,  m_size.y()/2,  m_size.z()/2);
-    m_pPrism->newVertex(-m_size.x()/2,  m_size.y()/2, -m_size.z()/2);
-    m_pPrism->newVertex(-m_size.x()/2, -m_size.y()/2, -m_size.z()/2);
-    m_pPrism->newTriangle(cur_index,cur_index+1,cur_index+2);
-    cur_index+=3;
-
-    m_pPrism->newVertex(-m_size.x()/2,  m_size.y()/2,  m_size.z()/2);
-    m_pPrism->newVertex(-m_size.x()/2, -m_size.y()/2, -m_size.z()/2);
-    m_pPrism->newVertex(-m_size.x()/2, -m_size.y()/2,  m_size.z()/2);
-    m_pPrism->newTriangle(cur_index,cur_index+1,cur_index+2);
-    cur_index+=3;
-
-    for(n=start_index; n<cur_index; n++) {
-        m_pPrism->m_vertices->setTexCoord(n,
-            (m_pPrism->m_vertices->getLocalPos(n).y() + m_size.x()/2) / (2.0 * m_size.z()/2),
-            (m_pPrism->m_vertices->getLocalPos(n).z() + m_size.x()/2) / (2.0 * m_size.y()/2)
-            );
-        m_pPrism->m_vertices->setNormal(n,-1,0,0);
-    }
-
-    start_index += 6;
-
-    // +y face
-    m_pPrism->newVertex(m_size.x()/2,  m_size.y()/2,  m_size.z()/2);
-    m_pPrism->newVertex(m_size.x()/2,  m_size.y()/2, -m_size.z()/2);
-    m_pPrism->newVertex(-m_size.x()/2, m_size.y()/2, -m_size.z()/2);
-    m_pPrism->newTriangle(cur_index,cur_index+1,cur_index+2);
-    cur_index+=3;
-
-    m_pPrism->newVertex(m_size.x()/2,  m_size.y()/2,  m_size.z()/2);
-    m_pPrism->newVertex(-m_size.x()/2, m_size.y()/2, -m_size.z()/2);
-    m_pPrism->newVertex(-m_size.x()/2, m_size.y()/2,  m_size.z()/2);
-    m_pPrism->newTriangle(cur_index,cur_index+1,cur_index+2);
-    cur_index+=3;
-
-    for(n=start_index; n<cur_index; n++) {
-        m_pPrism->m_vertices->setTexCoord(n,
-            (m_pPrism->m_vertices->getLocalPos(n).x() + m_size.y()/2) / (2.0 * m_size.z()/2),
-            (m_pPrism->m_vertices->getLocalPos(n).z() + m_size.x()/2) / (2.0 * m_size.y()/2)
-            );
-        m_pPrism->m_vertices->setNormal(n,0,1,0);
-    }
-
-    start_index += 6;
-
-    // -y face
-    m_pPrism->newVertex(m_size.x()/2,  -m_size.y()/2,  m_size.z()/2);
-    m_pPrism->newVertex(-m_size.x()/2, -m_size.y()/2, -m_size.z()/2);
-    m_pPrism->newVertex(m_size.x()/2,  -m_size.y()/2, -m_size.z()/2);
-    m_pPrism->newTriangle(cur_index,cur_index+1,cur_index+2);
-    cur_index+=3;
-
-    m_pPrism->newVertex(-m_size.x()/2, -m_size.y()/2, -m_size.z()/2);
-    m_pPrism->newVertex(m_size.x()/2,  -m_size.y()/2,  m_size.z()/2);
-    m_pPrism->newVertex(-m_size.x()/2, -m_size.y()/2,  m_size.z()/2);
-    m_pPrism->newTriangle(cur_index,cur_index+1,cur_index+2);
-    cur_index+=3;
-
-    for(n=start_index; n<cur_index; n++) {
-        m_pPrism->m_vertices->setTexCoord(n,
-            (m_pPrism->m_vertices->getLocalPos(n).x() + m_size.y()/2) / (2.0 * m_size.z()/2),
-            (m_pPrism->m_vertices->getLocalPos(n).z() + m_size.x()/2) / (2.0 * m_size.y()/2)
-            );
-        m_pPrism->m_vertices->setNormal(n,0,-1,0);
-    }
-
-    start_index += 6;
-
-    // -z face
-    m_pPrism->newVertex(-m_size.x()/2, -m_size.y()/2, -m_size.z()/2);
-    m_pPrism->newVertex(m_size.x()/2,   m_size.y()/2, -m_size.z()/2);
-    m_pPrism->newVertex(m_size.x()/2,  -m_size.y()/2, -m_size.z()/2);
-    m_pPrism->newTriangle(cur_index,cur_index+1,cur_index+2);
-    cur_index+=3;
-
-    m_pPrism->newVertex( m_size.x()/2,  m_size.y()/2, -m_size.z()/2);
-    m_pPrism->newVertex(-m_size.x()/2, -m_size.y()/2, -m_size.z()/2);
-    m_pPrism->newVertex(-m_size.x()/2,  m_size.y()/2, -m_size.z()/2);
-    m_pPrism->newTriangle(cur_index,cur_index+1,cur_index+2);
-    cur_index+=3;
-
-    for(n=start_index; n<cur_index; n++) {
-        m_pPrism->m_vertices->setTexCoord(n,
-            (m_pPrism->m_vertices->getLocalPos(n).x() + m_size.y()/2) / (2.0 * m_size.z()/2),
-            (m_pPrism->m_vertices->getLocalPos(n).y() + m_size.x()/2) / (2.0 * m_size.y()/2)
-            );
-        m_pPrism->m_vertices->setNormal(n,0,0,-1);
-    }
-
-    start_index += 6;
-
-    if (!openbox) {
-
-        // +z face
-        m_pPrism->newVertex(-m_size.x()/2, -m_size.y()/2, m_size.z()/2);
-        m_pPrism->newVertex(m_size.x()/2,  -m_size.y()/2, m_size.z()/2);
-        m_pPrism->newVertex(m_size.x()/2,  m_size.y()/2,  m_size.z()/2);
-        m_pPrism->newTriangle(cur_index,cur_index+1,cur_index+2);
-        cur_index+=3;
-
-        m_pPrism->newVertex(-m_size.x()/2, -m_size.y()/2, m_size.z()/2);
-        m_pPrism->newVertex( m_size.x()/2,  m_size.y()/2, m_size.z()/2);
-        m_pPrism->newVertex(-m_size.x()/2,  m_size.y()/2, m_size.z()/2);
-        m_pPrism->newTriangle(cur_index,cur_index+1,cur_index+2);
-        cur_index+=3;
-
-        for(n=start_index; n<cur_index; n++) {
-            m_pPrism->m_vertices->setTexCoord(n,
-                (m_pPrism->m_vertices->getLocalPos(n).x() + m_size.y()/2) / (2.0 * m_size.z()/2),
-                (m_pPrism->m_vertices->getLocalPos(n).y() + m_size.x()/2) / (2.0 * m_size.y()/2)
-                );
-            m_pPrism->m_vertices->setNormal(n,0,0,1);
-        }
-
-        start_index += 6;
-    }
-}
-
 void OscPrismCHAI::on_size()
 {
-    cVector3d curSize = m_pPrism->getBoundaryMax() - m_pPrism->getBoundaryMin();
-    cVector3d scale(1.0/curSize.x(), 1.0/curSize.y(), 1.0/curSize.z());
-    m_pPrism->scaleXYZ(scale.x()*m_size.x(),
-                       scale.y()*m_size.y(),
-                       scale.z()*m_size.z());
+    m_pPrism->setSize(m_size.x(), m_size.y(), m_size.z());
+
+    if (m_pSpecial)
+        static_cast<CHAIObject*>(m_pSpecial)->moved();
 }
 
 void OscPrismCHAI::on_grab()
@@ -736,36 +928,478 @@ void OscPrismCHAI::on_grab()
 
 /****** OscMeshCHAI ******/
 
+/*! Loads a mesh file in the background, unless another object
+ *  already uses it at the same size. */
+class MeshLoadJob : public AssetLoader::Job
+{
+public:
+    /*! Load the file at its default size, or at the given size.
+     *  Objects that scale their transform load it unscaled. */
+    MeshLoadJob(OscMeshCHAI *obj, const std::string &filename,
+                const cVector3d *size=NULL)
+        : AssetLoader::Job(obj), m_pObject(obj), m_filename(filename),
+          m_bInitial(size == NULL), m_bScaled(obj->m_bScaled)
+        { if (size) m_size = *size; }
+
+    virtual void load()
+    {
+        std::shared_ptr<const AssetCache::MeshFile> file =
+            AssetCache::instance().meshFile(m_filename);
+        if (!file)
+            return;
+
+        // size it to 0.1 without changing proportions
+        if (m_bInitial)
+            m_size.set(0.1/file->size, 0.1/file->size, 0.1/file->size);
+
+        m_mesh = AssetCache::instance().mesh(m_filename,
+                                             m_bScaled ? file->extent : m_size);
+    }
+
+    virtual void finish()
+        { m_pObject->on_loaded(m_mesh, m_size, m_bInitial); }
+
+protected:
+    OscMeshCHAI *m_pObject;
+    std::string m_filename;
+    cVector3d m_size;
+    bool m_bInitial;
+    bool m_bScaled;
+    std::shared_ptr<const AssetCache::Mesh> m_mesh;
+};
+
 OscMeshCHAI::OscMeshCHAI(cWorld *world, const char *name, const char *filename,
                          OscBase *parent)
-    : OscMesh(NULL, name, filename, parent)
+    : OscMesh(NULL, name, filename, parent),
+      m_filename(filename), m_bSizePending(false)
+{
+    HapticsSim *hap = dynamic_cast<HapticsSim*>(simulation());
+    m_bScaled = (hap == NULL);
+
+    m_pMesh = m_bScaled ? new ScaledMesh() : new cMultiMesh();
+
+    world->addChild(m_pMesh);
+
+    // User data points to the OscObject, used for identification
+    // during object contact.
+    m_pMesh->m_userData = this;
+
+    // We do not call createEffectSurface() for cMesh since
+    // finger-proxy algorithm is engaged.
+    if (hap)
+    {
+        m_pMesh->m_material->setStiffness(
+            std::min(hap->m_stiffness.m_value,
+                     hap->getSpecs().m_maxLinearStiffness));
+    }
+
+    m_pSpecial = new CHAIObject(this, m_pMesh, world);
+
+    // Parsing the file and building its collision tree can take far
+    // longer than a step, so the meshes appear once they are ready.
+    simulation()->loader().submit(new MeshLoadJob(this, m_filename));
+}
+
+OscMeshCHAI::~OscMeshCHAI()
+{
+    simulation()->loader().cancel(this);
+
+    if (m_pMesh) {
+        AssetCache::detach(m_pMesh);
+        m_pMesh->getParent()->deleteChild(m_pMesh);
+    }
+}
+
+void OscMeshCHAI::on_loaded(std::shared_ptr<const AssetCache::Mesh> mesh,
+                            const cVector3d &size, bool initial)
+{
+    if (initial) {
+        if (simulation()->type() == Simulation::ST_HAPTICS)
+            lo_send(address_send, ("/world/"+m_name+"/loaded").c_str(),
+                    "si", m_filename.c_str(), mesh ? 1 : 0);
+
+        if (mesh)
+            printf("[%s] Loaded %s for object %s.\n",
+                   simulation()->type_str(), m_filename.c_str(), c_name());
+        else
+            printf("[%s] Unable to load %s for object %s.\n",
+                   simulation()->type_str(), m_filename.c_str(), c_name());
+    }
+
+    if (!mesh)
+        return;
+
+    setMesh(mesh);
+
+    if (initial) {
+        if (m_bSizePending) {
+            m_bSizePending = false;
+            on_size();
+        }
+        else {
+            m_size.setValue(size, false);
+            if (m_bScaled)
+                setScale();
+        }
+    }
+}
+
+void OscMeshCHAI::setMesh(std::shared_ptr<const AssetCache::Mesh> mesh)
+{
+    AssetCache::detach(m_pMesh);
+    AssetCache::attach(*mesh, m_pMesh);
+    m_geometry = mesh;
+
+    m_pMesh->setShowEnabled(m_visible.m_value, true);
+
+    if (m_pSpecial)
+        static_cast<CHAIObject*>(m_pSpecial)->moved();
+}
+
+void OscMeshCHAI::on_size()
 {
-    m_pMesh = new cMultiMesh();
+    if (!m_geometry) {
+        m_bSizePending = true;
+        return;
+    }
 
-    if (!m_pMesh->loadFromFile(filename)) {
-        printf("[%s] Unable to load %s for object %s.\n",
-               simulation()->type_str(), filename, name);
-        delete m_pMesh;
-        m_pMesh = NULL;
+    // Resizing is only a change of transform.
+    if (m_bScaled) {
+        setScale();
         return;
     }
 
-    printf("[%s] Loaded %s for object %s.\n",
-           simulation()->type_str(), filename, name);
+    // The geometry is never scaled in place, since other objects may
+    // share it.  A size already used by another object is shared at
+    // once; others are scaled in the background.
+    AssetLoader &loader = simulation()->loader();
+    loader.cancel(this);
+
+    std::shared_ptr<const AssetCache::Mesh> mesh =
+        AssetCache::instance().findMesh(*m_geometry, m_size);
+    if (mesh)
+        setMesh(mesh);
+    else
+        loader.submit(new MeshLoadJob(this, m_filename, &m_size));
+}
+
+void OscMeshCHAI::setScale()
+{
+    const cVector3d &extent = m_geometry->file->extent;
+    static_cast<CHAIObject*>(m_pSpecial)->setScale(
+        cVector3d(extent.x() > 0 ? m_size.x() / extent.x() : 1,
+                  extent.y() > 0 ? m_size.y() / extent.y() : 1,
+                  extent.z() > 0 ? m_size.z() / extent.z() : 1));
+}
+
+bool ScaledMesh::computeCollisionDetection(const cVector3d& a_segmentPointA,
+                                           const cVector3d& a_segmentPointB,
+                                           cCollisionRecorder& a_recorder,
+                                           cCollisionSettings& a_settings)
+{
+    // The scale is recovered from the lengths of the rotation's
+    // columns, which are unit vectors multiplied by the scale.
+    cMatrix3d scaledRot(m_localRot);
+    cVector3d scale(scaledRot.getCol0().length(),
+                    scaledRot.getCol1().length(),
+                    scaledRot.getCol2().length());
+    if (scale.x() <= 0 || scale.y() <= 0 || scale.z() <= 0)
+        return false;
+
+    cMatrix3d rot;
+    rot.setCol(cMul(1/scale.x(), scaledRot.getCol0()),
+               cMul(1/scale.y(), scaledRot.getCol1()),
+               cMul(1/scale.z(), scaledRot.getCol2()));
+
+    // Map the segment to where it would be if the object were not
+    // scaled.  The map is affine, so the nearest collision along the
+    // segment is the same in both spaces.
+    cVector3d a(cMul(cTranspose(rot), a_segmentPointA - m_localPos));
+    cVector3d b(cMul(cTranspose(rot), a_segmentPointB - m_localPos));
+    a.set(a.x()/scale.x(), a.y()/scale.y(), a.z()/scale.z());
+    b.set(b.x()/scale.x(), b.y()/scale.y(), b.z()/scale.z());
+    a = m_localPos + cMul(rot, a);
+    b = m_localPos + cMul(rot, b);
+
+    cCollisionRecorder recorder;
+    m_localRot = rot;
+    bool hit = cMultiMesh::computeCollisionDetection(a, b, recorder,
+                                                     a_settings);
+    m_localRot = scaledRot;
+    if (!hit)
+        return false;
+
+    // Global positions come from the scaled global transform, so only
+    // distances and normals are corrected.
+    cCollisionEvent &nearest = recorder.m_nearestCollision;
+    unscale_collision(nearest, a_segmentPointA, rot, scale);
+    bool nearer = (nearest.m_squareDistance
+                   < a_recorder.m_nearestCollision.m_squareDistance);
+
+    if (a_settings.m_checkForNearestCollisionOnly) {
+        if (!nearer)
+            return false;
+        a_recorder.m_nearestCollision = nearest;
+        a_recorder.m_collisions.clear();
+        a_recorder.m_collisions.push_back(nearest);
+        return true;
+    }
+
+    if (nearer)
+        a_recorder.m_nearestCollision = nearest;
+    for (unsigned int i=0; i < recorder.m_collisions.size(); i++) {
+        unscale_collision(recorder.m_collisions[i], a_segmentPointA,
+                          rot, scale);
+        a_recorder.m_collisions.push_back(recorder.m_collisions[i]);
+    }
+    return true;
+}
+
+void ScaledMesh::unscale_collision(cCollisionEvent &e, const cVector3d &origin,
+                                   const cMatrix3d &rot, const cVector3d &scale)
+{
+    e.m_squareDistance = (e.m_globalPos - origin).lengthsq();
+
+    // Normals transform by the inverse scale.  The mesh is a child of
+    // the world, so its rotation is global.
+    cVector3d n(e.m_localNormal);
+    n.set(n.x()/scale.x(), n.y()/scale.y(), n.z()/scale.z());
+    e.m_globalNormal = cMul(rot, n);
+    e.m_globalNormal.normalize();
+}
+
+/****** OscPlaneCHAI ******/
+
+// Extent and thickness of the box used to draw a plane.
+static const double PLANE_EXTENT = 20.0;
+static const double PLANE_THICKNESS = 0.01;
+
+OscPlaneCHAI::OscPlaneCHAI(cWorld *world, const char *name, OscBase *parent)
+    : OscPlane(NULL, name, parent)
+{
+    m_pPlane = new cGenericObject();
+    m_pBox = new cShapeBox(PLANE_EXTENT, PLANE_EXTENT, PLANE_THICKNESS,
+                           m_pPlane->m_material);
+    m_pBox->setLocalPos(0, 0, -PLANE_THICKNESS/2);
+    m_pPlane->addChild(m_pBox);
+    world->addChild(m_pPlane);
+
+    // User data points to the OscObject, used for identification
+    // during object contact.
+    m_pPlane->m_userData = this;
+    m_pBox->m_userData = this;
+
+    m_pBox->createEffectSurface();
+
+    HapticsSim *hap = dynamic_cast<HapticsSim*>(simulation());
+    if (hap)
+    {
+        m_pPlane->m_material->setStiffness(
+            std::min(hap->m_stiffness.m_value,
+                     hap->getSpecs().m_maxLinearStiffness));
+    }
+
+    m_pSpecial = new CHAIObject(this, m_pPlane, world);
+}
+
+OscPlaneCHAI::~OscPlaneCHAI()
+{
+    HapticsSim *hap = dynamic_cast<HapticsSim*>(simulation());
+    if (hap && hap->contact_object() == this)
+    {
+        hap->clear_contact_object((CHAIObject*)m_pSpecial);
+    }
+
+    if (m_pPlane) {
+        m_pPlane->getParent()->deleteChild(m_pPlane);
+    }
+}
+
+void OscPlaneCHAI::on_normal()
+{
+    cVector3d n(m_normal);
+    if (n.length() == 0)
+        return;
+    n.normalize();
+
+    // Any vector not parallel to the normal gives the other two axes.
+    cVector3d a(1, 0, 0);
+    if (fabs(n.x()) > 0.9)
+        a.set(0, 1, 0);
+    cVector3d x(cCross(a, n));
+    x.normalize();
+    cVector3d y(cCross(n, x));
+
+    cMatrix3d rot;
+    rot.setCol(x, y, n);
+    m_pPlane->setLocalRot(rot);
+
+    if (m_pSpecial)
+        static_cast<CHAIObject*>(m_pSpecial)->moved();
+}
 
-    // center the mesh
-    m_pMesh->computeBoundaryBox();
-    cVector3d vmin = m_pMesh->getBoundaryMin();
-    cVector3d vmax = m_pMesh->getBoundaryMax();
-    m_pMesh->translate((vmax-vmin*3)/2);
+/****** OscCapsuleCHAI ******/
 
-    // size it to 0.1 without changing proportions
-    float size = (vmax-vmin).length();
-    m_size.setValue(0.1/size, 0.1/size, 0.1/size);
+OscCapsuleCHAI::OscCapsuleCHAI(cWorld *world, const char *name, OscBase *parent)
+    : OscCapsule(NULL, name, parent)
+{
+    m_pCapsule = new cGenericObject();
+    m_pCylinder = new cShapeCylinder(m_radius.m_value, m_radius.m_value,
+                                     m_length.m_value, m_pCapsule->m_material);
+    m_pCaps[0] = new cShapeSphere(m_radius.m_value, m_pCapsule->m_material);
+    m_pCaps[1] = new cShapeSphere(m_radius.m_value, m_pCapsule->m_material);
+    m_pCapsule->addChild(m_pCylinder);
+    m_pCapsule->addChild(m_pCaps[0]);
+    m_pCapsule->addChild(m_pCaps[1]);
     on_size();
 
-    /* setup collision detector */
-    m_pMesh->createAABBCollisionDetector(0.01 /* TODO make variable OSC-accessible? */);
+    world->addChild(m_pCapsule);
+
+    // User data points to the OscObject, used for identification
+    // during object contact.
+    m_pCapsule->m_userData = this;
+    m_pCylinder->m_userData = this;
+    m_pCaps[0]->m_userData = this;
+    m_pCaps[1]->m_userData = this;
+
+    m_pCylinder->createEffectSurface();
+    m_pCaps[0]->createEffectSurface();
+    m_pCaps[1]->createEffectSurface();
+
+    HapticsSim *hap = dynamic_cast<HapticsSim*>(simulation());
+    if (hap)
+    {
+        m_pCapsule->m_material->setStiffness(
+            std::min(hap->m_stiffness.m_value,
+                     hap->getSpecs().m_maxLinearStiffness));
+    }
+
+    m_pSpecial = new CHAIObject(this, m_pCapsule, world);
+}
+
+OscCapsuleCHAI::~OscCapsuleCHAI()
+{
+    HapticsSim *hap = dynamic_cast<HapticsSim*>(simulation());
+    if (hap && hap->contact_object() == this)
+    {
+        hap->clear_contact_object((CHAIObject*)m_pSpecial);
+    }
+
+    if (m_pCapsule) {
+        m_pCapsule->getParent()->deleteChild(m_pCapsule);
+    }
+}
+
+void OscCapsuleCHAI::on_size()
+{
+    double r = m_radius.m_value;
+    double l = m_length.m_value;
+
+    // A CHAI cylinder extends along +Z from its base.
+    m_pCylinder->setBaseRadius(r);
+    m_pCylinder->setTopRadius(r);
+    m_pCylinder->setHeight(l);
+    m_pCylinder->setLocalPos(0, 0, -l/2);
+
+    m_pCaps[0]->setRadius(r);
+    m_pCaps[0]->setLocalPos(0, 0, -l/2);
+    m_pCaps[1]->setRadius(r);
+    m_pCaps[1]->setLocalPos(0, 0, l/2);
+
+    if (m_pSpecial)
+        static_cast<CHAIObject*>(m_pSpecial)->moved();
+}
+
+void OscCapsuleCHAI::on_grab()
+{
+    simulation()->set_grabbed(this);
+}
+
+/****** OscCylinderCHAI ******/
+
+OscCylinderCHAI::OscCylinderCHAI(cWorld *world, const char *name, OscBase *parent)
+    : OscCylinder(NULL, name, parent)
+{
+    m_pObject = new cGenericObject();
+    m_pCylinder = new cShapeCylinder(m_radius.m_value, m_radius.m_value,
+                                     m_length.m_value, m_pObject->m_material);
+    m_pObject->addChild(m_pCylinder);
+    on_size();
+
+    world->addChild(m_pObject);
+
+    // User data points to the OscObject, used for identification
+    // during object contact.
+    m_pObject->m_userData = this;
+    m_pCylinder->m_userData = this;
+
+    m_pCylinder->createEffectSurface();
+
+    HapticsSim *hap = dynamic_cast<HapticsSim*>(simulation());
+    if (hap)
+    {
+        m_pObject->m_material->setStiffness(
+            std::min(hap->m_stiffness.m_value,
+                     hap->getSpecs().m_maxLinearStiffness));
+    }
+
+    m_pSpecial = new CHAIObject(this, m_pObject, world);
+}
+
+OscCylinderCHAI::~OscCylinderCHAI()
+{
+    HapticsSim *hap = dynamic_cast<HapticsSim*>(simulation());
+    if (hap && hap->contact_object() == this)
+    {
+        hap->clear_contact_object((CHAIObject*)m_pSpecial);
+    }
+
+    if (m_pObject) {
+        m_pObject->getParent()->deleteChild(m_pObject);
+    }
+}
+
+void OscCylinderCHAI::on_size()
+{
+    double r = m_radius.m_value;
+    double l = m_length.m_value;
+
+    m_pCylinder->setBaseRadius(r);
+    m_pCylinder->setTopRadius(r);
+    m_pCylinder->setHeight(l);
+    m_pCylinder->setLocalPos(0, 0, -l/2);
+
+    if (m_pSpecial)
+        static_cast<CHAIObject*>(m_pSpecial)->moved();
+}
+
+void OscCylinderCHAI::on_grab()
+{
+    simulation()->set_grabbed(this);
+}
+
+/****** OscHeightfieldCHAI ******/
+
+OscHeightfieldCHAI::OscHeightfieldCHAI(cWorld *world, const char *name,
+                                       int columns, int rows, OscBase *parent)
+    : OscHeightfield(NULL, name, columns, rows, parent)
+{
+    m_pMesh = new cMesh();
+
+    // Vertex indexes match height indexes.
+    for (int i=0; i < columns*rows; i++)
+        m_pMesh->newVertex(0, 0, 0);
+
+    for (int r=0; r < rows-1; r++) {
+        for (int c=0; c < columns-1; c++) {
+            int i = r*columns + c;
+            m_pMesh->newTriangle(i, i+columns, i+1);
+            m_pMesh->newTriangle(i+1, i+columns, i+columns+1);
+        }
+    }
+
+    on_size();
+    m_pMesh->m_material->setBlueLight();
 
     world->addChild(m_pMesh);
 
@@ -773,8 +1407,8 @@ OscMeshCHAI::OscMeshCHAI(cWorld *world, const char *name, const char *filename,
     // during object contact.
     m_pMesh->m_userData = this;
 
-    // We do not call createEffectSurface() for cMesh since
-    // finger-proxy algorithm is engaged.
+    m_pMesh->createEffectSurface();
+
     HapticsSim *hap = dynamic_cast<HapticsSim*>(simulation());
     if (hap)
     {
@@ -786,21 +1420,41 @@ OscMeshCHAI::OscMeshCHAI(cWorld *world, const char *name, const char *filename,
     m_pSpecial = new CHAIObject(this, m_pMesh, world);
 }
 
-OscMeshCHAI::~OscMeshCHAI()
+OscHeightfieldCHAI::~OscHeightfieldCHAI()
 {
-    if (m_pMesh)
+    HapticsSim *hap = dynamic_cast<HapticsSim*>(simulation());
+    if (hap && hap->contact_object() == this)
+    {
+        hap->clear_contact_object((CHAIObject*)m_pSpecial);
+    }
+
+    if (m_pMesh) {
         m_pMesh->getParent()->deleteChild(m_pMesh);
+    }
 }
 
-void OscMeshCHAI::on_size()
+void OscHeightfieldCHAI::on_heights(int first, int count)
 {
+    double dx = m_size.x() / (m_columns-1);
+    double dy = m_size.y() / (m_rows-1);
+
+    for (int i=first; i < first+count; i++) {
+        int c = i % m_columns;
+        int r = i / m_columns;
+        m_pMesh->m_vertices->setLocalPos(i, c*dx - m_size.x()/2,
+                                         m_size.y()/2 - r*dy,
+                                         m_heights[i] * m_size.z());
+    }
+
+    m_pMesh->computeAllNormals();
+    m_pMesh->markForUpdate(false);
     m_pMesh->computeBoundaryBox(true);
-    cVector3d vmin(m_pMesh->getBoundaryMin());
-    cVector3d vmax(m_pMesh->getBoundaryMax());
-    cVector3d scale(vmax - vmin);
-    m_pMesh->scaleXYZ(m_size.x() / scale.x(),
-                      m_size.y() / scale.y(),
-                      m_size.z() / scale.z());
+
+    // The collision tree must be rebuilt after vertices move.
+    m_pMesh->createAABBCollisionDetector(0);
+
+    if (m_pSpecial)
+        static_cast<CHAIObject*>(m_pSpecial)->moved();
 }
 
 /****** OscCursorCHAI ******/
@@ -874,7 +1528,7 @@ void OscCursorCHAI::initializeWithDevice(cWorld *world, cGenericHapticDevicePtr
     // no extra force to begin with
     m_nExtraForceSteps = 0;
 
-    m_pSpecial = new CHAIObject(this, m_pCursor, world);
+    m_pSpecial = new CHAIObject(this, m_pCursor, world, false);
 }
 
 OscCursorCHAI::~OscCursorCHAI()
@@ -894,7 +1548,7 @@ void OscCursorCHAI::on_force()
     /* TODO: Make this timeout a configurable setting. */
 
     m_extraForce = m_force;
-    m_nExtraForceSteps = physics_timestep_ms*2/haptics_timestep_ms;
+    m_nExtraForceSteps = (int)(physics_timestep_ms*2/haptics_timestep_ms);
 }
 
 const char *OscCursorCHAI::device_str()
@@ -984,8 +1638,9 @@ void OscHapticsVirtdevCHAI::on_set_position(void* _me, OscVector3 &p)
     cMatrix3d rot(sim->m_cursor->object()->getLocalRot());
     me->m_pVirtdev->setPosition(cMul(cInverse(rot), p));
 
-    // Update visual representation of virtual device
-    // TODO: should be able to throttle this but it leads to stuttering visual updates
-    me->simulation()->sendtotype(Simulation::ST_VISUAL, false, "/world/device/position", "fff",
-                                 me->m_position.x(), me->m_position.y(), me->m_position.z());
+    // Update visual representation of virtual device.  Throttling
+    // by the outbox always delivers the latest position, so the
+    // display follows without a message per step.
+    sim->post(Simulation::ST_VISUAL, true, "/world/device/position", "fff",
+              me->m_position.x(), me->m_position.y(), me->m_position.z());
 }
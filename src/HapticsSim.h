@@ -5,6 +5,10 @@
 
 #include "Simulation.h"
 #include "OscObject.h"
+#include "ObjectPool.h"
+#include "SpatialHash.h"
+#include "AssetCache.h"
+#include "Outbox.h"
 
 #include <world/CWorld.h>
 #include <display/CCamera.h>
@@ -43,11 +47,30 @@ class HapticsSim : public Simulation
 
     const cHapticDeviceInfo& getSpecs();
 
+    //! Add an object to those culled by distance from the cursor.
+    void addHapticObject(CHAIObject *o);
+    //! Remove an object from haptic culling.
+    void removeHapticObject(CHAIObject *o);
+    //! Note that an object has moved or changed size.
+    void moveHapticObject(CHAIObject *o);
+    //! Note that an object's global transform must be recomputed.
+    void transformHapticObject(CHAIObject *o);
+
+    /*! Send a message from the haptic thread to simulations of the
+     *  given types, or to the client if type is 0, through the
+     *  outbox, so that the haptic loop never allocates or blocks.
+     *  Arguments are as for Outbox::write(). */
+    void post(int type, bool throttle, const char *path,
+              const char *types, ...);
+
   protected:
     virtual void initialize();
     virtual void step();
 
     void findContactObject();
+
+    //! Send an object's /collide message if it has collisions enabled.
+    void postCollision(OscObject *o, OscObject *other);
     void updateWorkspace(cVector3d &pos, cVector3d &vel);
 
     OscObject *m_pContactObject;
@@ -67,6 +90,34 @@ class HapticsSim : public Simulation
     OscCursorCHAI* m_cursor;    //! An OscObject representing the 3D cursor.
     OscHapticsVirtdevCHAI* m_pVirtdev;
 
+    /*! Objects indexed by their bounds, those that moved since the
+     *  last culling pass or were moving at it, and those with haptics
+     *  currently enabled.
+     *  Only objects near the cursor are enabled, so the cost of each
+     *  haptic tick depends on the objects around the cursor rather
+     *  than on the size of the scene. */
+    SpatialHash<CHAIObject*> m_hapticIndex;
+    std::vector<CHAIObject*> m_hapticMoved;
+    std::vector<CHAIObject*> m_hapticActive;
+    std::vector<CHAIObject*> m_transformDirty;
+    int m_cullInterval;
+    int m_cullCounter;
+    int m_cullPass;
+
+    //! Enable haptics on objects near the cursor and disable the rest.
+    void cullObjects();
+
+    //! Enable haptics on an object found by the current culling pass.
+    void foundHapticObject(CHAIObject *o, CHAIObject *grabbed);
+    struct CullVisitor;
+
+    /*! Recompute global transforms of the objects moved since the
+     *  last tick and of the cursor, instead of the whole world. */
+    void updateTransforms();
+
+    //! Messages sent from the haptic loop.
+    Outbox m_outbox;
+
     friend OscHapticsVirtdevCHAI;
 };
 
@@ -107,23 +158,118 @@ protected:
                 float x, float y, float z);
 };
 
+class HapticsPlaneFactory : public PlaneFactory
+{
+public:
+    HapticsPlaneFactory(Simulation *parent) : PlaneFactory(parent) {}
+    virtual ~HapticsPlaneFactory() {}
+
+    virtual HapticsSim* simulation() { return static_cast<HapticsSim*>(m_parent); }
+
+protected:
+    bool create(const char *name, float x, float y, float z);
+};
+
+class HapticsCapsuleFactory : public CapsuleFactory
+{
+public:
+    HapticsCapsuleFactory(Simulation *parent) : CapsuleFactory(parent) {}
+    virtual ~HapticsCapsuleFactory() {}
+
+    virtual HapticsSim* simulation() { return static_cast<HapticsSim*>(m_parent); }
+
+protected:
+    bool create(const char *name, float x, float y, float z);
+};
+
+class HapticsCylinderFactory : public CylinderFactory
+{
+public:
+    HapticsCylinderFactory(Simulation *parent) : CylinderFactory(parent) {}
+    virtual ~HapticsCylinderFactory() {}
+
+    virtual HapticsSim* simulation() { return static_cast<HapticsSim*>(m_parent); }
+
+protected:
+    bool create(const char *name, float x, float y, float z);
+};
+
+class HapticsHeightfieldFactory : public HeightfieldFactory
+{
+public:
+    HapticsHeightfieldFactory(Simulation *parent) : HeightfieldFactory(parent) {}
+    virtual ~HapticsHeightfieldFactory() {}
+
+    virtual HapticsSim* simulation() { return static_cast<HapticsSim*>(m_parent); }
+
+protected:
+    bool create(const char *name, int columns, int rows,
+                float x, float y, float z);
+};
+
 class CHAIObject : public OscObjectSpecial
 {
 public:
-    CHAIObject(OscObject *obj, cGenericObject *chai_obj, cWorld *world);
+    /*! Objects are culled from haptic interaction when far from the
+     *  cursor, unless culled is false. */
+    CHAIObject(OscObject *obj, cGenericObject *chai_obj, cWorld *world,
+               bool culled=true);
     virtual ~CHAIObject();
 
     virtual OscObject *obj() { return m_object; }
     virtual cGenericObject *chai_object() { return m_chai_object; }
 
+    /*! Update this object's bounds for culling and its global
+     *  transform after it has moved or changed size. */
+    void moved()
+        { if (m_pHaptics) { m_pHaptics->moveHapticObject(this);
+                            m_pHaptics->transformHapticObject(this); } }
+
+    /*! Apply a texture image loaded in the background, or report
+     *  that it could not be loaded if texture is empty. */
+    void on_texture_loaded(const std::string &filename,
+                           std::shared_ptr<const AssetCache::Texture> texture);
+
+    /*! Scale the object along its own axes by composing the scale
+     *  with its rotation, leaving its geometry untouched.  Only for
+     *  objects that are never touched by the cursor, since haptic
+     *  rendering assumes an orthonormal rotation. */
+    void setScale(const cVector3d &scale);
+
 protected:
     OscObject *m_object;
     cGenericObject *m_chai_object;
 
+    //! Scale applied in the object's transform, (1,1,1) if none.
+    cVector3d m_scale;
+
+    //! Return a rotation with the object's scale applied.
+    cMatrix3d scaled(const cMatrix3d &r) const
+        { cMatrix3d m;
+          m.setCol(cMul(m_scale.x(), r.getCol0()),
+                   cMul(m_scale.y(), r.getCol1()),
+                   cMul(m_scale.z(), r.getCol2()));
+          return m; }
+
+    //! Culling state, for objects in the haptics simulation.
+    HapticsSim *m_pHaptics;
+    bool m_bMoved;
+    bool m_bTransformDirty;
+    bool m_bHapticActive;
+    bool m_bIndexed;
+    cVector3d m_indexedPos;
+    int m_cullPass;
+
+    //! The texture image, shared by objects using the same file.
+    std::shared_ptr<const AssetCache::Texture> m_texture;
+
     static void on_set_position(void* me, OscVector3 &p)
-        { ((CHAIObject*)me)->chai_object()->setLocalPos(p); }
+        { ((CHAIObject*)me)->chai_object()->setLocalPos(p);
+          ((CHAIObject*)me)->moved(); }
     static void on_set_rotation(void* me, OscMatrix3 &r)
-        { ((CHAIObject*)me)->chai_object()->setLocalRot(r); }
+        { CHAIObject *o = (CHAIObject*)me;
+          o->chai_object()->setLocalRot(o->scaled(r));
+          if (o->m_pHaptics) o->m_pHaptics->transformHapticObject(o); }
     static void on_set_visible(void* me, OscBoolean &v)
         { ((CHAIObject*)me)->chai_object()->setShowEnabled(v.m_value, true); }
     static void on_set_stiffness(void* me, OscScalar &s);
@@ -141,9 +287,11 @@ protected:
     static void on_set_texture_level(void *me, OscScalar &level)
         { ((CHAIObject*)me)->chai_object()->
                 m_material->setTextureLevel(level.m_value); }
+
+    friend class HapticsSim;
 };
 
-class OscSphereCHAI : public OscSphere
+class OscSphereCHAI : public OscSphere, public Pooled<OscSphereCHAI>
 {
 public:
     OscSphereCHAI(cWorld *world, const char *name, OscBase *parent=NULL);
@@ -165,13 +313,13 @@ protected:
     cShapeSphere *m_pSphere;
 };
 
-class OscPrismCHAI : public OscPrism
+class OscPrismCHAI : public OscPrism, public Pooled<OscPrismCHAI>
 {
 public:
     OscPrismCHAI(cWorld *world, const char *name, OscBase *parent=NULL);
     virtual ~OscPrismCHAI();
 
-    virtual cMesh *object() { return m_pPrism; }
+    virtual cShapeBox *object() { return m_pPrism; }
 
 protected:
     virtual void on_size();
@@ -184,10 +332,25 @@ protected:
         { object()->m_material->setDynamicFriction(m_friction_dynamic.m_value); }
     virtual void on_grab();
 
-    //! Create a cMesh with a prism structure.
-    void createPrism(bool openbox=false);
+    cShapeBox *m_pPrism;
+};
 
-    cMesh *m_pPrism;
+/*! A multi-mesh whose transform may carry a scale, so that objects
+ *  sharing unscaled geometry can be drawn at any size.  Collisions,
+ *  used for selecting objects with the mouse, are found by mapping
+ *  the segment into the unscaled space of the geometry. */
+class ScaledMesh : public cMultiMesh
+{
+public:
+    virtual bool computeCollisionDetection(const cVector3d& a_segmentPointA,
+                                           const cVector3d& a_segmentPointB,
+                                           cCollisionRecorder& a_recorder,
+                                           cCollisionSettings& a_settings);
+
+protected:
+    //! Correct a collision found in the unscaled space.
+    static void unscale_collision(cCollisionEvent &e, const cVector3d &origin,
+                                  const cMatrix3d &rot, const cVector3d &scale);
 };
 
 class OscMeshCHAI : public OscMesh
@@ -199,6 +362,12 @@ public:
 
     virtual cMultiMesh *object() { return m_pMesh; }
 
+    /*! Use a mesh loaded in the background at the given size, or
+     *  report that the file could not be loaded if mesh is NULL.
+     *  Initial is true for the first load, at the default size. */
+    void on_loaded(std::shared_ptr<const AssetCache::Mesh> mesh,
+                   const cVector3d &size, bool initial);
+
 protected:
     virtual void on_color()
         { object()->m_material->m_diffuse.set(m_color.x(), m_color.y(), m_color.z()); }
@@ -208,7 +377,131 @@ protected:
         { object()->m_material->setDynamicFriction(m_friction_dynamic.m_value); }
     virtual void on_size();
 
+    //! Replace the object's meshes with those of a cached mesh.
+    void setMesh(std::shared_ptr<const AssetCache::Mesh> mesh);
+
+    //! Scale the unscaled geometry to the object's size.
+    void setScale();
+
+    /*! The object is in the world from creation, and shares the
+     *  meshes of m_geometry once its file is loaded. */
     cMultiMesh *m_pMesh;
+    std::shared_ptr<const AssetCache::Mesh> m_geometry;
+    std::string m_filename;
+    //! True if the size was set while loading.
+    bool m_bSizePending;
+    /*! True if the size is applied as a scale in the object's
+     *  transform over the file's unscaled geometry, so that it can be
+     *  changed without touching any vertex.  The haptics simulation
+     *  instead uses geometry scaled to each size, since the cursor's
+     *  collision and force algorithms assume unscaled frames. */
+    bool m_bScaled;
+
+    friend class MeshLoadJob;
+};
+
+/*! A plane is drawn as a large, thin box whose top face lies on the
+ *  plane.  The box is a child of the object, which is rotated so that
+ *  its Z axis follows the normal. */
+class OscPlaneCHAI : public OscPlane
+{
+public:
+    OscPlaneCHAI(cWorld *world, const char *name, OscBase *parent=NULL);
+    virtual ~OscPlaneCHAI();
+
+    virtual cGenericObject *object() { return m_pPlane; }
+
+protected:
+    virtual void on_normal();
+
+    virtual void on_color()
+        { object()->m_material->m_diffuse.set(m_color.x(), m_color.y(), m_color.z()); }
+    virtual void on_friction_static()
+        { object()->m_material->setStaticFriction(m_friction_static.m_value); }
+    virtual void on_friction_dynamic()
+        { object()->m_material->setDynamicFriction(m_friction_dynamic.m_value); }
+
+    cGenericObject *m_pPlane;
+    cShapeBox *m_pBox;
+};
+
+/*! A capsule is made of a cylinder and two spheres sharing the
+ *  material of a parent object. */
+class OscCapsuleCHAI : public OscCapsule, public Pooled<OscCapsuleCHAI>
+{
+public:
+    OscCapsuleCHAI(cWorld *world, const char *name, OscBase *parent=NULL);
+    virtual ~OscCapsuleCHAI();
+
+    virtual cGenericObject *object() { return m_pCapsule; }
+
+protected:
+    virtual void on_radius() { on_size(); }
+    virtual void on_length() { on_size(); }
+    void on_size();
+
+    virtual void on_color()
+        { object()->m_material->m_diffuse.set(m_color.x(), m_color.y(), m_color.z()); }
+    virtual void on_friction_static()
+        { object()->m_material->setStaticFriction(m_friction_static.m_value); }
+    virtual void on_friction_dynamic()
+        { object()->m_material->setDynamicFriction(m_friction_dynamic.m_value); }
+    virtual void on_grab();
+
+    cGenericObject *m_pCapsule;
+    cShapeCylinder *m_pCylinder;
+    cShapeSphere *m_pCaps[2];
+};
+
+class OscCylinderCHAI : public OscCylinder, public Pooled<OscCylinderCHAI>
+{
+public:
+    OscCylinderCHAI(cWorld *world, const char *name, OscBase *parent=NULL);
+    virtual ~OscCylinderCHAI();
+
+    virtual cGenericObject *object() { return m_pObject; }
+
+protected:
+    virtual void on_radius() { on_size(); }
+    virtual void on_length() { on_size(); }
+    void on_size();
+
+    virtual void on_color()
+        { object()->m_material->m_diffuse.set(m_color.x(), m_color.y(), m_color.z()); }
+    virtual void on_friction_static()
+        { object()->m_material->setStaticFriction(m_friction_static.m_value); }
+    virtual void on_friction_dynamic()
+        { object()->m_material->setDynamicFriction(m_friction_dynamic.m_value); }
+    virtual void on_grab();
+
+    //! The cylinder is offset within m_pObject so that it is centered.
+    cGenericObject *m_pObject;
+    cShapeCylinder *m_pCylinder;
+};
+
+/*! CHAI has no heightfield shape, so the grid is triangulated into a
+ *  mesh, two triangles per cell. */
+class OscHeightfieldCHAI : public OscHeightfield
+{
+public:
+    OscHeightfieldCHAI(cWorld *world, const char *name, int columns,
+                       int rows, OscBase *parent=NULL);
+    virtual ~OscHeightfieldCHAI();
+
+    virtual cMesh *object() { return m_pMesh; }
+
+protected:
+    virtual void on_size() { on_heights(0, m_heights.size()); }
+    virtual void on_heights(int first, int count);
+
+    virtual void on_color()
+        { object()->m_material->m_diffuse.set(m_color.x(), m_color.y(), m_color.z()); }
+    virtual void on_friction_static()
+        { object()->m_material->setStaticFriction(m_friction_static.m_value); }
+    virtual void on_friction_dynamic()
+        { object()->m_material->setDynamicFriction(m_friction_dynamic.m_value); }
+
+    cMesh *m_pMesh;
 };
 
 class OscCursorCHAI : public OscSphere
@@ -3,6 +3,7 @@
 #include "dimple.h"
 #include "InterfaceSim.h"
 #include "HapticsSim.h"
+#include <algorithm>
 
 bool InterfacePrismFactory::create(const char *name, float x, float y, float z)
 {
@@ -54,6 +55,123 @@ bool InterfaceMeshFactory::create(const char *name, const char *filename,
     return true;
 }
 
+bool InterfaceParticlesFactory::create(const char *name, int count,
+                                       float x, float y, float z)
+{
+    OscParticles *obj = new OscParticlesInterface(NULL, name, count, m_parent);
+
+    if (!(obj && simulation()->add_object(*obj)))
+            return false;
+
+    obj->m_position.setValue(x, y, z, false);
+    obj->traceOn();
+
+    // Particles are not simulated haptically.
+    simulation()->sendtotype(Simulation::ST_PHYSICS | Simulation::ST_VISUAL,
+                             0, "/world/particles/create", "sifff",
+                             name, count, x, y, z);
+
+    return true;
+}
+
+bool InterfacePlaneFactory::create(const char *name, float x, float y, float z)
+{
+    OscPlane *obj = new OscPlaneInterface(NULL, name, m_parent);
+
+    if (!(obj && simulation()->add_object(*obj)))
+            return false;
+
+    obj->m_position.setValue(x, y, z);
+    obj->traceOn();
+
+    simulation()->send(0, "/world/plane/create", "sfff", name, x, y, z);
+
+    return true;
+}
+
+bool InterfaceCapsuleFactory::create(const char *name, float x, float y, float z)
+{
+    OscCapsule *obj = new OscCapsuleInterface(NULL, name, m_parent);
+
+    if (!(obj && simulation()->add_object(*obj)))
+            return false;
+
+    obj->m_position.setValue(x, y, z);
+    obj->traceOn();
+
+    simulation()->send(0, "/world/capsule/create", "sfff", name, x, y, z);
+
+    return true;
+}
+
+bool InterfaceCylinderFactory::create(const char *name, float x, float y, float z)
+{
+    OscCylinder *obj = new OscCylinderInterface(NULL, name, m_parent);
+
+    if (!(obj && simulation()->add_object(*obj)))
+            return false;
+
+    obj->m_position.setValue(x, y, z);
+    obj->traceOn();
+
+    simulation()->send(0, "/world/cylinder/create", "sfff", name, x, y, z);
+
+    return true;
+}
+
+bool InterfaceHeightfieldFactory::create(const char *name, int columns,
+                                         int rows, float x, float y, float z)
+{
+    OscHeightfield *obj = new OscHeightfieldInterface(NULL, name, columns,
+                                                      rows, m_parent);
+
+    if (!(obj && simulation()->add_object(*obj)))
+            return false;
+
+    obj->m_position.setValue(x, y, z);
+    obj->traceOn();
+
+    simulation()->send(0, "/world/heightfield/create", "siifff",
+                       name, columns, rows, x, y, z);
+
+    return true;
+}
+
+bool InterfaceCompositeFactory::create(const char *name, float x, float y, float z)
+{
+    OscComposite *obj = new OscCompositeInterface(NULL, name, m_parent);
+
+    if (!(obj && simulation()->add_object(*obj)))
+            return false;
+
+    obj->m_position.setValue(x, y, z);
+    obj->traceOn();
+
+    simulation()->sendtotype(Simulation::ST_PHYSICS, 0,
+                             "/world/composite/create", "sfff", name, x, y, z);
+
+    return true;
+}
+
+bool InterfaceFieldFactory::create(const char *name, const char *type,
+                                   float x, float y, float z)
+{
+    OscField *obj = new OscFieldInterface(name, OscField::str_type(type),
+                                          m_parent);
+
+    if (!(obj && simulation()->add_object(*obj)))
+            return false;
+
+    obj->m_position.setValue(x, y, z);
+    obj->traceOn();
+
+    simulation()->sendtotype(Simulation::ST_PHYSICS, 0,
+                             "/world/field/create", "ssfff",
+                             name, type, x, y, z);
+
+    return true;
+}
+
 bool InterfaceHingeFactory::create(const char *name, OscObject *object1, OscObject *object2,
                                    double x, double y, double z,
                                    double ax, double ay, double az)
@@ -227,6 +345,13 @@ InterfaceSim::InterfaceSim(const char *port)
     m_pPrismFactory = new InterfacePrismFactory(this);
     m_pSphereFactory = new InterfaceSphereFactory(this);
     m_pMeshFactory = new InterfaceMeshFactory(this);
+    m_pParticlesFactory = new InterfaceParticlesFactory(this);
+    m_pPlaneFactory = new InterfacePlaneFactory(this);
+    m_pCapsuleFactory = new InterfaceCapsuleFactory(this);
+    m_pCylinderFactory = new InterfaceCylinderFactory(this);
+    m_pHeightfieldFactory = new InterfaceHeightfieldFactory(this);
+    m_pCompositeFactory = new InterfaceCompositeFactory(this);
+    m_pFieldFactory = new InterfaceFieldFactory(this);
     m_pHingeFactory = new InterfaceHingeFactory(this);
     m_pHinge2Factory = new InterfaceHinge2Factory(this);
     m_pFixedFactory = new InterfaceFixedFactory(this);
@@ -235,6 +360,7 @@ InterfaceSim::InterfaceSim(const char *port)
     m_pSlideFactory = new InterfaceSlideFactory(this);
     m_pPistonFactory = new InterfacePistonFactory(this);
     m_pUniversalFactory = new InterfaceUniversalFactory(this);
+    m_pSpatialQuery = new InterfaceSpatialQuery(this);
 
     m_camera = new OscCameraInterface("camera", this);
     m_cursor = new OscCursorInterface(NULL, "cursor", this);
@@ -243,6 +369,12 @@ InterfaceSim::InterfaceSim(const char *port)
     m_workspace_center.setGetCallback(on_get_workspace_center, this);
     m_workspace_size.m_magnitude.setGetCallback(on_get_workspace_size_mag, this);
     m_workspace_center.m_magnitude.setGetCallback(on_get_workspace_center_mag, this);
+    m_haptics_margin.setGetCallback(on_get_haptics_margin, this);
+    m_physics_threads.setGetCallback(on_get_physics_threads, this);
+    m_physics_step_time.setGetCallback(on_get_physics_step_time, this);
+    m_physics_substeps.setGetCallback(on_get_physics_substeps, this);
+    m_attraction.setGetCallback(on_get_attraction, this);
+    m_attraction_theta.setGetCallback(on_get_attraction_theta, this);
 
     m_fTimestep = 1;
 }
@@ -330,3 +462,34 @@ int OscMeshInterface::push_handler(const char *path, const char *types,
                                  argv[0]->f, argv[1]->f, argv[2]->f,
                                  argv[3]->f, argv[4]->f, argv[5]->f);
 }
+
+int OscParticlesInterface::positions_get_handler(const char *path,
+                                                 const char *types,
+                                                 lo_arg **argv, int argc,
+                                                 void *data, void *user_data)
+{
+    OscParticlesInterface *me = static_cast<OscParticlesInterface*>(user_data);
+    me->simulation()->sendtotype(Simulation::ST_PHYSICS, 0,
+                                 (me->path()+"/positions/get").c_str(), "");
+    return 0;
+}
+
+void OscHeightfieldInterface::on_heights(int first, int count)
+{
+    if (count == 1) {
+        simulation()->send(0, (path()+"/height").c_str(), "iif",
+                           first % m_columns, first / m_columns,
+                           m_heights[first]);
+        return;
+    }
+
+    // Forward in pieces small enough for the message queues.
+    const int piece = 192;
+    for (int i=first; i < first+count; i += piece)
+    {
+        int n = std::min(piece, first+count-i);
+        lo_blob b = lo_blob_new(n*sizeof(float), &m_heights[i]);
+        simulation()->send(0, (path()+"/heights").c_str(), "ib", i, b);
+        lo_blob_free(b);
+    }
+}
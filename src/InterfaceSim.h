@@ -102,6 +102,20 @@ class InterfaceSim : public Simulation
         Simulation::on_workspace_standard();
     }
 
+    virtual void on_thread_priority(const char *sim, int priority,
+                                    const char *policy) {
+        send(0, "/world/thread/priority", "sis", sim, priority, policy);
+        Simulation::on_thread_priority(sim, priority, policy);
+    }
+
+    virtual void on_thread_cpus(const char *sim, const char *cpus) {
+        send(0, "/world/thread/cpus", "ss", sim, cpus);
+        Simulation::on_thread_cpus(sim, cpus);
+    }
+
+    // Memory locking applies to the whole process, so it is done
+    // here rather than forwarded.
+
     virtual void on_add_receiver(const char *type);
 
     FWD_OSCVECTOR3(workspace_size, Simulation::ST_HAPTICS);
@@ -111,6 +125,13 @@ class InterfaceSim : public Simulation
     FWD_OSCSCALAR(grab_stiffness,Simulation::ST_HAPTICS);
     FWD_OSCSCALAR(grab_damping,Simulation::ST_HAPTICS);
     FWD_OSCSCALAR(grab_feedback,Simulation::ST_HAPTICS);
+    FWD_OSCSCALAR(haptics_margin,Simulation::ST_HAPTICS);
+
+    FWD_OSCSCALAR(physics_threads, Simulation::ST_PHYSICS);
+    FWD_OSCSCALAR(physics_step_time, Simulation::ST_PHYSICS);
+    FWD_OSCSCALAR(physics_substeps, Simulation::ST_PHYSICS);
+    FWD_OSCSCALAR(attraction, Simulation::ST_PHYSICS);
+    FWD_OSCSCALAR(attraction_theta, Simulation::ST_PHYSICS);
 
   protected:
     OscCameraInterface *m_camera;
@@ -155,6 +176,91 @@ protected:
                 float x, float y, float z);
 };
 
+class InterfaceParticlesFactory : public ParticlesFactory
+{
+public:
+    InterfaceParticlesFactory(Simulation *parent) : ParticlesFactory(parent) {}
+    virtual ~InterfaceParticlesFactory() {}
+
+    virtual InterfaceSim* simulation() { return static_cast<InterfaceSim*>(m_parent); }
+
+protected:
+    bool create(const char *name, int count, float x, float y, float z);
+};
+
+class InterfacePlaneFactory : public PlaneFactory
+{
+public:
+    InterfacePlaneFactory(Simulation *parent) : PlaneFactory(parent) {}
+    virtual ~InterfacePlaneFactory() {}
+
+    virtual InterfaceSim* simulation() { return static_cast<InterfaceSim*>(m_parent); }
+
+protected:
+    bool create(const char *name, float x, float y, float z);
+};
+
+class InterfaceCapsuleFactory : public CapsuleFactory
+{
+public:
+    InterfaceCapsuleFactory(Simulation *parent) : CapsuleFactory(parent) {}
+    virtual ~InterfaceCapsuleFactory() {}
+
+    virtual InterfaceSim* simulation() { return static_cast<InterfaceSim*>(m_parent); }
+
+protected:
+    bool create(const char *name, float x, float y, float z);
+};
+
+class InterfaceCylinderFactory : public CylinderFactory
+{
+public:
+    InterfaceCylinderFactory(Simulation *parent) : CylinderFactory(parent) {}
+    virtual ~InterfaceCylinderFactory() {}
+
+    virtual InterfaceSim* simulation() { return static_cast<InterfaceSim*>(m_parent); }
+
+protected:
+    bool create(const char *name, float x, float y, float z);
+};
+
+class InterfaceHeightfieldFactory : public HeightfieldFactory
+{
+public:
+    InterfaceHeightfieldFactory(Simulation *parent) : HeightfieldFactory(parent) {}
+    virtual ~InterfaceHeightfieldFactory() {}
+
+    virtual InterfaceSim* simulation() { return static_cast<InterfaceSim*>(m_parent); }
+
+protected:
+    bool create(const char *name, int columns, int rows,
+                float x, float y, float z);
+};
+
+class InterfaceCompositeFactory : public CompositeFactory
+{
+public:
+    InterfaceCompositeFactory(Simulation *parent) : CompositeFactory(parent) {}
+    virtual ~InterfaceCompositeFactory() {}
+
+    virtual InterfaceSim* simulation() { return static_cast<InterfaceSim*>(m_parent); }
+
+protected:
+    bool create(const char *name, float x, float y, float z);
+};
+
+class InterfaceFieldFactory : public FieldFactory
+{
+public:
+    InterfaceFieldFactory(Simulation *parent) : FieldFactory(parent) {}
+    virtual ~InterfaceFieldFactory() {}
+
+    virtual InterfaceSim* simulation() { return static_cast<InterfaceSim*>(m_parent); }
+
+protected:
+    bool create(const char *name, const char *type, float x, float y, float z);
+};
+
 class InterfaceHingeFactory : public HingeFactory
 {
 public:
@@ -261,6 +367,37 @@ protected:
                 double a2x, double a2y, double a2z);
 };
 
+//! Queries are answered by the physics simulation.
+class InterfaceSpatialQuery : public SpatialQuery
+{
+public:
+    InterfaceSpatialQuery(Simulation *parent) : SpatialQuery(parent) {}
+    virtual ~InterfaceSpatialQuery() {}
+
+protected:
+    void raycast(float x, float y, float z,
+                 float dx, float dy, float dz, float length)
+    {
+        simulation()->sendtotype(Simulation::ST_PHYSICS, 0,
+                                 "/world/query/raycast", "fffffff",
+                                 x, y, z, dx, dy, dz, length);
+    }
+
+    void sphere(float x, float y, float z, float radius)
+    {
+        simulation()->sendtotype(Simulation::ST_PHYSICS, 0,
+                                 "/world/query/sphere", "ffff",
+                                 x, y, z, radius);
+    }
+
+    void nearest(float x, float y, float z, int count)
+    {
+        simulation()->sendtotype(Simulation::ST_PHYSICS, 0,
+                                 "/world/query/nearest", "fffi",
+                                 x, y, z, count);
+    }
+};
+
 class OscSphereInterface : public OscSphere
 {
 public:
@@ -274,6 +411,7 @@ public:
             m_radius.setGetCallback(on_get_radius, this);
             m_force.setGetCallback(on_get_force, this);
             m_mass.setGetCallback(on_get_mass, this);
+            m_charge.setGetCallback(on_get_charge, this);
             m_density.setGetCallback(on_get_density, this);
             m_friction_static.setGetCallback(on_get_friction_static, this);
             m_friction_dynamic.setGetCallback(on_get_friction_dynamic, this);
@@ -315,6 +453,7 @@ protected:
     FWD_OSCSCALAR(radius,Simulation::ST_PHYSICS);
     FWD_OSCVECTOR3(force,Simulation::ST_PHYSICS);
     FWD_OSCSCALAR(mass,Simulation::ST_PHYSICS);
+    FWD_OSCSCALAR(charge,Simulation::ST_PHYSICS);
     FWD_OSCSCALAR(density,Simulation::ST_PHYSICS);
     FWD_OSCSCALAR(friction_dynamic,Simulation::ST_HAPTICS);
     FWD_OSCSCALAR(friction_static,Simulation::ST_HAPTICS);
@@ -338,6 +477,7 @@ public:
             m_force.setGetCallback(on_get_force, this);
             m_size.setGetCallback(on_get_size, this);
             m_mass.setGetCallback(on_get_mass, this);
+            m_charge.setGetCallback(on_get_charge, this);
             m_density.setGetCallback(on_get_density, this);
             m_friction_static.setGetCallback(on_get_friction_static, this);
             m_friction_dynamic.setGetCallback(on_get_friction_dynamic, this);
@@ -377,6 +517,7 @@ protected:
     FWD_OSCVECTOR3(force,Simulation::ST_PHYSICS);
     FWD_OSCVECTOR3(size,Simulation::ST_PHYSICS);
     FWD_OSCSCALAR(mass,Simulation::ST_PHYSICS);
+    FWD_OSCSCALAR(charge,Simulation::ST_PHYSICS);
     FWD_OSCSCALAR(density,Simulation::ST_PHYSICS);
     FWD_OSCSCALAR(friction_dynamic,Simulation::ST_HAPTICS);
     FWD_OSCSCALAR(friction_static,Simulation::ST_HAPTICS);
@@ -400,7 +541,9 @@ public:
             m_color.setGetCallback(on_get_color, this);
             m_force.setGetCallback(on_get_force, this);
             m_size.setGetCallback(on_get_size, this);
+            m_convex.setGetCallback(on_get_convex, this);
             m_mass.setGetCallback(on_get_mass, this);
+            m_charge.setGetCallback(on_get_charge, this);
             m_density.setGetCallback(on_get_density, this);
             m_friction_static.setGetCallback(on_get_friction_static, this);
             m_friction_dynamic.setGetCallback(on_get_friction_dynamic, this);
@@ -439,7 +582,151 @@ protected:
     FWD_OSCVECTOR3(color,Simulation::ST_VISUAL);
     FWD_OSCVECTOR3(force,Simulation::ST_PHYSICS);
     FWD_OSCVECTOR3(size,Simulation::ST_PHYSICS);
+    FWD_OSCBOOLEAN(convex,Simulation::ST_PHYSICS);
+    FWD_OSCSCALAR(mass,Simulation::ST_PHYSICS);
+    FWD_OSCSCALAR(charge,Simulation::ST_PHYSICS);
+    FWD_OSCSCALAR(density,Simulation::ST_PHYSICS);
+    FWD_OSCSCALAR(friction_dynamic,Simulation::ST_HAPTICS);
+    FWD_OSCSCALAR(friction_static,Simulation::ST_HAPTICS);
+    FWD_OSCSCALAR(collide,Simulation::ST_PHYSICS);
+    FWD_OSCBOOLEAN(visible,Simulation::ST_VISUAL);
+    FWD_OSCSCALAR(stiffness,Simulation::ST_HAPTICS);
+    FWD_OSCSTRING(texture_image,Simulation::ST_HAPTICS);
+    FWD_OSCSCALAR(texture_level,Simulation::ST_HAPTICS);
+};
+
+class OscParticlesInterface : public OscParticles
+{
+public:
+    OscParticlesInterface(cGenericObject *p, const char *name, int count,
+                          OscBase *parent=NULL)
+        : OscParticles(p, name, count, parent)
+        {
+            m_position.setGetCallback(on_get_position, this);
+            m_velocity.setGetCallback(on_get_velocity, this);
+            m_color.setGetCallback(on_get_color, this);
+            m_radius.setGetCallback(on_get_radius, this);
+            m_mass.setGetCallback(on_get_mass, this);
+            m_charge.setGetCallback(on_get_charge, this);
+            m_density.setGetCallback(on_get_density, this);
+            m_visible.setGetCallback(on_get_visible, this);
+
+            m_position.m_magnitude.setGetCallback(on_get_position_mag, this);
+            m_velocity.m_magnitude.setGetCallback(on_get_velocity_mag, this);
+
+            addHandler("positions/get", "",
+                       OscParticlesInterface::positions_get_handler);
+        }
+    virtual ~OscParticlesInterface() {}
+
+    virtual void on_destroy() {
+        simulation()->send(0, (path()+"/destroy").c_str(), "");
+        OscParticles::on_destroy();
+    }
+
+    static int positions_get_handler(const char *path, const char *types,
+                                     lo_arg **argv, int argc, void *data,
+                                     void *user_data);
+
+protected:
+    FWD_OSCVECTOR3(position,Simulation::ST_PHYSICS);
+    FWD_OSCVECTOR3(velocity,Simulation::ST_PHYSICS);
+    FWD_OSCVECTOR3(color,Simulation::ST_VISUAL);
+    FWD_OSCVECTOR3(force,Simulation::ST_PHYSICS);
+    FWD_OSCSCALAR(radius,Simulation::ST_PHYSICS);
+    FWD_OSCSCALAR(mass,Simulation::ST_PHYSICS);
+    FWD_OSCSCALAR(charge,Simulation::ST_PHYSICS);
+    FWD_OSCSCALAR(density,Simulation::ST_PHYSICS);
+    FWD_OSCBOOLEAN(visible,Simulation::ST_VISUAL);
+};
+
+class OscPlaneInterface : public OscPlane
+{
+public:
+    OscPlaneInterface(cGenericObject *p, const char *name, OscBase *parent=NULL)
+        : OscPlane(p, name, parent)
+        {
+            m_position.setGetCallback(on_get_position, this);
+            m_normal.setGetCallback(on_get_normal, this);
+            m_color.setGetCallback(on_get_color, this);
+            m_friction_static.setGetCallback(on_get_friction_static, this);
+            m_friction_dynamic.setGetCallback(on_get_friction_dynamic, this);
+            m_visible.setGetCallback(on_get_visible, this);
+            m_stiffness.setGetCallback(on_get_stiffness, this);
+            m_texture_image.setGetCallback(on_get_texture_image, this);
+            m_texture_level.setGetCallback(on_get_texture_level, this);
+        }
+    virtual ~OscPlaneInterface() {}
+
+    virtual void on_destroy() {
+        simulation()->send(0, (path()+"/destroy").c_str(), "");
+        OscPlane::on_destroy();
+    }
+
+protected:
+    FWD_OSCVECTOR3(position,Simulation::ST_PHYSICS);
+    FWD_OSCVECTOR3(normal,Simulation::ST_PHYSICS);
+    FWD_OSCVECTOR3(color,Simulation::ST_VISUAL);
+    FWD_OSCSCALAR(friction_dynamic,Simulation::ST_HAPTICS);
+    FWD_OSCSCALAR(friction_static,Simulation::ST_HAPTICS);
+    FWD_OSCSCALAR(collide,Simulation::ST_PHYSICS);
+    FWD_OSCBOOLEAN(visible,Simulation::ST_VISUAL);
+    FWD_OSCSCALAR(stiffness,Simulation::ST_HAPTICS);
+    FWD_OSCSTRING(texture_image,Simulation::ST_HAPTICS);
+    FWD_OSCSCALAR(texture_level,Simulation::ST_HAPTICS);
+};
+
+class OscCapsuleInterface : public OscCapsule
+{
+public:
+    OscCapsuleInterface(cGenericObject *p, const char *name, OscBase *parent=NULL)
+        : OscCapsule(p, name, parent)
+        {
+            m_position.setGetCallback(on_get_position, this);
+            m_velocity.setGetCallback(on_get_velocity, this);
+            m_accel.setGetCallback(on_get_accel, this);
+            m_color.setGetCallback(on_get_color, this);
+            m_radius.setGetCallback(on_get_radius, this);
+            m_length.setGetCallback(on_get_length, this);
+            m_force.setGetCallback(on_get_force, this);
+            m_mass.setGetCallback(on_get_mass, this);
+            m_charge.setGetCallback(on_get_charge, this);
+            m_density.setGetCallback(on_get_density, this);
+            m_friction_static.setGetCallback(on_get_friction_static, this);
+            m_friction_dynamic.setGetCallback(on_get_friction_dynamic, this);
+            m_visible.setGetCallback(on_get_visible, this);
+            m_stiffness.setGetCallback(on_get_stiffness, this);
+            m_texture_image.setGetCallback(on_get_texture_image, this);
+            m_texture_level.setGetCallback(on_get_texture_level, this);
+
+            m_position.m_magnitude.setGetCallback(on_get_position_mag, this);
+            m_velocity.m_magnitude.setGetCallback(on_get_velocity_mag, this);
+            m_accel.m_magnitude.setGetCallback(on_get_accel_mag, this);
+            m_force.m_magnitude.setGetCallback(on_get_force_mag, this);
+        }
+    virtual ~OscCapsuleInterface() {}
+
+    virtual void on_grab() {
+        simulation()->send(0, (path()+"/grab").c_str(), "");
+        OscCapsule::on_grab();
+    }
+
+    virtual void on_destroy() {
+        simulation()->send(0, (path()+"/destroy").c_str(), "");
+        OscCapsule::on_destroy();
+    }
+
+protected:
+    FWD_OSCVECTOR3(position,Simulation::ST_PHYSICS);
+    FWD_OSCVECTOR3(velocity,Simulation::ST_PHYSICS);
+    FWD_OSCVECTOR3(accel,Simulation::ST_PHYSICS);
+    FWD_OSCMATRIX3(rotation,Simulation::ST_PHYSICS);
+    FWD_OSCVECTOR3(color,Simulation::ST_VISUAL);
+    FWD_OSCSCALAR(radius,Simulation::ST_PHYSICS);
+    FWD_OSCSCALAR(length,Simulation::ST_PHYSICS);
+    FWD_OSCVECTOR3(force,Simulation::ST_PHYSICS);
     FWD_OSCSCALAR(mass,Simulation::ST_PHYSICS);
+    FWD_OSCSCALAR(charge,Simulation::ST_PHYSICS);
     FWD_OSCSCALAR(density,Simulation::ST_PHYSICS);
     FWD_OSCSCALAR(friction_dynamic,Simulation::ST_HAPTICS);
     FWD_OSCSCALAR(friction_static,Simulation::ST_HAPTICS);
@@ -450,6 +737,193 @@ protected:
     FWD_OSCSCALAR(texture_level,Simulation::ST_HAPTICS);
 };
 
+class OscCylinderInterface : public OscCylinder
+{
+public:
+    OscCylinderInterface(cGenericObject *p, const char *name, OscBase *parent=NULL)
+        : OscCylinder(p, name, parent)
+        {
+            m_position.setGetCallback(on_get_position, this);
+            m_velocity.setGetCallback(on_get_velocity, this);
+            m_accel.setGetCallback(on_get_accel, this);
+            m_color.setGetCallback(on_get_color, this);
+            m_radius.setGetCallback(on_get_radius, this);
+            m_length.setGetCallback(on_get_length, this);
+            m_force.setGetCallback(on_get_force, this);
+            m_mass.setGetCallback(on_get_mass, this);
+            m_charge.setGetCallback(on_get_charge, this);
+            m_density.setGetCallback(on_get_density, this);
+            m_friction_static.setGetCallback(on_get_friction_static, this);
+            m_friction_dynamic.setGetCallback(on_get_friction_dynamic, this);
+            m_visible.setGetCallback(on_get_visible, this);
+            m_stiffness.setGetCallback(on_get_stiffness, this);
+            m_texture_image.setGetCallback(on_get_texture_image, this);
+            m_texture_level.setGetCallback(on_get_texture_level, this);
+
+            m_position.m_magnitude.setGetCallback(on_get_position_mag, this);
+            m_velocity.m_magnitude.setGetCallback(on_get_velocity_mag, this);
+            m_accel.m_magnitude.setGetCallback(on_get_accel_mag, this);
+            m_force.m_magnitude.setGetCallback(on_get_force_mag, this);
+        }
+    virtual ~OscCylinderInterface() {}
+
+    virtual void on_grab() {
+        simulation()->send(0, (path()+"/grab").c_str(), "");
+        OscCylinder::on_grab();
+    }
+
+    virtual void on_destroy() {
+        simulation()->send(0, (path()+"/destroy").c_str(), "");
+        OscCylinder::on_destroy();
+    }
+
+protected:
+    FWD_OSCVECTOR3(position,Simulation::ST_PHYSICS);
+    FWD_OSCVECTOR3(velocity,Simulation::ST_PHYSICS);
+    FWD_OSCVECTOR3(accel,Simulation::ST_PHYSICS);
+    FWD_OSCMATRIX3(rotation,Simulation::ST_PHYSICS);
+    FWD_OSCVECTOR3(color,Simulation::ST_VISUAL);
+    FWD_OSCSCALAR(radius,Simulation::ST_PHYSICS);
+    FWD_OSCSCALAR(length,Simulation::ST_PHYSICS);
+    FWD_OSCVECTOR3(force,Simulation::ST_PHYSICS);
+    FWD_OSCSCALAR(mass,Simulation::ST_PHYSICS);
+    FWD_OSCSCALAR(charge,Simulation::ST_PHYSICS);
+    FWD_OSCSCALAR(density,Simulation::ST_PHYSICS);
+    FWD_OSCSCALAR(friction_dynamic,Simulation::ST_HAPTICS);
+    FWD_OSCSCALAR(friction_static,Simulation::ST_HAPTICS);
+    FWD_OSCSCALAR(collide,Simulation::ST_PHYSICS);
+    FWD_OSCBOOLEAN(visible,Simulation::ST_VISUAL);
+    FWD_OSCSCALAR(stiffness,Simulation::ST_HAPTICS);
+    FWD_OSCSTRING(texture_image,Simulation::ST_HAPTICS);
+    FWD_OSCSCALAR(texture_level,Simulation::ST_HAPTICS);
+};
+
+class OscHeightfieldInterface : public OscHeightfield
+{
+public:
+    OscHeightfieldInterface(cGenericObject *p, const char *name, int columns,
+                            int rows, OscBase *parent=NULL)
+        : OscHeightfield(p, name, columns, rows, parent)
+        {
+            m_position.setGetCallback(on_get_position, this);
+            m_size.setGetCallback(on_get_size, this);
+            m_color.setGetCallback(on_get_color, this);
+            m_friction_static.setGetCallback(on_get_friction_static, this);
+            m_friction_dynamic.setGetCallback(on_get_friction_dynamic, this);
+            m_visible.setGetCallback(on_get_visible, this);
+            m_stiffness.setGetCallback(on_get_stiffness, this);
+            m_texture_image.setGetCallback(on_get_texture_image, this);
+            m_texture_level.setGetCallback(on_get_texture_level, this);
+        }
+    virtual ~OscHeightfieldInterface() {}
+
+    virtual void on_destroy() {
+        simulation()->send(0, (path()+"/destroy").c_str(), "");
+        OscHeightfield::on_destroy();
+    }
+
+protected:
+    virtual void on_heights(int first, int count);
+
+    FWD_OSCVECTOR3(position,Simulation::ST_PHYSICS);
+    FWD_OSCMATRIX3(rotation,Simulation::ST_PHYSICS);
+    FWD_OSCVECTOR3(size,Simulation::ST_PHYSICS);
+    FWD_OSCVECTOR3(color,Simulation::ST_VISUAL);
+    FWD_OSCSCALAR(friction_dynamic,Simulation::ST_HAPTICS);
+    FWD_OSCSCALAR(friction_static,Simulation::ST_HAPTICS);
+    FWD_OSCSCALAR(collide,Simulation::ST_PHYSICS);
+    FWD_OSCBOOLEAN(visible,Simulation::ST_VISUAL);
+    FWD_OSCSCALAR(stiffness,Simulation::ST_HAPTICS);
+    FWD_OSCSTRING(texture_image,Simulation::ST_HAPTICS);
+    FWD_OSCSCALAR(texture_level,Simulation::ST_HAPTICS);
+};
+
+class OscCompositeInterface : public OscComposite
+{
+public:
+    OscCompositeInterface(cGenericObject *p, const char *name, OscBase *parent=NULL)
+        : OscComposite(p, name, parent)
+        {
+            m_position.setGetCallback(on_get_position, this);
+            m_velocity.setGetCallback(on_get_velocity, this);
+            m_accel.setGetCallback(on_get_accel, this);
+            m_force.setGetCallback(on_get_force, this);
+            m_mass.setGetCallback(on_get_mass, this);
+            m_charge.setGetCallback(on_get_charge, this);
+
+            m_position.m_magnitude.setGetCallback(on_get_position_mag, this);
+            m_velocity.m_magnitude.setGetCallback(on_get_velocity_mag, this);
+            m_accel.m_magnitude.setGetCallback(on_get_accel_mag, this);
+            m_force.m_magnitude.setGetCallback(on_get_force_mag, this);
+        }
+    virtual ~OscCompositeInterface() {}
+
+    virtual void on_grab() {
+        simulation()->send(0, (path()+"/grab").c_str(), "");
+        OscComposite::on_grab();
+    }
+
+    virtual void on_destroy() {
+        simulation()->send(0, (path()+"/destroy").c_str(), "");
+        OscComposite::on_destroy();
+    }
+
+protected:
+    // Composites exist only in the physics simulation.
+    virtual void on_add(const char *name) {
+        simulation()->sendtotype(Simulation::ST_PHYSICS, 0,
+                                 (path()+"/add").c_str(), "s", name);
+    }
+    virtual void on_remove(const char *name) {
+        simulation()->sendtotype(Simulation::ST_PHYSICS, 0,
+                                 (path()+"/remove").c_str(), "s", name);
+    }
+
+    FWD_OSCVECTOR3(position,Simulation::ST_PHYSICS);
+    FWD_OSCVECTOR3(velocity,Simulation::ST_PHYSICS);
+    FWD_OSCVECTOR3(accel,Simulation::ST_PHYSICS);
+    FWD_OSCMATRIX3(rotation,Simulation::ST_PHYSICS);
+    FWD_OSCVECTOR3(force,Simulation::ST_PHYSICS);
+    FWD_OSCSCALAR(mass,Simulation::ST_PHYSICS);
+    FWD_OSCSCALAR(charge,Simulation::ST_PHYSICS);
+};
+
+class OscFieldInterface : public OscField
+{
+public:
+    OscFieldInterface(const char *name, FieldType type, OscBase *parent=NULL)
+        : OscField(NULL, name, type, parent)
+        {
+            m_position.setGetCallback(on_get_position, this);
+            m_velocity.setGetCallback(on_get_velocity, this);
+            m_strength.setGetCallback(on_get_strength, this);
+            m_radius.setGetCallback(on_get_radius, this);
+            m_falloff.setGetCallback(on_get_falloff, this);
+            m_axis.setGetCallback(on_get_axis, this);
+            m_frequency.setGetCallback(on_get_frequency, this);
+
+            m_position.m_magnitude.setGetCallback(on_get_position_mag, this);
+            m_velocity.m_magnitude.setGetCallback(on_get_velocity_mag, this);
+            m_axis.m_magnitude.setGetCallback(on_get_axis_mag, this);
+        }
+    virtual ~OscFieldInterface() {}
+
+    virtual void on_destroy() {
+        simulation()->send(0, (path()+"/destroy").c_str(), "");
+        OscField::on_destroy();
+    }
+
+protected:
+    // Fields exist only in the physics simulation.
+    FWD_OSCVECTOR3(position,Simulation::ST_PHYSICS);
+    FWD_OSCVECTOR3(velocity,Simulation::ST_PHYSICS);
+    FWD_OSCSCALAR(strength,Simulation::ST_PHYSICS);
+    FWD_OSCSCALAR(radius,Simulation::ST_PHYSICS);
+    FWD_OSCSCALAR(falloff,Simulation::ST_PHYSICS);
+    FWD_OSCVECTOR3(axis,Simulation::ST_PHYSICS);
+    FWD_OSCSCALAR(frequency,Simulation::ST_PHYSICS);
+};
+
 class OscCameraInterface : public OscCamera
 {
 public:
@@ -518,6 +992,8 @@ public:
 protected:
     FWD_OSCSCALAR(stiffness,Simulation::ST_PHYSICS);
     FWD_OSCSCALAR(damping,Simulation::ST_PHYSICS);
+    FWD_OSCSCALAR(offset,Simulation::ST_PHYSICS);
+    FWD_OSCBOOLEAN(implicit,Simulation::ST_PHYSICS);
 };
 
 class OscHingeInterface : public OscHinge
@@ -0,0 +1,326 @@
+// -*- mode:c++; indent-tabs-mode:nil; c-basic-offset:4; -*-
+//======================================================================================
+/*
+    This file is part of DIMPLE, the Dynamic Interactive Musically PhysicaL Environment,
+
+    This code is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License("GPL") version 2
+    as published by the Free Software Foundation.  See the file LICENSE
+    for more information.
+
+    sinclair@music.mcgill.ca
+    http://www.music.mcgill.ca/~sinclair/content/dimple
+*/
+//======================================================================================
+
+#ifndef _MESH_CACHE_H_
+#define _MESH_CACHE_H_
+
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/stat.h>
+
+#ifndef WIN32
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <world/CMultiMesh.h>
+
+using namespace chai3d;
+
+/*! Class for storing parsed mesh files in a binary form that can be
+ *  loaded again without parsing.  The cache of a file is written
+ *  beside it, with the extension ".dmesh" appended, and records the
+ *  size and modification time of the file it was made from, so a
+ *  stale cache is ignored.
+ *
+ *  The format is the native layout of the arrays CHAI keeps for each
+ *  mesh, so a cache file is mapped into memory and copied straight
+ *  into the meshes.  It is not portable between machines of
+ *  different byte order.
+ *
+ *  The material of each mesh is kept, but meshes with textures or
+ *  vertex colors are not cached, since the textures are loaded by
+ *  the file's own loader and vertex colors are not stored.  Collision
+ *  trees are not stored, since CHAI has no way to restore one; they
+ *  are built for each size a mesh is used at. */
+
+class MeshCache
+{
+  public:
+    enum { VERSION = 2 };
+
+    //! Return the path of the cache of a mesh file.
+    static std::string path(const std::string &source)
+        { return source + ".dmesh"; }
+
+    /*! Load a mesh from the cache of a file into an empty mesh.
+     *  Returns false if there is no up-to-date cache. */
+    static bool load(const std::string &source, cMultiMesh *mesh)
+    {
+        Header expected;
+        if (!makeHeader(source, expected))
+            return false;
+
+        MappedFile file(path(source));
+        const char *p = file.data();
+        const char *end = p + file.size();
+        if (!p || file.size() < sizeof(Header))
+            return false;
+
+        Header h;
+        memcpy(&h, p, sizeof(h));
+        p += sizeof(h);
+        if (memcmp(h.magic, expected.magic, sizeof(h.magic))
+            || h.version != expected.version
+            || h.sourceSize != expected.sourceSize
+            || h.sourceTime != expected.sourceTime)
+            return false;
+
+        for (uint32_t m=0; m < h.meshes; m++)
+        {
+            MeshHeader mh;
+            if (end - p < (long)sizeof(mh))
+                return false;
+            memcpy(&mh, p, sizeof(mh));
+            p += sizeof(mh);
+
+            size_t floats = (size_t)mh.vertices * (mh.texcoords ? 8 : 6);
+            size_t bytes = floats*sizeof(float)
+                + (size_t)mh.triangles*3*sizeof(uint32_t);
+            if ((size_t)(end - p) < bytes)
+                return false;
+
+            // Every field is 4 bytes, so the arrays are aligned
+            // within the mapping.
+            const float *pos = reinterpret_cast<const float*>(p);
+            const float *normal = pos + mh.vertices*3;
+            const float *tex = normal + mh.vertices*3;
+            const uint32_t *t = reinterpret_cast<const uint32_t*>(pos + floats);
+            p += bytes;
+
+            cMesh *cm = mesh->newMesh();
+            getColor(mh.ambient, cm->m_material->m_ambient);
+            getColor(mh.diffuse, cm->m_material->m_diffuse);
+            getColor(mh.specular, cm->m_material->m_specular);
+            getColor(mh.emission, cm->m_material->m_emission);
+            cm->m_material->setShininess(mh.shininess);
+            cm->setUseMaterial(mh.useMaterial != 0);
+            cm->setUseTransparency(mh.useTransparency != 0);
+
+            for (uint32_t i=0; i < mh.vertices; i++) {
+                unsigned int n = cm->newVertex(pos[i*3], pos[i*3+1], pos[i*3+2]);
+                cm->m_vertices->setNormal(n, normal[i*3], normal[i*3+1],
+                                          normal[i*3+2]);
+                if (mh.texcoords)
+                    cm->m_vertices->setTexCoord(n, tex[i*2], tex[i*2+1]);
+            }
+            for (uint32_t i=0; i < mh.triangles; i++) {
+                if (t[i*3] >= mh.vertices || t[i*3+1] >= mh.vertices
+                    || t[i*3+2] >= mh.vertices)
+                    return false;
+                cm->newTriangle(t[i*3], t[i*3+1], t[i*3+2]);
+            }
+        }
+        return true;
+    }
+
+    //! Return true if a mesh can be stored in a cache.
+    static bool cacheable(cMultiMesh *mesh)
+    {
+        for (int m=0; m < mesh->getNumMeshes(); m++) {
+            cMesh *cm = mesh->getMesh(m);
+            if (cm->m_texture || cm->getUseVertexColors())
+                return false;
+        }
+        return true;
+    }
+
+    /*! Write the cache of a file from the mesh loaded from it.
+     *  Returns false if the mesh cannot be cached or the cache cannot
+     *  be written, which is not an error for the caller. */
+    static bool save(const std::string &source, cMultiMesh *mesh)
+    {
+        Header h;
+        if (!cacheable(mesh) || !makeHeader(source, h))
+            return false;
+        h.meshes = mesh->getNumMeshes();
+
+        // Written under another name and renamed, so that a reader
+        // never sees a partial file.
+        std::string tmp(path(source) + ".tmp");
+        FILE *f = fopen(tmp.c_str(), "wb");
+        if (!f)
+            return false;
+
+        bool ok = fwrite(&h, sizeof(h), 1, f) == 1;
+        for (uint32_t m=0; ok && m < h.meshes; m++)
+        {
+            cMesh *cm = mesh->getMesh(m);
+            MeshHeader mh;
+            mh.vertices = cm->getNumVertices();
+            mh.triangles = cm->getNumTriangles();
+            mh.texcoords = 1;
+            putColor(mh.ambient, cm->m_material->m_ambient);
+            putColor(mh.diffuse, cm->m_material->m_diffuse);
+            putColor(mh.specular, cm->m_material->m_specular);
+            putColor(mh.emission, cm->m_material->m_emission);
+            mh.shininess = cm->m_material->getShininess();
+            mh.useMaterial = cm->getUseMaterial();
+            mh.useTransparency = cm->getUseTransparency();
+
+            std::vector<float> v;
+            v.reserve(mh.vertices*8);
+            for (uint32_t i=0; i < mh.vertices; i++) {
+                cVector3d p(cm->m_vertices->getLocalPos(i));
+                v.push_back(p.x()); v.push_back(p.y()); v.push_back(p.z());
+            }
+            for (uint32_t i=0; i < mh.vertices; i++) {
+                cVector3d n(cm->m_vertices->getNormal(i));
+                v.push_back(n.x()); v.push_back(n.y()); v.push_back(n.z());
+            }
+            for (uint32_t i=0; i < mh.vertices; i++) {
+                cVector3d t(cm->m_vertices->getTexCoord(i));
+                v.push_back(t.x()); v.push_back(t.y());
+            }
+
+            std::vector<uint32_t> t;
+            t.reserve(mh.triangles*3);
+            for (uint32_t i=0; i < mh.triangles; i++) {
+                t.push_back(cm->m_triangles->getVertexIndex0(i));
+                t.push_back(cm->m_triangles->getVertexIndex1(i));
+                t.push_back(cm->m_triangles->getVertexIndex2(i));
+            }
+
+            ok = fwrite(&mh, sizeof(mh), 1, f) == 1
+                && (v.empty() || fwrite(&v[0], sizeof(float), v.size(), f) == v.size())
+                && (t.empty() || fwrite(&t[0], sizeof(uint32_t), t.size(), f) == t.size());
+        }
+
+        if (fclose(f) || !ok) {
+            remove(tmp.c_str());
+            return false;
+        }
+
+#ifdef WIN32
+        remove(path(source).c_str());
+#endif
+        if (rename(tmp.c_str(), path(source).c_str())) {
+            remove(tmp.c_str());
+            return false;
+        }
+        return true;
+    }
+
+  protected:
+    struct Header
+    {
+        char magic[8];
+        uint64_t sourceSize;
+        int64_t sourceTime;
+        uint32_t version;
+        uint32_t meshes;
+    };
+
+    struct MeshHeader
+    {
+        uint32_t vertices;
+        uint32_t triangles;
+        //! Non-zero if texture coordinates follow the normals.
+        uint32_t texcoords;
+        float ambient[4];
+        float diffuse[4];
+        float specular[4];
+        float emission[4];
+        uint32_t shininess;
+        uint32_t useMaterial;
+        uint32_t useTransparency;
+    };
+
+    static void putColor(float *dest, const cColorf &c)
+    {
+        dest[0] = c.getR();
+        dest[1] = c.getG();
+        dest[2] = c.getB();
+        dest[3] = c.getA();
+    }
+
+    static void getColor(const float *src, cColorf &c)
+        { c.set(src[0], src[1], src[2], src[3]); }
+
+    static bool makeHeader(const std::string &source, Header &h)
+    {
+        struct stat st;
+        if (stat(source.c_str(), &st))
+            return false;
+
+        memset(&h, 0, sizeof(h));
+        memcpy(h.magic, "DIMPLEM", 8);
+        h.version = VERSION;
+        h.sourceSize = st.st_size;
+        h.sourceTime = st.st_mtime;
+        return true;
+    }
+
+    //! A read-only file mapped into memory, or read where mmap is
+    //! unavailable.
+    class MappedFile
+    {
+      public:
+        MappedFile(const std::string &path) : m_data(NULL), m_size(0)
+        {
+#ifndef WIN32
+            int fd = open(path.c_str(), O_RDONLY);
+            if (fd < 0)
+                return;
+            struct stat st;
+            if (fstat(fd, &st) == 0 && st.st_size > 0) {
+                void *p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (p != MAP_FAILED) {
+                    m_data = static_cast<const char*>(p);
+                    m_size = st.st_size;
+                }
+            }
+            ::close(fd);
+#else
+            FILE *f = fopen(path.c_str(), "rb");
+            if (!f)
+                return;
+            char buffer[65536];
+            size_t n;
+            while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0)
+                m_buffer.insert(m_buffer.end(), buffer, buffer+n);
+            fclose(f);
+            if (!m_buffer.empty()) {
+                m_data = &m_buffer[0];
+                m_size = m_buffer.size();
+            }
+#endif
+        }
+
+        ~MappedFile()
+        {
+#ifndef WIN32
+            if (m_data)
+                munmap(const_cast<char*>(m_data), m_size);
+#endif
+        }
+
+        const char *data() { return m_data; }
+        size_t size() { return m_size; }
+
+      protected:
+        const char *m_data;
+        size_t m_size;
+#ifdef WIN32
+        std::vector<char> m_buffer;
+#endif
+    };
+};
+
+#endif // _MESH_CACHE_H_
@@ -0,0 +1,77 @@
+// -*- mode:c++; indent-tabs-mode:nil; c-basic-offset:4; -*-
+//======================================================================================
+/*
+    This file is part of DIMPLE, the Dynamic Interactive Musically PhysicaL Environment,
+
+    This code is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License("GPL") version 2
+    as published by the Free Software Foundation.  See the file LICENSE
+    for more information.
+
+    sinclair@music.mcgill.ca
+    http://www.music.mcgill.ca/~sinclair/content/dimple
+*/
+//======================================================================================
+
+#ifndef _OBJECT_POOL_H_
+#define _OBJECT_POOL_H_
+
+#include <new>
+#include <vector>
+#include <cstdlib>
+
+/*! Base class giving T a pool of memory blocks left by destroyed
+ *  objects of the same type, so that objects which are created and
+ *  destroyed frequently do not go back to the heap each time.
+ *
+ *  Each simulation creates and destroys its objects in its own
+ *  thread, so pools are kept per thread and need no locking.  Blocks
+ *  of classes derived from T, which have a different size, are not
+ *  pooled. */
+
+template <class T>
+class Pooled
+{
+  public:
+    //! Maximum number of free blocks kept per thread.
+    enum { MAX_FREE = 1024 };
+
+    static void *operator new(size_t size)
+    {
+        std::vector<void*> &blocks = freeList().blocks;
+        if (size != sizeof(T) || blocks.empty())
+            return ::operator new(size);
+        void *p = blocks.back();
+        blocks.pop_back();
+        return p;
+    }
+
+    static void operator delete(void *p, size_t size)
+    {
+        std::vector<void*> &blocks = freeList().blocks;
+        if (p && size == sizeof(T) && blocks.size() < MAX_FREE)
+            blocks.push_back(p);
+        else
+            ::operator delete(p);
+    }
+
+  protected:
+    struct FreeList
+    {
+        std::vector<void*> blocks;
+        ~FreeList()
+        {
+            std::vector<void*>::iterator it;
+            for (it=blocks.begin(); it!=blocks.end(); it++)
+                ::operator delete(*it);
+        }
+    };
+
+    static FreeList &freeList()
+    {
+        static thread_local FreeList list;
+        return list;
+    }
+};
+
+#endif // _OBJECT_POOL_H_
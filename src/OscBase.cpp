@@ -15,6 +15,7 @@
 //======================================================================================
 
 #include <lo/lo.h>
+#include <atomic>
 
 #include "OscBase.h"
 #include "dimple.h"
@@ -24,6 +25,9 @@
 OscBase::OscBase(const char *name, OscBase *parent, lo_server server)
     : m_name(name), m_parent(parent), m_server(server?server:(parent?parent->m_server:NULL))
 {
+    static std::atomic<unsigned long> next_serial(0);
+    m_serial = next_serial++;
+
 #ifdef DEBUG
     m_bTrace = false;
 #endif
@@ -46,23 +50,27 @@ void OscBase::addHandler(const char *methodname, const char* type, lo_method_han
 
     // add it to liblo server and store it
     if (strstr(n.c_str(), "spring")!=0) printf("adding: %s, %s\n", n.c_str(), type);
-    if (lo_server_add_method(m_server, n.c_str(), type, h, this))
+    lo_method lm = lo_server_add_method(m_server, n.c_str(), type, h, this);
+    if (lm)
     {
         method_t m;
         m.name = n;
         m.type = type;
+        m.method = lm;
         m_methods.push_back(m);
     }
 }
 
 OscBase::~OscBase()
 {
-    // remove all stored OSC methods from the liblo server
+    // Remove all stored OSC methods from the liblo server.  Methods
+    // are removed individually rather than by path, since a new
+    // object of the same name may already have added its own.
     while (m_methods.size()>0) {
         method_t m = m_methods.back();
         m_methods.pop_back();
         if (m_server)
-            lo_server_del_method(m_server, m.name.c_str(), m.type.c_str());
+            lo_server_del_lo_method(m_server, m.method);
     }
 }
 
@@ -41,6 +41,9 @@ public:
 
     OscBase *parent() { return m_parent; }
 
+    //! Return a number giving the order in which objects were created.
+    unsigned long serial() const { return m_serial; }
+
     Simulation *simulation();
 
 #ifdef DEBUG
@@ -65,6 +68,7 @@ protected:
     std::string m_path; // generated on demand, but we cache it here
     OscBase *m_parent;
     lo_server m_server;
+    unsigned long m_serial;
 
     /*! True if this object should output trace messages when compiled
      *  for debug. */
@@ -75,6 +79,7 @@ protected:
     struct method_t {
         std::string name;
         std::string type;
+        lo_method method;
     };
     std::vector <method_t> m_methods;
 
@@ -35,12 +35,18 @@ OscObject::OscObject(cGenericObject* p, const char *name, OscBase *parent)
       m_rotation("rotation", this),
       m_mass("mass", this),
       m_density("density", this),
+      m_charge("charge", this),
       m_collide("collide", this),
       m_visible("visible", this),
       m_stiffness("stiffness", this)
 {
     m_pSpecial = NULL;
 
+    for (int i=0; i < MAX_CONTACTS; i++) {
+        m_contacts[i].object = NULL;
+        m_contacts[i].count = 0;
+    }
+
     // Create handlers for OSC messages
     addHandler("destroy"    , ""   , OscObject::destroy_handler);
     addHandler("grab"       , ""   , OscObject::grab_handler);
@@ -52,6 +58,7 @@ OscObject::OscObject(cGenericObject* p, const char *name, OscBase *parent)
     m_position.setValue(0,0,0);
     m_force.setValue(0,0,0);
     m_density.setValue(100);
+    m_charge.setValue(1);
     m_visible.setValue(true);
     m_stiffness.setValue(1000);
     m_texture_level.setValue(1.0);
@@ -71,52 +78,23 @@ OscObject::OscObject(cGenericObject* p, const char *name, OscBase *parent)
     m_friction_dynamic.setSetCallback(set_friction_dynamic, this);
     m_mass.setSetCallback(set_mass, this);
     m_density.setSetCallback(set_density, this);
+    m_charge.setSetCallback(set_charge, this);
     m_collide.setSetCallback(set_collide, this);
     m_visible.setSetCallback(set_visible, this);
     m_stiffness.setSetCallback(set_stiffness, this);
     m_texture_image.setSetCallback(set_texture_image, this);
     m_texture_level.setSetCallback(set_texture_level, this);
-
-    // If the new object is supposed to be a part of a
-    // composite object, find it and join.
-#if 0 // TODO
-	const char *s;
-    if ((s=strchr(name, '/'))) {
-        char firstname[256];
-        int len = (s-name<255)?(s-name):255;
-        strncpy(firstname, name, len);
-        firstname[len]=0;
-        
-        OscObject *obj = findObject(firstname);
-        OscComposite *parent = dynamic_cast<OscComposite*>(obj);
-        if (!parent) {
-            if (obj) return; // error, parent is not a composite object
-            parent = new OscComposite(firstname);
-            world_objects[firstname] = parent;
-        }
-
-        parent->addChild(this);
-    }
-#endif
 }
 
 //! OscObject destructor.  Destoys any associated constraints.
 OscObject::~OscObject()
 {
-    constraint_list_iterator it = m_constraintList.begin();
-    while (it!=m_constraintList.end()) {
-        /* Remove the constraint from the other object's constraint
-           list before deleting. */
-        OscConstraint *o = *it;
-        if (o->object2()) {
-            if (this==o->object1())
-                o->object2()->m_constraintList.remove(o);
-            else if (this==o->object2())
-                o->object1()->m_constraintList.remove(o);
-        }
-
-        (**it).on_destroy();
-        it++;
+    /* Destroying a constraint removes it from the constraint lists
+       of both its objects. */
+    while (!m_constraintList.empty()) {
+        OscConstraint *c = m_constraintList.front();
+        m_constraintList.pop_front();
+        c->on_destroy();
     }
 
     if (m_pSpecial) delete m_pSpecial;
@@ -125,6 +103,24 @@ OscObject::~OscObject()
                       simulation()->type_str(), c_name()));
 }
 
+bool OscObject::newCollision(OscObject *o, int count)
+{
+    int oldest = 0;
+    for (int i=0; i < MAX_CONTACTS; i++) {
+        if (m_contacts[i].object == o) {
+            bool rc = (m_contacts[i].count != count-1);
+            m_contacts[i].count = count;
+            return rc;
+        }
+        if (m_contacts[i].count < m_contacts[oldest].count)
+            oldest = i;
+    }
+
+    m_contacts[oldest].object = o;
+    m_contacts[oldest].count = count;
+    return true;
+}
+
 //! Inform object that it is in collision with another object.
 //! \return True if this is a new collision
 bool OscObject::collidedWith(OscObject *o, int count)
@@ -148,9 +144,8 @@ void OscObject::on_destroy()
 {
     simulation()->delete_object(*this);
 
-    /* The object's memory is freed in the above delete_object call.
-     * Should it be done here instead? Or perhaps moved to a deleted
-     * objects pool for later garbage collection. */
+    /* The object's memory is freed once the current messages have
+     * been handled, in Simulation::collect_deleted(). */
 
     return;
 }
@@ -169,12 +164,151 @@ OscSphere::OscSphere(cGenericObject* p, const char *name, OscBase* parent)
     m_radius.m_value = 0.01;
 }
 
+OscComposite::OscComposite(cGenericObject* p, const char *name, OscBase* parent)
+    : OscObject(p, name, parent)
+{
+    addHandler("add", "s", OscComposite::add_handler);
+    addHandler("remove", "s", OscComposite::remove_handler);
+}
+
+OscField::OscField(cGenericObject* p, const char *name, FieldType type,
+                   OscBase* parent)
+    : OscObject(p, name, parent), m_strength("strength", this),
+      m_radius("radius", this), m_falloff("falloff", this),
+      m_axis("axis", this), m_frequency("frequency", this), m_type(type)
+{
+    m_strength.setSetCallback(set_strength, this);
+    m_radius.setSetCallback(set_radius, this);
+    m_falloff.setSetCallback(set_falloff, this);
+    m_axis.setSetCallback(set_axis, this);
+    m_frequency.setSetCallback(set_frequency, this);
+    m_strength.m_value = 0;
+    m_radius.m_value = 0;
+    m_falloff.m_value = 1;
+    m_axis.setValue(0, 0, 1, false);
+    m_frequency.m_value = 10;
+}
+
+OscField::FieldType OscField::str_type(const char *type)
+{
+    if (strcmp(type, "radial")==0)
+        return FIELD_RADIAL;
+    if (strcmp(type, "vortex")==0)
+        return FIELD_VORTEX;
+    if (strcmp(type, "drag")==0)
+        return FIELD_DRAG;
+    if (strcmp(type, "noise")==0)
+        return FIELD_NOISE;
+    return FIELD_UNKNOWN;
+}
+
+const char* OscField::type_str(FieldType type)
+{
+    switch (type) {
+    case FIELD_RADIAL: return "radial";
+    case FIELD_VORTEX: return "vortex";
+    case FIELD_DRAG:   return "drag";
+    case FIELD_NOISE:  return "noise";
+    default:           return "unknown";
+    }
+}
+
+OscPlane::OscPlane(cGenericObject* p, const char *name, OscBase* parent)
+    : OscObject(p, name, parent), m_normal("normal", this)
+{
+    m_normal.setSetCallback(set_normal, this);
+    m_normal.setValue(0, 0, 1, false);
+}
+
+OscCapsule::OscCapsule(cGenericObject* p, const char *name, OscBase* parent)
+    : OscObject(p, name, parent), m_radius("radius", this),
+      m_length("length", this)
+{
+    m_radius.setSetCallback(set_radius, this);
+    m_length.setSetCallback(set_length, this);
+    m_radius.m_value = 0.01;
+    m_length.m_value = 0.04;
+}
+
+OscCylinder::OscCylinder(cGenericObject* p, const char *name, OscBase* parent)
+    : OscObject(p, name, parent), m_radius("radius", this),
+      m_length("length", this)
+{
+    m_radius.setSetCallback(set_radius, this);
+    m_length.setSetCallback(set_length, this);
+    m_radius.m_value = 0.01;
+    m_length.m_value = 0.04;
+}
+
+OscHeightfield::OscHeightfield(cGenericObject* p, const char *name,
+                               int columns, int rows, OscBase* parent)
+    : OscObject(p, name, parent), m_size("size", this)
+{
+    m_columns = columns;
+    m_rows = rows;
+    m_heights.resize(columns*rows, 0);
+
+    m_size.setSetCallback(set_size, this);
+    m_size.setValue(1, 1, 1, false);
+
+    addHandler("height", "iif", OscHeightfield::height_handler);
+    addHandler("heights", "ib", OscHeightfield::heights_handler);
+}
+
+//! Set the height of a single grid point.
+int OscHeightfield::height_handler(const char *path, const char *types,
+                                   lo_arg **argv, int argc, void *data,
+                                   void *user_data)
+{
+    OscHeightfield *me = static_cast<OscHeightfield*>(user_data);
+    int column = argv[0]->i;
+    int row = argv[1]->i;
+    if (column < 0 || column >= me->m_columns || row < 0 || row >= me->m_rows)
+        return 0;
+
+    int index = row*me->m_columns + column;
+    me->m_heights[index] = argv[2]->f;
+    me->on_heights(index, 1);
+    return 0;
+}
+
+//! Set consecutive heights, in row order, from a blob of floats.
+int OscHeightfield::heights_handler(const char *path, const char *types,
+                                    lo_arg **argv, int argc, void *data,
+                                    void *user_data)
+{
+    OscHeightfield *me = static_cast<OscHeightfield*>(user_data);
+    int first = argv[0]->i;
+    int n = lo_blob_datasize((lo_blob)argv[1]) / sizeof(float);
+    if (first < 0 || first + n > (int)me->m_heights.size())
+        return 0;
+
+    memcpy(&me->m_heights[first], lo_blob_dataptr((lo_blob)argv[1]),
+           n*sizeof(float));
+    me->on_heights(first, n);
+    return 0;
+}
+
+const int OscParticles::CHUNK_SIZE = 64;
+
+OscParticles::OscParticles(cGenericObject* p, const char *name, int count,
+                           OscBase* parent)
+    : OscObject(p, name, parent), m_radius("radius", this)
+{
+    m_count = count;
+    m_radius.setSetCallback(set_radius, this);
+    m_radius.m_value = 0.005;
+}
+
 OscMesh::OscMesh(cGenericObject *p, const char *name,
                  const char *filename, OscBase *parent)
     : OscObject(p, name, parent),
-      m_size("size", this)
+      m_size("size", this),
+      m_convex("convex", this)
 {
     m_size.setSetCallback(set_size, this);
+    m_convex.setSetCallback(set_convex, this);
+    m_convex.setValue(true, false);
 }
 
 OscCamera::OscCamera(const char *name, OscBase *parent)
@@ -192,11 +326,13 @@ OscResponse::OscResponse(const char* name, OscBase *parent)
     : OscBase(name, parent),
       m_stiffness("stiffness", this),
       m_damping("damping", this),
-      m_offset("offset", this)
+      m_offset("offset", this),
+      m_implicit("implicit", this)
 {
     m_stiffness.setSetCallback(set_stiffness, this);
     m_damping.setSetCallback(set_damping, this);
     m_offset.setSetCallback(set_offset, this);
+    m_implicit.setSetCallback(set_implicit, this);
 
     addHandler("spring", "ff", OscResponse::spring_handler);
 }
@@ -208,6 +344,13 @@ double OscResponse::response(double position, double velocity)
             -m_damping.m_value*velocity);
 }
 
+void OscResponse::changed()
+{
+    OscConstraint *c = dynamic_cast<OscConstraint*>(m_parent);
+    if (c)
+        c->on_response();
+}
+
 //! OscConstraint has two CHAI/ODE object associated with it, though not owned by it. Class name = "constraint"
 OscConstraint::OscConstraint(const char *name, OscBase *parent,
                              OscObject *object1, OscObject *object2)
@@ -231,14 +374,16 @@ OscConstraint::OscConstraint(const char *name, OscBase *parent,
 //! Destroy the constraint
 void OscConstraint::on_destroy()
 {
+    /* The joint stops acting immediately, but is freed with the
+     * constraint, since messages for it may still be dispatched
+     * before then. */
     if (m_pSpecial)
-        delete m_pSpecial;
+        m_pSpecial->disable();
 
     simulation()->delete_constraint(*this);
 
-    /* The constraint's memory is freed in the above delete_object
-     * call.  Should it be done here instead? Or perhaps moved to a
-     * deleted objects pool for later garbage collection. */
+    /* The constraint's memory is freed once the current messages
+     * have been handled, in Simulation::collect_deleted(). */
 
     return;
 }
@@ -39,6 +39,15 @@ class OscObject : public OscBase
 	OscObject(cGenericObject* p, const char *name, OscBase *parent=NULL);
     virtual ~OscObject();
 
+    /*! Note a collision with another object at a haptic step, and
+     *  return true if it is new, that is, if they were not also in
+     *  contact at the previous step.  Does not allocate memory, so it
+     *  may be used in the haptic loop, but only tracks a few contacts
+     *  at once. */
+    bool newCollision(OscObject *o, int count);
+
+    //! Inform object that it is in collision with another object at a
+    //! physics step, sending /collide to the client if enabled.
     bool collidedWith(OscObject *o, int count);
 
     const OscVector3& getPosition() { return m_position; }
@@ -53,6 +62,8 @@ class OscObject : public OscBase
     OSCVECTOR3(OscObject, color) {};
     OSCSCALAR(OscObject, mass) {};
     OSCSCALAR(OscObject, density) {};
+    //! Scale of this object's mass in the world's mutual attraction.
+    OSCSCALAR(OscObject, charge) {};
     OSCSCALAR(OscObject, collide) {};
     OSCSCALAR(OscObject, friction_static) {};
     OSCSCALAR(OscObject, friction_dynamic) {};
@@ -76,8 +87,17 @@ class OscObject : public OscBase
      * OscValue members. See OscObjectSpecial for more information. */
     OscObjectSpecial *m_pSpecial;
 
+    //! Last physics step at which each object touched this one.
     std::map<OscObject*,int> m_collisions;
 
+    /*! Objects recently in contact in the haptic loop, which only
+     *  touches the cursor, and the last step at which each touched
+     *  this one.  When more objects are in contact at once, the
+     *  contact that ended longest ago is forgotten. */
+    enum { MAX_CONTACTS = 16 };
+    struct Contact { OscObject *object; int count; };
+    Contact m_contacts[MAX_CONTACTS];
+
     static void setVelocity(OscObject *me, const OscVector3& vel);
 
     static int mass_handler(const char *path, const char *types, lo_arg **argv,
@@ -86,16 +106,56 @@ class OscObject : public OscBase
                                  int argc, void *data, void *user_data);
 };
 
+/*! A composite object joins other objects into a rigid assembly.
+ *  The parts keep their own shapes and properties but move together
+ *  as a single body. */
 class OscComposite : public OscObject
 {
   public:
-    OscComposite(const char *name);
+	OscComposite(cGenericObject* p, const char *name, OscBase *parent=NULL);
 
-    void addChild(OscObject *o);
-    
   protected:
-    std::vector<OscObject*> m_children;
-    dBodyID m_odeBody;
+    //! Make the named object a part of this composite.
+    OSCMETHOD1S(OscComposite, add) {};
+    //! Release the named part, which continues as a separate object.
+    OSCMETHOD1S(OscComposite, remove) {};
+};
+
+/*! A force field acts on every body within its radius of its
+ *  position, or on all bodies if the radius is zero.  Within the
+ *  radius, its strength falls off as (1 - distance/radius) raised to
+ *  the power of falloff.  A drag field opposes motion relative to the
+ *  field's velocity. */
+class OscField : public OscObject
+{
+  public:
+    enum FieldType {
+        FIELD_RADIAL,
+        FIELD_VORTEX,
+        FIELD_DRAG,
+        FIELD_NOISE,
+        FIELD_UNKNOWN
+    };
+
+	OscField(cGenericObject* p, const char *name, FieldType type,
+             OscBase *parent=NULL);
+
+    FieldType type() { return m_type; }
+
+    //! Return the field type named by a string, or FIELD_UNKNOWN.
+    static FieldType str_type(const char *type);
+    static const char* type_str(FieldType type);
+
+  protected:
+    OSCSCALAR(OscField, strength) {};
+    OSCSCALAR(OscField, radius) {};
+    OSCSCALAR(OscField, falloff) {};
+    //! Axis of rotation of a vortex.
+    OSCVECTOR3(OscField, axis) {};
+    //! Spatial frequency of noise.
+    OSCSCALAR(OscField, frequency) {};
+
+    FieldType m_type;
 };
 
 class OscPrism : public OscObject
@@ -130,12 +190,102 @@ class OscMesh : public OscObject
   protected:
     OSCVECTOR3(OscMesh, size) {};
 
+    //! Collide using the mesh's convex hull instead of its triangles.
+    OSCBOOLEAN(OscMesh, convex) {};
+
     static int size_handler(const char *path, const char *types, lo_arg **argv,
 							int argc, void *data, void *user_data);
 	static void size_physics_callback(void *self);
 	cVector3d m_vLastScaled;
 };
 
+//! An infinite plane through the object's position, perpendicular
+//! to its normal.  Planes are static.
+class OscPlane : public OscObject
+{
+  public:
+	OscPlane(cGenericObject* p, const char *name, OscBase *parent=NULL);
+
+  protected:
+    OSCVECTOR3(OscPlane, normal) {};
+};
+
+//! A cylinder with hemispherical caps, aligned with the Z axis.
+class OscCapsule : public OscObject
+{
+  public:
+	OscCapsule(cGenericObject* p, const char *name, OscBase *parent=NULL);
+
+  protected:
+    OSCSCALAR(OscCapsule, radius) {};
+    OSCSCALAR(OscCapsule, length) {};
+};
+
+//! A flat-ended cylinder aligned with the Z axis.
+class OscCylinder : public OscObject
+{
+  public:
+	OscCylinder(cGenericObject* p, const char *name, OscBase *parent=NULL);
+
+  protected:
+    OSCSCALAR(OscCylinder, radius) {};
+    OSCSCALAR(OscCylinder, length) {};
+};
+
+/*! A static grid of heights in the XY plane, with Z up.  The size
+ *  gives the width (X) and depth (Y) of the grid and a scale applied
+ *  to the heights.  Row 0 is at the +Y edge. */
+class OscHeightfield : public OscObject
+{
+  public:
+	OscHeightfield(cGenericObject* p, const char *name,
+                   int columns, int rows, OscBase *parent=NULL);
+
+    int columns() { return m_columns; }
+    int rows() { return m_rows; }
+    float height(int column, int row)
+        { return m_heights[row*m_columns + column]; }
+
+  protected:
+    OSCVECTOR3(OscHeightfield, size) {};
+
+    //! Called when count heights starting at index first have changed.
+    virtual void on_heights(int first, int count) {};
+
+    int m_columns;
+    int m_rows;
+    std::vector<float> m_heights;
+
+    static int height_handler(const char *path, const char *types,
+                              lo_arg **argv, int argc, void *data,
+                              void *user_data);
+    static int heights_handler(const char *path, const char *types,
+                               lo_arg **argv, int argc, void *data,
+                               void *user_data);
+};
+
+/*! The OscParticles class manages a group of identical spheres as a
+ *  single object.  The particles share one set of properties, and
+ *  their positions are transmitted together as blobs of 32-bit
+ *  floats (x, y, z per particle) instead of as individual values. */
+class OscParticles : public OscObject
+{
+  public:
+	OscParticles(cGenericObject* p, const char *name, int count,
+                 OscBase *parent=NULL);
+
+    int count() { return m_count; }
+
+    //! Number of particles whose positions fit in a single message
+    //! between simulations.
+    static const int CHUNK_SIZE;
+
+  protected:
+    OSCSCALAR(OscParticles, radius) {};
+
+    int m_count;
+};
+
 class OscCamera : public OscBase
 {
   public:
@@ -160,18 +310,28 @@ public:
 
     double response(double position, double velocity);
 
-    OSCSCALAR(OscResponse, stiffness) {};
-    OSCSCALAR(OscResponse, damping) {};
-    OSCSCALAR(OscResponse, offset) {};
+    OSCSCALAR(OscResponse, stiffness) { changed(); };
+    OSCSCALAR(OscResponse, damping) { changed(); };
+    OSCSCALAR(OscResponse, offset) { changed(); };
+
+    //! If true, the spring is solved by the physics engine as part of
+    //! the constraint instead of being applied as a force each step.
+    OSCBOOLEAN(OscResponse, implicit) { changed(); };
 
     OSCMETHOD2(OscResponse, spring)
         { m_stiffness.setValue(arg1); m_damping.setValue(arg2); }
+
+protected:
+    //! Notify the owning constraint that the response has changed.
+    void changed();
 };
 
 //! This class is used to override behaviour of OscConstraint's values
 //! that can be generalized across different types of objets.  We
 //! "assign a specialization" instead of using multiple inheritance.
-class OscConstraintSpecial {public:virtual ~OscConstraintSpecial(){}};
+class OscConstraintSpecial {public:virtual ~OscConstraintSpecial(){}
+    //! Stop the constraint from acting on its objects.
+    virtual void disable(){}};
 
 //! The OscConstraint class keeps track of ODE constraints between two
 //! objects in the world, or between one object and some point in the
@@ -180,7 +340,7 @@ class OscConstraint : public OscBase
 {
 public:
     OscConstraint(const char *name, OscBase *parent, OscObject *object1, OscObject *object2);
-    virtual ~OscConstraint() {};
+    virtual ~OscConstraint() { if (m_pSpecial) delete m_pSpecial; }
 
     OscObject *object1() { return m_object1; }
     OscObject *object2() { return m_object2; }
@@ -189,6 +349,10 @@ public:
     //! constraint to be "motorized" according to some response.
     virtual void simulationCallback() {};
 
+    //! This function is called when the constraint's response
+    //! coefficients change.
+    virtual void on_response() {};
+
     OSCMETHOD0(OscConstraint, destroy);
 
     OscConstraintSpecial *special() { return m_pSpecial; }
@@ -26,6 +26,8 @@ OscValue::OscValue(const char *name, OscBase *parent)
     m_set_callback_data = NULL;
     m_get_callback = NULL;
     m_get_callback_data = NULL;
+    m_refresh_callback = NULL;
+    m_refresh_callback_data = NULL;
 
     addHandler("get",           "i"  , OscValue::get_handler);
     addHandler("get",           ""   , OscValue::get_handler);
@@ -47,6 +49,7 @@ int OscValue::get_handler(const char *path, const char *types, lo_arg **argv,
     }
 
     if (argc==0) {
+        me->refresh();
         me->send();
     }
 
@@ -104,11 +104,24 @@ class OscValue : public OscBase
     void setGetCallback(GetCallback*c, void*d)
       { m_get_callback = c; m_get_callback_data = d; }
 
+    //! Set a function used to bring a lazily-updated value up to
+    //! date before it is sent.
+    typedef void RefreshCallback(void*, OscValue&);
+    void setRefreshCallback(RefreshCallback*c, void*d)
+      { m_refresh_callback = c; m_refresh_callback_data = d; }
+
+    //! Bring the value up to date if it is updated lazily.
+    void refresh()
+      { if (m_refresh_callback)
+          m_refresh_callback(m_refresh_callback_data, *this); }
+
   protected:
     SetCallback *m_set_callback;
     void *m_set_callback_data;
     GetCallback *m_get_callback;
     void *m_get_callback_data;
+    RefreshCallback *m_refresh_callback;
+    void *m_refresh_callback_data;
     static int get_handler(const char *path, const char *types, lo_arg **argv,
                            int argc, void *data, void *user_data);
 };
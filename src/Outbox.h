@@ -0,0 +1,246 @@
+// -*- mode:c++; indent-tabs-mode:nil; c-basic-offset:4; -*-
+//======================================================================================
+/*
+    This file is part of DIMPLE, the Dynamic Interactive Musically PhysicaL Environment,
+
+    This code is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License("GPL") version 2
+    as published by the Free Software Foundation.  See the file LICENSE
+    for more information.
+
+    sinclair@music.mcgill.ca
+    http://www.music.mcgill.ca/~sinclair/content/dimple
+*/
+//======================================================================================
+
+#ifndef _OUTBOX_H_
+#define _OUTBOX_H_
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <map>
+#include <thread>
+#include <chrono>
+#include <atomic>
+
+#ifndef WIN32
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "CircBuffer.h"
+#include "Simulation.h"
+#include "dimple.h"
+
+/*! Class for sending messages from a real-time loop without
+ *  allocating memory or making system calls.  Each message is copied
+ *  as a fixed-size record into a preallocated ring, and a thread of
+ *  normal priority builds the OSC messages and sends them.
+ *
+ *  Records may only be written from one thread.  A throttled message
+ *  is held until its receiver's timestep has passed since the last
+ *  one with the same path, and only the latest is sent, so that the
+ *  final value always arrives.
+ *
+ *  String arguments share MAX_TEXT bytes of each record, which with
+ *  MAX_PATH covers the messages sent for objects with names of up to
+ *  MAX_NAME characters.  Messages that do not fit in a record or in
+ *  the ring are dropped, and a warning is printed the first time. */
+
+class Outbox
+{
+  public:
+    enum { MAX_PATH = 256, MAX_ARGS = 6, MAX_TEXT = 256, MAX_NAME = 120 };
+
+    Outbox(int records)
+        : m_ring(records * sizeof(Record)), m_dropped(0), m_warned(false),
+          m_bDone(false) {}
+
+    ~Outbox()
+    {
+        if (m_thread.joinable()) {
+            m_bDone = true;
+            m_thread.join();
+        }
+    }
+
+    /*! Start the thread sending messages, polling the ring at the
+     *  given period in seconds.  It must be started from a thread of
+     *  normal priority, since it inherits its scheduling. */
+    void start(double period)
+    {
+        if (!m_thread.joinable())
+            m_thread = std::thread(run, this, period);
+    }
+
+    /*! Write a message for a receiver, or for the client if to is
+     *  NULL.  Arguments are as for lo_send(), limited to MAX_ARGS
+     *  floats, integers and strings.  Returns false if the message
+     *  was dropped. */
+    bool write(SimulationReceiver *to, bool throttle, const char *path,
+               const char *types, va_list ap)
+    {
+        Record r;
+        r.to = to;
+        r.throttle = throttle;
+
+        // Paths and strings that do not fit are dropped rather than
+        // sent truncated.
+        if (!copy(r.path, path, MAX_PATH)) {
+            m_dropped++;
+            return false;
+        }
+
+        int n = 0, text = 0;
+        for (; types[n] && n < MAX_ARGS; n++) {
+            r.types[n] = types[n];
+            switch (types[n]) {
+            case 'f': r.args[n].f = (float)va_arg(ap, double); break;
+            case 'i': r.args[n].i = va_arg(ap, int); break;
+            case 's':
+                r.args[n].s = text;
+                if (copy(r.text + text, va_arg(ap, const char*),
+                         MAX_TEXT - text)) {
+                    text += strlen(r.text + text) + 1;
+                    break;
+                }
+                // fall through
+            default:
+                m_dropped++;
+                return false;
+            }
+        }
+        r.types[n] = 0;
+
+        if (types[n] || !m_ring.writeBuffer((unsigned char*)&r, sizeof(r))) {
+            m_dropped++;
+            return false;
+        }
+        return true;
+    }
+
+    //! Return the number of messages dropped since starting.
+    int dropped() { return m_dropped; }
+
+  protected:
+    struct Record
+    {
+        //! Receiver of the message, or NULL for the client.
+        SimulationReceiver *to;
+        bool throttle;
+        char path[MAX_PATH];
+        char types[MAX_ARGS+1];
+        union {
+            float f;
+            int i;
+            //! Offset of a string in text.
+            int s;
+        } args[MAX_ARGS];
+        char text[MAX_TEXT];
+    };
+
+    //! A throttled message waiting to be sent.
+    struct Held
+    {
+        Held() : sent(0), pending(false) {}
+        Record record;
+        double sent;
+        bool pending;
+    };
+
+    typedef std::pair<SimulationReceiver*, std::string> HeldKey;
+    typedef std::map<HeldKey, Held> HeldMap;
+
+    CircBufferNoLock m_ring;
+    std::atomic<int> m_dropped;
+    bool m_warned;
+    std::atomic<bool> m_bDone;
+    std::thread m_thread;
+
+    //! Throttled messages, only touched by the sending thread.
+    HeldMap m_held;
+
+    /*! Copy a string into a buffer of the given size, or return false
+     *  if it does not fit. */
+    static bool copy(char *dest, const char *src, int size)
+    {
+        for (int i=0; i < size; i++)
+            if (!(dest[i] = src[i]))
+                return true;
+        return false;
+    }
+
+    static void run(Outbox *me, double period)
+    {
+#ifndef WIN32
+        // Make sure the thread does not compete with the real-time
+        // loop, whatever it was started from.
+        struct sched_param param;
+        param.sched_priority = 0;
+        pthread_setschedparam(pthread_self(), SCHED_OTHER, &param);
+#endif
+
+        typedef std::chrono::steady_clock clock;
+        clock::time_point start = clock::now();
+
+        while (!me->m_bDone)
+        {
+            double now = std::chrono::duration<double>(clock::now() - start).count();
+
+            Record r;
+            while (me->m_ring.readBuffer((unsigned char*)&r, sizeof(r)))
+            {
+                if (r.throttle && r.to) {
+                    Held &h = me->m_held[HeldKey(r.to, r.path)];
+                    h.record = r;
+                    h.pending = true;
+                }
+                else
+                    send(r);
+            }
+
+            if (me->m_dropped > 0 && !me->m_warned) {
+                printf("Warning: %d messages from the haptic loop were "
+                       "dropped, since they did not fit in the outbox or "
+                       "named an object of more than %d characters.\n",
+                       (int)me->m_dropped, MAX_NAME);
+                me->m_warned = true;
+            }
+
+            HeldMap::iterator it;
+            for (it=me->m_held.begin(); it!=me->m_held.end(); it++) {
+                Held &h = it->second;
+                if (h.pending && now - h.sent >= h.record.to->timestep()) {
+                    send(h.record);
+                    h.sent = now;
+                    h.pending = false;
+                }
+            }
+
+            std::this_thread::sleep_for(std::chrono::duration<double>(period));
+        }
+    }
+
+    static void send(const Record &r)
+    {
+        lo_message msg = lo_message_new();
+        for (int i=0; r.types[i]; i++) {
+            switch (r.types[i]) {
+            case 'f': lo_message_add_float(msg, r.args[i].f); break;
+            case 'i': lo_message_add_int32(msg, r.args[i].i); break;
+            case 's': lo_message_add_string(msg, r.text + r.args[i].s); break;
+            }
+        }
+
+        if (r.to)
+            r.to->send_outbox_message(r.path, msg);
+        else
+            lo_send_message(address_send, r.path, msg);
+
+        lo_message_free(msg);
+    }
+};
+
+#endif // _OUTBOX_H_
@@ -2,7 +2,11 @@
 
 #include "dimple.h"
 #include "PhysicsSim.h"
+#include "ConvexHull.h"
+#include "AssetCache.h"
 #include <cassert>
+#include <algorithm>
+#include <chrono>
 
 bool PhysicsPrismFactory::create(const char *name, float x, float y, float z)
 {
@@ -32,6 +36,130 @@ bool PhysicsSphereFactory::create(const char *name, float x, float y, float z)
     return true;
 }
 
+bool PhysicsParticlesFactory::create(const char *name, int count,
+                                     float x, float y, float z)
+{
+    OscParticlesODE *obj = new OscParticlesODE(simulation()->odeWorld(),
+                                               simulation()->odeSpace(),
+                                               name, count, m_parent);
+
+    if (!(obj && simulation()->add_object(*obj)))
+            return false;
+
+    obj->m_position.setValue(x, y, z);
+
+    return true;
+}
+
+bool PhysicsMeshFactory::create(const char *name, const char *filename,
+                                float x, float y, float z)
+{
+    printf("PhysicsMeshFactory (%s) is creating a mesh "
+           "object called '%s' (%s)\n", m_parent->c_name(), name, filename);
+
+    OscMeshODE *obj = new OscMeshODE(simulation()->odeWorld(),
+                                     simulation()->odeSpace(),
+                                     name, filename, m_parent);
+
+    if (!obj->loaded()) {
+        delete obj;
+        obj = NULL;
+    }
+
+    if (!(obj && simulation()->add_object(*obj)))
+            return false;
+
+    obj->m_position.setValue(x, y, z);
+
+    return true;
+}
+
+bool PhysicsPlaneFactory::create(const char *name, float x, float y, float z)
+{
+    OscPlaneODE *obj = new OscPlaneODE(simulation()->odeWorld(),
+                                       simulation()->odeSpace(),
+                                       name, m_parent);
+
+    if (!(obj && simulation()->add_object(*obj)))
+            return false;
+
+    obj->m_position.setValue(x, y, z);
+
+    return true;
+}
+
+bool PhysicsCapsuleFactory::create(const char *name, float x, float y, float z)
+{
+    OscCapsuleODE *obj = new OscCapsuleODE(simulation()->odeWorld(),
+                                           simulation()->odeSpace(),
+                                           name, m_parent);
+
+    if (!(obj && simulation()->add_object(*obj)))
+            return false;
+
+    obj->m_position.setValue(x, y, z);
+
+    return true;
+}
+
+bool PhysicsCylinderFactory::create(const char *name, float x, float y, float z)
+{
+    OscCylinderODE *obj = new OscCylinderODE(simulation()->odeWorld(),
+                                             simulation()->odeSpace(),
+                                             name, m_parent);
+
+    if (!(obj && simulation()->add_object(*obj)))
+            return false;
+
+    obj->m_position.setValue(x, y, z);
+
+    return true;
+}
+
+bool PhysicsHeightfieldFactory::create(const char *name, int columns, int rows,
+                                       float x, float y, float z)
+{
+    OscHeightfieldODE *obj = new OscHeightfieldODE(simulation()->odeWorld(),
+                                                   simulation()->odeSpace(),
+                                                   name, columns, rows,
+                                                   m_parent);
+
+    if (!(obj && simulation()->add_object(*obj)))
+            return false;
+
+    obj->m_position.setValue(x, y, z);
+
+    return true;
+}
+
+bool PhysicsCompositeFactory::create(const char *name, float x, float y, float z)
+{
+    OscCompositeODE *obj = new OscCompositeODE(simulation()->odeWorld(),
+                                               simulation()->odeSpace(),
+                                               name, m_parent);
+
+    if (!(obj && simulation()->add_object(*obj)))
+            return false;
+
+    obj->m_position.setValue(x, y, z);
+
+    return true;
+}
+
+bool PhysicsFieldFactory::create(const char *name, const char *type,
+                                 float x, float y, float z)
+{
+    OscFieldODE *obj = new OscFieldODE(name, OscField::str_type(type),
+                                       m_parent);
+
+    if (!(obj && simulation()->add_object(*obj)))
+            return false;
+
+    obj->m_position.setValue(x, y, z);
+
+    return true;
+}
+
 bool PhysicsHingeFactory::create(const char *name, OscObject *object1, OscObject *object2,
                                  double x, double y, double z, double ax, double ay, double az)
 {
@@ -151,10 +279,24 @@ bool PhysicsUniversalFactory::create(const char *name, OscObject *object1,
 const int PhysicsSim::MAX_CONTACTS = 30;
 
 PhysicsSim::PhysicsSim(const char *port)
-    : Simulation(port, ST_PHYSICS)
+    : Simulation(port, ST_PHYSICS),
+      m_hingeResponses(1, 1000),
+      m_hinge2Responses(2),
+      m_slideResponses(1),
+      m_pistonResponses(1),
+      m_universalResponses(2),
+      m_freeResponses(3)
 {
     m_pPrismFactory = new PhysicsPrismFactory(this);
     m_pSphereFactory = new PhysicsSphereFactory(this);
+    m_pMeshFactory = new PhysicsMeshFactory(this);
+    m_pParticlesFactory = new PhysicsParticlesFactory(this);
+    m_pPlaneFactory = new PhysicsPlaneFactory(this);
+    m_pCapsuleFactory = new PhysicsCapsuleFactory(this);
+    m_pCylinderFactory = new PhysicsCylinderFactory(this);
+    m_pHeightfieldFactory = new PhysicsHeightfieldFactory(this);
+    m_pCompositeFactory = new PhysicsCompositeFactory(this);
+    m_pFieldFactory = new PhysicsFieldFactory(this);
     m_pHingeFactory = new PhysicsHingeFactory(this);
     m_pHinge2Factory = new PhysicsHinge2Factory(this);
     m_pFixedFactory = new PhysicsFixedFactory(this);
@@ -163,9 +305,16 @@ PhysicsSim::PhysicsSim(const char *port)
     m_pSlideFactory = new PhysicsSlideFactory(this);
     m_pPistonFactory = new PhysicsPistonFactory(this);
     m_pUniversalFactory = new PhysicsUniversalFactory(this);
+    m_pSpatialQuery = new PhysicsSpatialQuery(this);
 
     m_pGrabbedObject = NULL;
 
+    m_odeThreading = NULL;
+    m_odeThreadPool = NULL;
+    m_pNarrowphasePool = NULL;
+    m_fStepTimeTotal = 0;
+    m_nStepTimeCount = 0;
+
     m_fTimestep = physics_timestep_ms/1000.0;
     m_counter = 0;
     printf("ODE timestep: %f\n", m_fTimestep);
@@ -176,6 +325,8 @@ PhysicsSim::~PhysicsSim()
     // Stop the simulation before deleting objects, otherwise thread
     // is still running and may dereference them.
     stop();
+
+    freeThreads();
 }
 
 void PhysicsSim::initialize()
@@ -188,317 +339,2014 @@ void PhysicsSim::initialize()
 
     m_odeWorld = dWorldCreate();
     dWorldSetGravity (m_odeWorld,0,0,0);
-    m_odeSpace = dSimpleSpaceCreate(0);
+
+    // A quadtree lets collisions and spatial queries test only the
+    // geoms near each other.  Geoms outside the tree's extents are
+    // kept at its root.
+    dVector3 center = { 0, 0, 0 };
+    dVector3 extents = { 2, 2, 2 };
+    m_odeSpace = dQuadTreeSpaceCreate(0, center, extents, 6);
     m_odeContactGroup = dJointGroupCreate(0);
 
-    /* This is just to track haptics cursor during "grab" state.
-     * We only need its position, so just use a generic OscObject. */
-    m_pCursor = new OscObject(NULL, "cursor", this);
-    if (!m_pCursor)
-        printf("Error creating PhysicsSim cursor.\n");
+    /* This is just to track haptics cursor during "grab" state.
+     * We only need its position, so just use a generic OscObject. */
+    m_pCursor = new OscObject(NULL, "cursor", this);
+    if (!m_pCursor)
+        printf("Error creating PhysicsSim cursor.\n");
+
+    Simulation::initialize();
+}
+
+void PhysicsSim::step()
+{
+    auto step_start = std::chrono::steady_clock::now();
+
+    int substeps = (int)m_physics_substeps.m_value;
+    if (substeps < 1)
+        substeps = 1;
+    dReal dt = m_fTimestep / substeps;
+
+    // Field and attraction forces are computed once per step and
+    // kept for all sub-steps along with forces added by messages.
+    if (!m_fields.empty())
+        applyFields();
+    if (m_attraction.m_value != 0)
+        applyAttraction();
+
+    // ODE clears accumulated forces after each step, so forces added
+    // by messages since the last step must be kept to re-apply them
+    // on each sub-step.
+    if (substeps > 1)
+        saveForces();
+
+    for (int sub=0; sub < substeps; sub++)
+    {
+        if (sub > 0)
+            restoreForces();
+
+        // Add extra forces to objects
+        // Grabbed object attraction
+        if (m_pGrabbedObject && m_pGrabbedODEObject && m_pGrabbedODEObject->body())
+        {
+            cVector3d grab_force(m_pGrabbedODEObject->getPosition()
+                                 - m_pCursor->m_position);
+
+            grab_force.mul(-fabs(m_grab_stiffness.m_value));
+            grab_force.add(m_pGrabbedODEObject->getVelocity()*(-fabs(m_grab_damping.m_value)));
+            dBodyAddForce(m_pGrabbedODEObject->body(),
+                          grab_force.x(), grab_force.y(), grab_force.z());
+        }
+
+        /* Update the responses of each constraint, by type. */
+        m_hingeResponses.evaluate();
+        m_hinge2Responses.evaluate();
+        m_slideResponses.evaluate();
+        m_pistonResponses.evaluate();
+        m_universalResponses.evaluate();
+        m_freeResponses.evaluate();
+
+        // Perform simulation step
+        collide();
+        dWorldQuickStep (m_odeWorld, dt);
+        dJointGroupEmpty (m_odeContactGroup);
+
+        m_counter++;
+    }
+
+    /* Gather the state of all bodies in a single pass.  OscObject
+     * values are refreshed from these arrays only when queried. */
+    int nbodies = m_bodies.size();
+    m_bodyPrevVelocity.swap(m_bodyVelocity);
+    for (int i=0; i<nbodies; i++)
+    {
+        ODEObject *o = m_bodies[i];
+        dBodyID body = o->body();
+        const dReal *p, *r;
+        dVector3 v;
+        if (o->attached()) {
+            // Parts of a composite move with the composite's body.
+            p = dGeomGetPosition(o->geom());
+            r = dGeomGetRotation(o->geom());
+            dBodyGetPointVel(body, p[0], p[1], p[2], v);
+        }
+        else {
+            p = dBodyGetPosition(body);
+            r = dBodyGetRotation(body);
+            dCopyVector3(v, dBodyGetLinearVel(body));
+        }
+
+        dReal *pos = &m_bodyPosition[i*3];
+        dReal *vel = &m_bodyVelocity[i*3];
+        dReal *rot = &m_bodyRotation[i*9];
+        pos[0] = p[0]; pos[1] = p[1]; pos[2] = p[2];
+        vel[0] = v[0]; vel[1] = v[1]; vel[2] = v[2];
+        rot[0] = r[0]; rot[1] = r[1]; rot[2] = r[2];
+        rot[3] = r[4]; rot[4] = r[5]; rot[5] = r[6];
+        rot[6] = r[8]; rot[7] = r[9]; rot[8] = r[10];
+    }
+
+    /* Update positions of each object in the other simulations */
+    for (int i=0; i<nbodies; i++)
+    {
+        const dReal *pos = &m_bodyPosition[i*3];
+        const dReal *rot = &m_bodyRotation[i*9];
+        send(true, m_bodyPositionPath[i].c_str(), "fff",
+             pos[0], pos[1], pos[2]);
+        send(true, m_bodyRotationPath[i].c_str(), "fffffffff",
+             rot[0], rot[1], rot[2],
+             rot[3], rot[4], rot[5],
+             rot[6], rot[7], rot[8]);
+    }
+
+    /* Particle positions are gathered into flat arrays and sent as
+     * blobs. */
+    std::vector<OscParticlesODE*>::iterator pit;
+    for (pit=m_particles.begin(); pit!=m_particles.end(); pit++)
+    {
+        (*pit)->update();
+        (*pit)->publish();
+    }
+
+    // Report the average step duration in milliseconds since the
+    // last change in thread count.
+    std::chrono::duration<double, std::milli> step_time =
+        std::chrono::steady_clock::now() - step_start;
+    m_fStepTimeTotal += step_time.count();
+    m_nStepTimeCount++;
+    m_physics_step_time.setValue(m_fStepTimeTotal / m_nStepTimeCount, false);
+}
+
+void PhysicsSim::addBody(ODEObject *o)
+{
+    o->m_index = m_bodies.size();
+    m_bodies.push_back(o);
+
+    m_bodyPosition.resize(m_bodies.size()*3, 0);
+    m_bodyVelocity.resize(m_bodies.size()*3, 0);
+    m_bodyPrevVelocity.resize(m_bodies.size()*3, 0);
+    m_bodyRotation.resize(m_bodies.size()*9, 0);
+
+    m_bodyPositionPath.push_back(o->object()->path()+"/position");
+    m_bodyRotationPath.push_back(o->object()->path()+"/rotation");
+}
+
+void PhysicsSim::removeBody(ODEObject *o)
+{
+    // Move the last body into the removed body's place to keep the
+    // arrays dense.
+    int i = o->m_index;
+    int last = m_bodies.size()-1;
+    if (i < 0 || i > last)
+        return;
+
+    if (i != last) {
+        m_bodies[i] = m_bodies[last];
+        m_bodies[i]->m_index = i;
+        std::copy(&m_bodyPosition[last*3], &m_bodyPosition[last*3+3],
+                  &m_bodyPosition[i*3]);
+        std::copy(&m_bodyVelocity[last*3], &m_bodyVelocity[last*3+3],
+                  &m_bodyVelocity[i*3]);
+        std::copy(&m_bodyPrevVelocity[last*3], &m_bodyPrevVelocity[last*3+3],
+                  &m_bodyPrevVelocity[i*3]);
+        std::copy(&m_bodyRotation[last*9], &m_bodyRotation[last*9+9],
+                  &m_bodyRotation[i*9]);
+        m_bodyPositionPath[i].swap(m_bodyPositionPath[last]);
+        m_bodyRotationPath[i].swap(m_bodyRotationPath[last]);
+    }
+
+    m_bodies.pop_back();
+    m_bodyPosition.resize(last*3);
+    m_bodyVelocity.resize(last*3);
+    m_bodyPrevVelocity.resize(last*3);
+    m_bodyRotation.resize(last*9);
+    m_bodyPositionPath.pop_back();
+    m_bodyRotationPath.pop_back();
+
+    o->m_index = -1;
+}
+
+void PhysicsSim::addParticles(OscParticlesODE *p)
+{
+    m_particles.push_back(p);
+}
+
+void PhysicsSim::removeParticles(OscParticlesODE *p)
+{
+    std::vector<OscParticlesODE*>::iterator it =
+        std::find(m_particles.begin(), m_particles.end(), p);
+    if (it != m_particles.end())
+        m_particles.erase(it);
+}
+
+void PhysicsSim::addField(OscFieldODE *f)
+{
+    m_fields.push_back(f);
+}
+
+void PhysicsSim::removeField(OscFieldODE *f)
+{
+    std::vector<OscFieldODE*>::iterator it =
+        std::find(m_fields.begin(), m_fields.end(), f);
+    if (it != m_fields.end())
+        m_fields.erase(it);
+}
+
+void PhysicsSim::addFieldBody(dBodyID body)
+{
+    // A force on a disabled body would wait until it is enabled.
+    if (!dBodyIsEnabled(body))
+        return;
+
+    const dReal *p = dBodyGetPosition(body);
+    const dReal *v = dBodyGetLinearVel(body);
+    m_fieldBodies.push_back(body);
+    m_fieldPosition.insert(m_fieldPosition.end(), p, p+3);
+    m_fieldVelocity.insert(m_fieldVelocity.end(), v, v+3);
+}
+
+void PhysicsSim::applyFields()
+{
+    /* Gather the state of every body, including particles, so that
+     * each field is evaluated over all of them in one pass. */
+    m_fieldBodies.clear();
+    m_fieldPosition.clear();
+    m_fieldVelocity.clear();
+
+    // Parts share the body of their composite.
+    std::vector<ODEObject*>::iterator bit;
+    for (bit=m_bodies.begin(); bit!=m_bodies.end(); bit++)
+        if (!(*bit)->attached())
+            addFieldBody((*bit)->body());
+
+    std::vector<OscParticlesODE*>::iterator pit;
+    for (pit=m_particles.begin(); pit!=m_particles.end(); pit++)
+    {
+        const std::vector<dBodyID> &bodies = (*pit)->bodies();
+        for (unsigned int i=0; i<bodies.size(); i++)
+            addFieldBody(bodies[i]);
+    }
+
+    int count = m_fieldBodies.size();
+    if (count == 0)
+        return;
+
+    m_fieldForce.assign(count*3, 0);
+    dReal time = m_counter * m_fTimestep;
+
+    std::vector<OscFieldODE*>::iterator fit;
+    for (fit=m_fields.begin(); fit!=m_fields.end(); fit++)
+        (*fit)->evaluate(count, &m_fieldPosition[0], &m_fieldVelocity[0],
+                         &m_fieldForce[0], time);
+
+    for (int i=0; i<count; i++)
+        dBodyAddForce(m_fieldBodies[i], m_fieldForce[i*3+0],
+                      m_fieldForce[i*3+1], m_fieldForce[i*3+2]);
+}
+
+void PhysicsSim::addAttractionBody(dBodyID body, double charge)
+{
+    dMass m;
+    dBodyGetMass(body, &m);
+    charge *= m.mass;
+    if (charge <= 0)
+        return;
+
+    const dReal *p = dBodyGetPosition(body);
+    m_attractionBodies.push_back(body);
+    m_attractionPosition.insert(m_attractionPosition.end(), p, p+3);
+    m_attractionCharge.push_back(charge);
+}
+
+void PhysicsSim::applyAttraction()
+{
+    /* Each body's charge is its mass scaled by its object's charge,
+     * so by default bodies attract as under gravity.  Particles share
+     * the charge of their system. */
+    m_attractionBodies.clear();
+    m_attractionPosition.clear();
+    m_attractionCharge.clear();
+
+    std::vector<ODEObject*>::iterator bit;
+    for (bit=m_bodies.begin(); bit!=m_bodies.end(); bit++)
+        if (!(*bit)->attached())
+            addAttractionBody((*bit)->body(),
+                              (*bit)->object()->m_charge.m_value);
+
+    std::vector<OscParticlesODE*>::iterator pit;
+    for (pit=m_particles.begin(); pit!=m_particles.end(); pit++)
+    {
+        const std::vector<dBodyID> &bodies = (*pit)->bodies();
+        for (unsigned int i=0; i<bodies.size(); i++)
+            addAttractionBody(bodies[i], (*pit)->m_charge.m_value);
+    }
+
+    int count = m_attractionBodies.size();
+    if (count < 2)
+        return;
+
+    m_attractionForce.resize(count*3);
+    m_attractionTree.setTheta(m_attraction_theta.m_value);
+    m_attractionTree.compute(&m_attractionPosition[0],
+                             &m_attractionCharge[0], count,
+                             &m_attractionForce[0]);
+
+    /* Disabled bodies, such as those fixed to the world, still
+     * attract the others, but a force on them would wait until they
+     * are enabled and then be released all at once. */
+    dReal strength = m_attraction.m_value;
+    for (int i=0; i<count; i++)
+        if (dBodyIsEnabled(m_attractionBodies[i]))
+            dBodyAddForce(m_attractionBodies[i],
+                          m_attractionForce[i*3+0] * strength,
+                          m_attractionForce[i*3+1] * strength,
+                          m_attractionForce[i*3+2] * strength);
+}
+
+void PhysicsSim::saveForces()
+{
+    m_savedForces.clear();
+
+    std::map<std::string,OscObject*>::iterator it;
+    for (it=world_objects.begin(); it!=world_objects.end(); it++)
+    {
+        // Parts share the body of their composite.
+        ODEObject *o = static_cast<ODEObject*>(it->second->special());
+        if (o && o->body() && !o->attached())
+            saveForce(o->body());
+    }
+
+    std::vector<OscParticlesODE*>::iterator pit;
+    for (pit=m_particles.begin(); pit!=m_particles.end(); pit++)
+    {
+        const std::vector<dBodyID> &bodies = (*pit)->bodies();
+        for (unsigned int i=0; i<bodies.size(); i++)
+            saveForce(bodies[i]);
+    }
+}
+
+void PhysicsSim::saveForce(dBodyID body)
+{
+    const dReal *f = dBodyGetForce(body);
+    const dReal *t = dBodyGetTorque(body);
+    if (f[0]==0 && f[1]==0 && f[2]==0 && t[0]==0 && t[1]==0 && t[2]==0)
+        return;
+
+    SavedForce sf;
+    sf.body = body;
+    for (int i=0; i<3; i++) {
+        sf.force[i] = f[i];
+        sf.torque[i] = t[i];
+    }
+    m_savedForces.push_back(sf);
+}
+
+void PhysicsSim::restoreForces()
+{
+    std::vector<SavedForce>::iterator it;
+    for (it=m_savedForces.begin(); it!=m_savedForces.end(); it++)
+    {
+        dBodyAddForce(it->body, it->force[0], it->force[1], it->force[2]);
+        dBodyAddTorque(it->body, it->torque[0], it->torque[1], it->torque[2]);
+    }
+}
+
+void PhysicsSim::on_physics_substeps()
+{
+    // Implicit responses depend on the step size.
+    std::map<std::string,OscConstraint*>::iterator it;
+    for (it=world_constraints.begin(); it!=world_constraints.end(); it++)
+        it->second->on_response();
+}
+
+void PhysicsSim::on_physics_threads()
+{
+    int threads = (int)m_physics_threads.m_value;
+    if (threads < 1)
+        threads = 1;
+    m_physics_threads.setValue(threads, false);
+
+    setThreads(threads);
+}
+
+void PhysicsSim::setThreads(int threads)
+{
+    freeThreads();
+
+    // Restart the average step time for the new configuration.
+    m_fStepTimeTotal = 0;
+    m_nStepTimeCount = 0;
+
+    if (threads > 1)
+    {
+        m_odeThreading = dThreadingAllocateMultiThreadedImplementation();
+        if (!m_odeThreading) {
+            printf("[%s] ODE was built without threading support, "
+                   "stepping in a single thread.\n", type_str());
+            m_physics_threads.setValue(1, false);
+            return;
+        }
+
+        m_odeThreadPool = dThreadingAllocateThreadPool(threads, 0,
+                                                       dAllocateFlagBasicData,
+                                                       NULL);
+        if (!m_odeThreadPool) {
+            printf("[%s] Error allocating a pool of %d threads, "
+                   "stepping in a single thread.\n", type_str(), threads);
+            dThreadingFreeImplementation(m_odeThreading);
+            m_odeThreading = NULL;
+            m_physics_threads.setValue(1, false);
+            return;
+        }
+
+        dThreadingThreadPoolServeMultiThreadedImplementation(m_odeThreadPool,
+                                                             m_odeThreading);
+        dWorldSetStepThreadingImplementation(
+            m_odeWorld, dThreadingImplementationGetFunctions(m_odeThreading),
+            m_odeThreading);
+
+        // The physics thread takes part in the narrowphase, so it
+        // only needs threads-1 workers.
+        m_pNarrowphasePool = new WorkerPool(threads, ode_threadStart,
+                                            ode_threadFinish);
+    }
+
+    dWorldSetStepIslandsProcessingMaxThreadCount(m_odeWorld, threads);
+
+    printf("[%s] Stepping with %d thread%s.\n", type_str(), threads,
+           threads > 1 ? "s" : "");
+}
+
+void PhysicsSim::freeThreads()
+{
+    if (m_pNarrowphasePool) {
+        delete m_pNarrowphasePool;
+        m_pNarrowphasePool = NULL;
+    }
+
+    if (!m_odeThreading)
+        return;
+
+    // Stop the pool threads serving the implementation before
+    // detaching it from the world.
+    dThreadingImplementationShutdownProcessing(m_odeThreading);
+    dThreadingFreeThreadPool(m_odeThreadPool);
+    dWorldSetStepThreadingImplementation(m_odeWorld, NULL, NULL);
+    dThreadingFreeImplementation(m_odeThreading);
+
+    m_odeThreadPool = NULL;
+    m_odeThreading = NULL;
+}
+
+void PhysicsSim::ode_nearCallback (void *data, dGeomID o1, dGeomID o2)
+{
+    PhysicsSim *me = static_cast<PhysicsSim*>(data);
+
+    // Particle systems are spaces inside the world space, so test
+    // their contents against the other geom.
+    if (dGeomIsSpace(o1) || dGeomIsSpace(o2)) {
+        dSpaceCollide2(o1, o2, data, &ode_nearCallback);
+        return;
+    }
+
+    // exit without doing anything if the two bodies are connected by a joint
+    dBodyID b1 = dGeomGetBody(o1);
+    dBodyID b2 = dGeomGetBody(o2);
+    if (!b1 && !b2) return;
+    if (b1 == b2) return;  // parts of the same composite
+    if (b1 && b2 && dAreConnectedExcluding (b1,b2,dJointTypeContact)) return;
+
+    // Only collect the pair here; contacts are found in collide().
+    // ODE's trimesh and heightfield colliders keep working state in
+    // the geom, so pairs involving either are kept apart to be tested
+    // on a single thread.
+    std::pair<dGeomID, dGeomID> pair(o1, o2);
+    if (serialCollider(o1) || serialCollider(o2))
+        me->m_serialPairs.push_back(pair);
+    else
+        me->m_collidePairs.push_back(pair);
+}
+
+void PhysicsSim::narrowphase_pair(NarrowphaseBuffer &buf,
+                                  dGeomID o1, dGeomID o2)
+{
+    int first = buf.contacts.size();
+    buf.contacts.resize(first + MAX_CONTACTS);
+
+    dContact *contact = &buf.contacts[first];
+    int numc = dCollide (o1, o2, MAX_CONTACTS,
+                         &contact[0].geom, sizeof(dContact));
+    buf.contacts.resize(first + numc);
+    if (numc == 0)
+        return;
+
+    for (int i=0; i<numc; i++) {
+        contact[i].surface.mode = dContactBounce | dContactSoftCFM;
+        contact[i].surface.mu = dInfinity;
+        contact[i].surface.mu2 = 0;
+        contact[i].surface.bounce = 0.1;
+        contact[i].surface.bounce_vel = 0.1;
+        contact[i].surface.soft_cfm = 0.01;
+    }
+
+    NarrowphaseBuffer::PairContacts pc;
+    pc.o1 = o1;
+    pc.o2 = o2;
+    pc.first = first;
+    pc.count = numc;
+    buf.pairs.push_back(pc);
+}
+
+void PhysicsSim::narrowphase_task(void *data, int task)
+{
+    PhysicsSim *me = static_cast<PhysicsSim*>(data);
+    NarrowphaseBuffer &buf = me->m_narrowphaseBuffers[task];
+
+    buf.contacts.clear();
+    buf.pairs.clear();
+
+    // Each task handles one contiguous range of pairs.
+    int tasks = me->m_narrowphaseBuffers.size();
+    int npairs = me->m_collidePairs.size();
+    int begin = npairs * task / tasks;
+    int end = npairs * (task+1) / tasks;
+
+    for (int p=begin; p<end; p++)
+        narrowphase_pair(buf, me->m_collidePairs[p].first,
+                         me->m_collidePairs[p].second);
+}
+
+void PhysicsSim::collide()
+{
+    m_collidePairs.clear();
+    m_serialPairs.clear();
+    dSpaceCollide (m_odeSpace, this, &ode_nearCallback);
+
+    // Collisions between particles of the same system.
+    std::vector<OscParticlesODE*>::iterator pit;
+    for (pit=m_particles.begin(); pit!=m_particles.end(); pit++)
+        dSpaceCollide ((*pit)->space(), this, &ode_nearCallback);
+
+    // Find contacts, split across the narrowphase workers if any.
+    // Small batches are not worth waking the workers for.
+    int tasks = 1;
+    if (m_pNarrowphasePool && m_collidePairs.size() > 16)
+        tasks = m_pNarrowphasePool->threads();
+
+    m_narrowphaseBuffers.resize(tasks);
+    if (tasks > 1)
+        m_pNarrowphasePool->run(narrowphase_task, this, tasks);
+    else
+        narrowphase_task(this, 0);
+
+    // Pairs involving a trimesh or heightfield are tested on this
+    // thread once the workers are done, so that neither is in two
+    // collisions at once.
+    m_serialBuffer.contacts.clear();
+    m_serialBuffer.pairs.clear();
+    std::vector<std::pair<dGeomID, dGeomID> >::iterator sit;
+    for (sit=m_serialPairs.begin(); sit!=m_serialPairs.end(); sit++)
+        narrowphase_pair(m_serialBuffer, sit->first, sit->second);
+
+    // Merge contacts in pair order, serial pairs last, so that
+    // results do not depend on which thread found them.
+    for (int t=0; t<=tasks; t++)
+    {
+        NarrowphaseBuffer &buf =
+            (t < tasks) ? m_narrowphaseBuffers[t] : m_serialBuffer;
+        std::vector<NarrowphaseBuffer::PairContacts>::iterator it;
+        for (it=buf.pairs.begin(); it!=buf.pairs.end(); it++)
+        {
+            dGeomID o1 = it->o1;
+            dGeomID o2 = it->o2;
+            dBodyID b1 = dGeomGetBody(o1);
+            dBodyID b2 = dGeomGetBody(o2);
+
+            OscObject *p1 = static_cast<OscObject*>(dGeomGetData(o1));
+            OscObject *p2 = static_cast<OscObject*>(dGeomGetData(o2));
+            if (p1 && p2) {
+                // Velocities are needed for reporting the collision.
+                p1->m_velocity.refresh();
+                p2->m_velocity.refresh();
+
+                bool co1 = p1->collidedWith(p2, m_counter);
+                bool co2 = p2->collidedWith(p1, m_counter);
+                if ( (co1 || co2) && m_collide.m_value ) {
+                    lo_send(address_send, "/world/collide", "ssf",
+                            p1->c_name(), p2->c_name(),
+                            (double)(p1->m_velocity - p2->m_velocity).length());
+                }
+                // TODO: this strategy will NOT work for multiple collisions between same objects!!
+            }
+            for (int i=0; i<it->count; i++) {
+                dJointID c = dJointCreateContact (m_odeWorld, m_odeContactGroup,
+                                                  &buf.contacts[it->first+i]);
+                dJointAttach (c,b1,b2);
+            }
+        }
+    }
+}
+
+void PhysicsSim::set_grabbed(OscObject *pGrabbed)
+{
+    Simulation::set_grabbed(pGrabbed);
+    m_pGrabbedODEObject = NULL;
+    if (pGrabbed)
+        m_pGrabbedODEObject = dynamic_cast<ODEObject*>(pGrabbed->special());
+}
+
+/****** PhysicsSpatialQuery ******/
+
+void PhysicsSpatialQuery::candidate_callback(void *data, dGeomID o1, dGeomID o2)
+{
+    PhysicsSpatialQuery *me = static_cast<PhysicsSpatialQuery*>(data);
+    dGeomID g = (o1 == me->m_query) ? o2 : o1;
+
+    // Particle systems have spaces of their own, and their geoms
+    // carry no object.
+    if (dGeomIsSpace(g) || !dGeomGetData(g))
+        return;
+
+    me->m_candidates.push_back(g);
+}
+
+void PhysicsSpatialQuery::candidates(dGeomID query)
+{
+    m_query = query;
+    m_candidates.clear();
+    dSpaceCollide2(query, (dGeomID)simulation()->odeSpace(),
+                   this, candidate_callback);
+}
+
+OscObject *PhysicsSpatialQuery::object(dGeomID geom)
+{
+    OscObject *o = static_cast<OscObject*>(dGeomGetData(geom));
+    if (simulation()->find_object(o->c_name()) != o)
+        return NULL;
+    return o;
+}
+
+void PhysicsSpatialQuery::raycast(float x, float y, float z,
+                                  float dx, float dy, float dz, float length)
+{
+    dGeomID ray = dCreateRay(0, length);
+    dGeomRaySet(ray, x, y, z, dx, dy, dz);
+    dGeomRaySetClosestHit(ray, 1);
+    candidates(ray);
+
+    // Keep the closest hit.
+    OscObject *hit = NULL;
+    dContactGeom best;
+    best.depth = dInfinity;
+    std::vector<dGeomID>::iterator it;
+    for (it=m_candidates.begin(); it!=m_candidates.end(); it++)
+    {
+        dContactGeom c;
+        if (dCollide(ray, *it, 1, &c, sizeof(dContactGeom)) < 1
+            || c.depth >= best.depth)
+            continue;
+        OscObject *o = object(*it);
+        if (o) {
+            hit = o;
+            best = c;
+        }
+    }
+    dGeomDestroy(ray);
+
+    lo_message msg = lo_message_new();
+    if (hit) {
+        lo_message_add_string(msg, hit->c_name());
+        lo_message_add_float(msg, best.depth);
+        lo_message_add_float(msg, best.pos[0]);
+        lo_message_add_float(msg, best.pos[1]);
+        lo_message_add_float(msg, best.pos[2]);
+        lo_message_add_float(msg, best.normal[0]);
+        lo_message_add_float(msg, best.normal[1]);
+        lo_message_add_float(msg, best.normal[2]);
+    }
+    lo_send_message(address_send, "/world/query/raycast", msg);
+    lo_message_free(msg);
+}
+
+void PhysicsSpatialQuery::sphere(float x, float y, float z, float radius)
+{
+    dGeomID sphere = dCreateSphere(0, radius);
+    dGeomSetPosition(sphere, x, y, z);
+    candidates(sphere);
+
+    lo_message msg = lo_message_new();
+    std::vector<dGeomID>::iterator it;
+    for (it=m_candidates.begin(); it!=m_candidates.end(); it++)
+    {
+        dContactGeom c;
+        if (dCollide(sphere, *it, 1, &c, sizeof(dContactGeom)) < 1)
+            continue;
+        OscObject *o = object(*it);
+        if (o)
+            lo_message_add_string(msg, o->c_name());
+    }
+    dGeomDestroy(sphere);
+
+    lo_send_message(address_send, "/world/query/sphere", msg);
+    lo_message_free(msg);
+}
+
+void PhysicsSpatialQuery::nearest(float x, float y, float z, int count)
+{
+    /* Search a growing region until it holds enough objects.  Any
+     * object whose position lies within the region has a bounding
+     * box overlapping it, so the closest ones are never missed. */
+    const dReal max_radius = 1000;
+    dReal radius = 0.05;
+    dGeomID sphere = dCreateSphere(0, radius);
+    dGeomSetPosition(sphere, x, y, z);
+
+    std::vector<std::pair<dReal, OscObject*> > found;
+    while (true)
+    {
+        dGeomSphereSetRadius(sphere, radius);
+        candidates(sphere);
+
+        found.clear();
+        std::vector<dGeomID>::iterator it;
+        for (it=m_candidates.begin(); it!=m_candidates.end(); it++)
+        {
+            // Planes have no position, so use the distance to them.
+            dReal d;
+            if (dGeomGetClass(*it) == dPlaneClass)
+                d = fabs(dGeomPlanePointDepth(*it, x, y, z));
+            else {
+                const dReal *p = dGeomGetPosition(*it);
+                d = sqrt((p[0]-x)*(p[0]-x) + (p[1]-y)*(p[1]-y)
+                         + (p[2]-z)*(p[2]-z));
+            }
+            if (d > radius)
+                continue;
+            OscObject *o = object(*it);
+            if (o)
+                found.push_back(std::make_pair(d, o));
+        }
+
+        if ((int)found.size() >= count || radius >= max_radius)
+            break;
+        radius *= 2;
+    }
+    dGeomDestroy(sphere);
+
+    std::sort(found.begin(), found.end());
+    if ((int)found.size() > count)
+        found.resize(count);
+
+    lo_message msg = lo_message_new();
+    std::vector<std::pair<dReal, OscObject*> >::iterator fit;
+    for (fit=found.begin(); fit!=found.end(); fit++)
+    {
+        lo_message_add_string(msg, fit->second->c_name());
+        lo_message_add_float(msg, fit->first);
+    }
+    lo_send_message(address_send, "/world/query/nearest", msg);
+    lo_message_free(msg);
+}
+
+/****** ODEObject ******/
+
+ODEObject::ODEObject(OscObject *obj, dGeomID odeGeom, dWorldID odeWorld, dSpaceID odeSpace,
+                     bool bStatic)
+    : m_odeWorld(odeWorld), m_odeSpace(odeSpace)
+{
+    m_object = obj;
+
+    m_odeGeom = odeGeom;
+    m_odeBody = NULL;
+
+    m_pSim = NULL;
+    m_index = -1;
+
+    m_pComposite = NULL;
+    m_odeOwnBody = NULL;
+
+    assert(m_odeGeom!=NULL || !bStatic);
+
+    if (bStatic) {
+        dGeomSetData(m_odeGeom, obj);
+
+        if (!obj) return;
+
+        // Only the geom can be moved.  Planes are not placeable, so
+        // their owners handle position themselves.
+        if (dGeomGetClass(m_odeGeom) != dPlaneClass) {
+            obj->m_rotation.setSetCallback(ODEObject::on_set_rotation, this);
+            obj->m_position.setSetCallback(ODEObject::on_set_position, this);
+        }
+        return;
+    }
+
+    m_odeBody = dBodyCreate(m_odeWorld);
+
+    dBodySetPosition(m_odeBody, 0, 0, 0);
+
+    // note: owners must override this by setting the density. can't
+    //       do it here because obj->m_pSpecial is not yet
+    //       initialized.
+    dMassSetSphere(&m_odeMass, 1, 1);
+    dBodySetMass(m_odeBody, &m_odeMass);
+
+    if (m_odeGeom) {
+        dGeomSetPosition(m_odeGeom, 0, 0, 0);
+        dGeomSetBody(m_odeGeom, m_odeBody);
+        dGeomSetData(m_odeGeom, obj);
+    }
+
+    if (!obj) return;
+
+    obj->m_rotation.setSetCallback(ODEObject::on_set_rotation, this);
+    obj->m_position.setSetCallback(ODEObject::on_set_position, this);
+    obj->m_velocity.setSetCallback(ODEObject::on_set_velocity, this);
+    obj->m_accel.setSetCallback(ODEObject::on_set_accel, this);
+    obj->m_force.setSetCallback(ODEObject::on_set_force, this);
+
+    // Values are brought up to date from the body only when queried.
+    obj->m_position.setRefreshCallback(ODEObject::on_refresh, this);
+    obj->m_position.m_magnitude.setRefreshCallback(ODEObject::on_refresh, this);
+    obj->m_velocity.setRefreshCallback(ODEObject::on_refresh, this);
+    obj->m_velocity.m_magnitude.setRefreshCallback(ODEObject::on_refresh, this);
+    obj->m_accel.setRefreshCallback(ODEObject::on_refresh, this);
+    obj->m_accel.m_magnitude.setRefreshCallback(ODEObject::on_refresh, this);
+    obj->m_rotation.setRefreshCallback(ODEObject::on_refresh, this);
+
+    obj->addHandler("push", "ffffff", ODEObject::push_handler);
+
+    m_pSim = static_cast<PhysicsSim*>(obj->simulation());
+    m_pSim->addBody(this);
+}
+
+ODEObject::~ODEObject()
+{
+    if (m_pComposite)
+        m_pComposite->detach(this, false);
+
+    if (m_pSim)
+        m_pSim->removeBody(this);
+
+    if (m_odeBody)  dBodyDestroy(m_odeBody);
+    if (m_odeGeom)  dGeomDestroy(m_odeGeom);
+}
+
+void ODEObject::setGeom(dGeomID odeGeom)
+{
+    // A geom whose body has been disconnected keeps its own pose,
+    // and a part of a composite keeps its offset.
+    dBodyID body = dGeomGetBody(m_odeGeom);
+    if (body) {
+        dGeomSetBody(odeGeom, body);
+        if (attached()) {
+            const dReal *p = dGeomGetOffsetPosition(m_odeGeom);
+            dGeomSetOffsetPosition(odeGeom, p[0], p[1], p[2]);
+            dGeomSetOffsetRotation(odeGeom, dGeomGetOffsetRotation(m_odeGeom));
+        }
+    }
+    else {
+        const dReal *p = dGeomGetPosition(m_odeGeom);
+        dGeomSetPosition(odeGeom, p[0], p[1], p[2]);
+        dGeomSetRotation(odeGeom, dGeomGetRotation(m_odeGeom));
+    }
+    dGeomSetData(odeGeom, m_object);
+
+    dGeomDestroy(m_odeGeom);
+    m_odeGeom = odeGeom;
+}
+
+void ODEObject::update()
+{
+    OscObject *o = object();
+    if (!o) return;
+
+    float t = object()->simulation()->timestep();
+
+    // Set position, velocity & rotation
+    // (without feeding back effect to the simulation)
+    o->m_position.setValue(getPosition(), false);
+    o->m_velocity.setValue(getVelocity(), false);
+    cMatrix3d r = getRotation();
+    o->m_rotation.setd(r(0,0), r(0,1), r(0,2), r(1,0), r(1,1), r(1,2),
+                       r(2,0), r(2,1), r(2,2), false);
+
+    // Acceleration is the change in velocity over the last step.
+    if (m_index >= 0) {
+        const dReal *v = m_pSim->bodyVelocity(m_index);
+        const dReal *pv = m_pSim->bodyPrevVelocity(m_index);
+        o->m_accel.setValue(cVector3d(pv[0]-v[0], pv[1]-v[1], pv[2]-v[2]) / t,
+                            false);
+    }
+}
+
+void ODEObject::on_refresh(void *me, OscValue &v)
+{
+    ((ODEObject*)me)->update();
+}
+
+void ODEObject::on_set_rotation(void *me, OscMatrix3 &r)
+{
+    // Convert from a CHAI rotation matrix to an ODE rotation matrix
+    dMatrix3 m;
+    m[ 0] = r.getCol0().x();
+    m[ 1] = r.getCol0().y();
+    m[ 2] = r.getCol0().z();
+    m[ 3] = 0;
+    m[ 4] = r.getCol1().x();
+    m[ 5] = r.getCol1().y();
+    m[ 6] = r.getCol1().z();
+    m[ 7] = 0;
+    m[ 8] = r.getCol2().x();
+    m[ 9] = r.getCol2().y();
+    m[10] = r.getCol2().z();
+    m[11] = 0;
+
+    // A part of a composite is moved relative to the composite's body.
+    ODEObject *o = (ODEObject*)me;
+    if (o->attached()) {
+        dGeomSetOffsetWorldRotation(o->m_odeGeom, m);
+        o->m_pComposite->updateMass();
+    }
+    else if (o->m_odeGeom)
+        dGeomSetRotation(o->m_odeGeom, m);
+    else
+        dBodySetRotation(o->m_odeBody, m);
+}
+
+void ODEObject::on_set_position(void *me, OscVector3 &p)
+{
+    ODEObject *o = (ODEObject*)me;
+    if (o->attached()) {
+        dGeomSetOffsetWorldPosition(o->m_odeGeom, p.x(), p.y(), p.z());
+        o->m_pComposite->updateMass();
+    }
+    else if (o->m_odeGeom)
+        dGeomSetPosition(o->m_odeGeom, p.x(), p.y(), p.z());
+    else
+        dBodySetPosition(o->m_odeBody, p.x(), p.y(), p.z());
+}
+
+void ODEObject::updateMass()
+{
+    if (m_pComposite)
+        m_pComposite->updateMass();
+    else if (m_odeBody)
+        dBodySetMass(m_odeBody, &m_odeMass);
+}
+
+void ODEObject::on_set_velocity(void *me, OscVector3 &v)
+{
+    dBodySetLinearVel(((ODEObject*)me)->m_odeBody, v.x(), v.y(), v.z());
+}
+
+void ODEObject::on_set_accel(void *_me, OscVector3 &a)
+{
+    OscObject *me = static_cast<OscObject*>(_me);
+    me->m_force.setValue(a / ((ODEObject*)me)->m_odeMass.mass, false);
+    dBodySetForce(((ODEObject*)me)->m_odeBody,
+                  me->m_force.x(), me->m_force.y(), me->m_force.z());
+}
+
+void ODEObject::on_set_force(void *me, OscVector3 &f)
+{
+    dBodyAddForce(((ODEObject*)me)->m_odeBody, f.x(), f.y(), f.z());
+}
+
+
+int ODEObject::push_handler(const char *path, const char *types,
+                            lo_arg **argv, int argc,
+                            void *data, void *user_data)
+{
+    OscObject *me = static_cast<OscObject*>(user_data);
+    ODEObject *ode_object = static_cast<ODEObject*>(me->special());
+    me->m_force.setValue(cVector3d(argv[0]->f, argv[1]->f, argv[2]->f), false);
+    dBodyAddForceAtPos(ode_object->body(),
+                       argv[0]->f, argv[1]->f, argv[2]->f,
+                       argv[3]->f, argv[4]->f, argv[5]->f);
+    return 0;
+}
+
+/****** ODEConstraint ******/
+
+ODEConstraint::ODEConstraint(OscConstraint *c, dJointID odeJoint,
+                             dWorldID odeWorld, dSpaceID odeSpace,
+                             OscObject *object1, OscObject *object2)
+{
+    m_constraint = c;
+    m_odeWorld = odeWorld;
+    m_odeSpace = odeSpace;
+    m_odeBody1 = 0;
+    m_odeBody2 = 0;
+    m_odeJoint = odeJoint;
+
+    ODEObject *o = NULL;
+    if (object1)
+        o = dynamic_cast<ODEObject*>(object1->special());
+
+    if (o)
+        m_odeBody1 = o->m_odeBody;
+
+    if (object2) {
+        o = NULL;
+        if (object2)
+            o = dynamic_cast<ODEObject*>(object2->special());
+        if (o)
+            m_odeBody2 = o->m_odeBody;
+    }
+    else {
+        printf("constraint created with bodies %#x and world.\n", m_odeBody1);
+    }
+
+    if (m_odeJoint)
+        dJointAttach(m_odeJoint, m_odeBody1, m_odeBody2);
+
+    printf("constraint created with bodies %#x and %#x.\n", m_odeBody1, m_odeBody2);
+}
+
+ODEConstraint::~ODEConstraint()
+{
+    if (m_odeJoint)
+        dJointDestroy(m_odeJoint);
+}
+
+void ODEConstraint::disable()
+{
+    if (m_odeJoint) {
+        dJointDisable(m_odeJoint);
+        dJointAttach(m_odeJoint, 0, 0);
+    }
+    m_odeBody1 = 0;
+    m_odeBody2 = 0;
+}
+
+void ODEConstraint::setResponseStops(OscResponse *response,
+                                     JointParamFunction *setParam, int group)
+{
+    if (!m_odeJoint)
+        return;
+
+    // Clear the stops first, since ODE ignores a low stop above the
+    // current high stop and vice versa.
+    setParam(m_odeJoint, dParamLoStop+group, -dInfinity);
+    setParam(m_odeJoint, dParamHiStop+group, dInfinity);
+
+    if (!response->m_implicit.m_value)
+        return;
+
+    // Place both stops at the offset and soften them so that the
+    // solver applies stiffness k and damping d for step size h:
+    // ERP = hk/(hk+d), CFM = 1/(hk+d).
+    dReal h = static_cast<PhysicsSim*>(m_constraint->simulation())->stepSize();
+    dReal k = fabs(response->m_stiffness.m_value);
+    dReal d = fabs(response->m_damping.m_value);
+    dReal hkd = h*k + d;
+    if (hkd <= 0)
+        return;
+
+    setParam(m_odeJoint, dParamStopERP+group, h*k/hkd);
+    setParam(m_odeJoint, dParamStopCFM+group, 1/hkd);
+    setParam(m_odeJoint, dParamLoStop+group, response->m_offset.m_value);
+    setParam(m_odeJoint, dParamHiStop+group, response->m_offset.m_value);
+}
+
+/****** OscSphereODE ******/
+
+OscSphereODE::OscSphereODE(dWorldID odeWorld, dSpaceID odeSpace, const char *name, OscBase *parent)
+    : OscSphere(NULL, name, parent)
+{
+    dGeomID odeGeom = dCreateSphere(odeSpace, m_radius.m_value);
+
+    m_pSpecial = new ODEObject(this, odeGeom, odeWorld, odeSpace);
+    m_density.setValue(m_density.m_value);
+}
+
+void OscSphereODE::on_radius()
+{
+    ODEObject *ode_object = static_cast<ODEObject*>(special());
+    dGeomSphereSetRadius(ode_object->geom(), m_radius.m_value);
+
+    // reset the mass to maintain same density
+    dMassSetSphere(&ode_object->mass(), m_density.m_value, m_radius.m_value);
+
+    m_mass.m_value = ode_object->mass().mass;
+}
+
+void OscSphereODE::on_mass()
+{
+    ODEObject *ode_object = static_cast<ODEObject*>(special());
+    if (m_mass.m_value < 1e-9) {
+        printf("[%s] Mass for %s is too small, setting to 1e-9.\n",
+               simulation()->type_str(), c_name(), m_mass.m_value);
+        m_mass.m_value = 1e-6;
+    }
+    dMassSetSphereTotal(&ode_object->mass(), m_mass.m_value, m_radius.m_value);
+    ode_object->updateMass();
+
+    dReal volume = 4*M_PI*m_radius.m_value*m_radius.m_value*m_radius.m_value/3;
+    m_density.m_value = m_mass.m_value / volume;
+}
+
+void OscSphereODE::on_density()
+{
+    ODEObject *ode_object = static_cast<ODEObject*>(special());
+    dMassSetSphere(&ode_object->mass(), m_density.m_value, m_radius.m_value);
+    ode_object->updateMass();
+
+    m_mass.m_value = ode_object->mass().mass;
+}
+
+/****** OscMeshODE ******/
+
+OscMeshODE::OscMeshODE(dWorldID odeWorld, dSpaceID odeSpace, const char *name,
+                       const char *filename, OscBase *parent)
+    : OscMesh(NULL, name, filename, parent)
+{
+    m_odeData = NULL;
+
+    if (!load(filename)) {
+        printf("[%s] Unable to load %s for object %s.\n",
+               simulation()->type_str(), filename, name);
+        return;
+    }
+
+    ConvexHull hull;
+    if (hull.compute(&m_points[0], m_points.size()/3)) {
+        m_hullVertices = hull.vertices();
+        m_hullTriangles = hull.triangles();
+    }
+    else {
+        printf("[%s] Mesh %s is flat, colliding with its triangles.\n",
+               simulation()->type_str(), name);
+        m_convex.setValue(false, false);
+    }
+
+    printf("[%s] Loaded %s for object %s (%d vertices, %d on hull).\n",
+           simulation()->type_str(), filename, name,
+           (int)m_points.size()/3, (int)m_hullVertices.size());
+
+    // Same initial size as given by OscMeshCHAI.
+    float size = m_extent.length();
+    m_size.setValue(0.1/size, 0.1/size, 0.1/size, false);
+
+    m_pSpecial = new ODEObject(this, createGeom(odeSpace), odeWorld, odeSpace);
+    m_density.setValue(m_density.m_value);
+}
+
+OscMeshODE::~OscMeshODE()
+{
+    // The geom must be destroyed before its data.
+    if (m_pSpecial) {
+        delete m_pSpecial;
+        m_pSpecial = NULL;
+    }
+    if (m_odeData)
+        dGeomTriMeshDataDestroy(m_odeData);
+}
+
+bool OscMeshODE::load(const char *filename)
+{
+    // Share the file parsed by the other simulations so that all of
+    // them see the same vertices.
+    std::shared_ptr<const AssetCache::MeshFile> file =
+        AssetCache::instance().meshFile(filename);
+    if (!file)
+        return false;
+    cMultiMesh *multi = file->mesh;
+
+    for (int m=0; m < multi->getNumMeshes(); m++) {
+        cMesh *mesh = multi->getMesh(m);
+        int first = m_points.size()/3;
+
+        for (unsigned int v=0; v < mesh->getNumVertices(); v++) {
+            cVector3d p(mesh->m_vertices->getLocalPos(v));
+            m_points.push_back(p.x());
+            m_points.push_back(p.y());
+            m_points.push_back(p.z());
+        }
+
+        for (unsigned int t=0; t < mesh->getNumTriangles(); t++) {
+            m_indices.push_back(first + mesh->m_triangles->getVertexIndex0(t));
+            m_indices.push_back(first + mesh->m_triangles->getVertexIndex1(t));
+            m_indices.push_back(first + mesh->m_triangles->getVertexIndex2(t));
+        }
+    }
+
+    if (m_indices.empty()) {
+        m_points.clear();
+        return false;
+    }
+
+    cVector3d vmin(m_points[0], m_points[1], m_points[2]), vmax(vmin);
+    for (unsigned int i=0; i < m_points.size(); i++) {
+        vmin(i%3) = std::min(vmin(i%3), (double)m_points[i]);
+        vmax(i%3) = std::max(vmax(i%3), (double)m_points[i]);
+    }
+    m_extent = vmax - vmin;
+
+    return true;
+}
+
+dGeomID OscMeshODE::createGeom(dSpaceID odeSpace)
+{
+    // Vertices are scaled about the file's origin so that the
+    // bounding box matches the size, as done by OscMeshCHAI.
+    double s[3];
+    for (int k=0; k<3; k++)
+        s[k] = (m_extent(k) > 0) ? m_size(k) / m_extent(k) : 1;
+
+    if (m_convex.m_value && !m_hullTriangles.empty())
+    {
+        int points = m_hullVertices.size();
+        m_hullPoints.resize(points*3);
+        for (int i=0; i < points; i++)
+            for (int k=0; k<3; k++)
+                m_hullPoints[i*3+k] = m_points[m_hullVertices[i]*3+k] * s[k];
+
+        // Scaling changes the face normals, so the planes are
+        // recomputed from the scaled points.
+        int faces = m_hullTriangles.size()/3;
+        m_hullPlanes.resize(faces*4);
+        m_hullPolygons.resize(faces*4);
+        for (int f=0; f < faces; f++) {
+            const int *t = &m_hullTriangles[f*3];
+            const dReal *pa = &m_hullPoints[t[0]*3];
+            const dReal *pb = &m_hullPoints[t[1]*3];
+            const dReal *pc = &m_hullPoints[t[2]*3];
+            cVector3d a(pa[0], pa[1], pa[2]);
+            cVector3d b(pb[0], pb[1], pb[2]);
+            cVector3d c(pc[0], pc[1], pc[2]);
+            cVector3d n(cCross(b-a, c-a));
+            n.normalize();
+
+            m_hullPlanes[f*4+0] = n.x();
+            m_hullPlanes[f*4+1] = n.y();
+            m_hullPlanes[f*4+2] = n.z();
+            m_hullPlanes[f*4+3] = n.dot(a);
+
+            m_hullPolygons[f*4+0] = 3;
+            m_hullPolygons[f*4+1] = t[0];
+            m_hullPolygons[f*4+2] = t[1];
+            m_hullPolygons[f*4+3] = t[2];
+        }
+
+        return dCreateConvex(odeSpace, &m_hullPlanes[0], faces,
+                             &m_hullPoints[0], points, &m_hullPolygons[0]);
+    }
+
+    m_scaled.resize(m_points.size());
+    for (unsigned int i=0; i < m_points.size(); i++)
+        m_scaled[i] = m_points[i] * s[i%3];
+
+    if (!m_odeData)
+        m_odeData = dGeomTriMeshDataCreate();
+    dGeomTriMeshDataBuildSingle(m_odeData, &m_scaled[0], 3*sizeof(float),
+                                m_scaled.size()/3, &m_indices[0],
+                                m_indices.size(), 3*sizeof(dTriIndex));
+
+    return dCreateTriMesh(odeSpace, m_odeData, 0, 0, 0);
+}
+
+void OscMeshODE::on_size()
+{
+    if (m_size.x() <= 0)
+        m_size.x(0.0001);
+    if (m_size.y() <= 0)
+        m_size.y(0.0001);
+    if (m_size.z() <= 0)
+        m_size.z(0.0001);
+
+    ODEObject *ode_object = static_cast<ODEObject*>(special());
+    ode_object->setGeom(createGeom(ode_object->space()));
+
+    // reset the mass to maintain same density
+    on_density();
+}
+
+void OscMeshODE::on_convex()
+{
+    if (m_convex.m_value && m_hullTriangles.empty()) {
+        printf("[%s] Mesh %s has no convex hull.\n",
+               simulation()->type_str(), c_name());
+        m_convex.setValue(false, false);
+        return;
+    }
+
+    ODEObject *ode_object = static_cast<ODEObject*>(special());
+    ode_object->setGeom(createGeom(ode_object->space()));
+}
+
+// The mass of a mesh is approximated by its bounding box.
+
+void OscMeshODE::on_mass()
+{
+    ODEObject *ode_object = static_cast<ODEObject*>(special());
+    dMassSetBoxTotal(&ode_object->mass(), m_mass.m_value,
+                     m_size.x(), m_size.y(), m_size.z());
+    ode_object->updateMass();
+
+    dReal volume = m_size.x() * m_size.y() * m_size.z();
+    m_density.m_value = m_mass.m_value / volume;
+}
+
+void OscMeshODE::on_density()
+{
+    ODEObject *ode_object = static_cast<ODEObject*>(special());
+    dMassSetBox(&ode_object->mass(), m_density.m_value,
+                m_size.x(), m_size.y(), m_size.z());
+    ode_object->updateMass();
+
+    m_mass.m_value = ode_object->mass().mass;
+}
+
+/****** OscPlaneODE ******/
+
+OscPlaneODE::OscPlaneODE(dWorldID odeWorld, dSpaceID odeSpace, const char *name, OscBase *parent)
+    : OscPlane(NULL, name, parent)
+{
+    dGeomID odeGeom = dCreatePlane(odeSpace, 0, 0, 1, 0);
+
+    m_pSpecial = new ODEObject(this, odeGeom, odeWorld, odeSpace, true);
+}
+
+void OscPlaneODE::setParams()
+{
+    if (m_normal.length() == 0)
+        m_normal.setValue(0, 0, 1, false);
+    else
+        m_normal.normalize();
+
+    ODEObject *ode_object = static_cast<ODEObject*>(special());
+    dGeomPlaneSetParams(ode_object->geom(),
+                        m_normal.x(), m_normal.y(), m_normal.z(),
+                        m_normal.dot(m_position));
+}
+
+/****** OscCapsuleODE ******/
+
+OscCapsuleODE::OscCapsuleODE(dWorldID odeWorld, dSpaceID odeSpace, const char *name, OscBase *parent)
+    : OscCapsule(NULL, name, parent)
+{
+    dGeomID odeGeom = dCreateCapsule(odeSpace, m_radius.m_value,
+                                     m_length.m_value);
+
+    m_pSpecial = new ODEObject(this, odeGeom, odeWorld, odeSpace);
+    m_density.setValue(m_density.m_value);
+}
+
+void OscCapsuleODE::on_size()
+{
+    if (m_radius.m_value <= 0)
+        m_radius.m_value = 0.0001;
+    if (m_length.m_value < 0)
+        m_length.m_value = 0;
+
+    ODEObject *ode_object = static_cast<ODEObject*>(special());
+    dGeomCapsuleSetParams(ode_object->geom(), m_radius.m_value,
+                          m_length.m_value);
+
+    // reset the mass to maintain same density
+    on_density();
+}
+
+void OscCapsuleODE::on_mass()
+{
+    ODEObject *ode_object = static_cast<ODEObject*>(special());
+    dMassSetCapsuleTotal(&ode_object->mass(), m_mass.m_value, 3,
+                         m_radius.m_value, m_length.m_value);
+    ode_object->updateMass();
+
+    dReal r = m_radius.m_value;
+    dReal volume = M_PI*r*r*(m_length.m_value + 4*r/3);
+    m_density.m_value = m_mass.m_value / volume;
+}
+
+void OscCapsuleODE::on_density()
+{
+    ODEObject *ode_object = static_cast<ODEObject*>(special());
+    dMassSetCapsule(&ode_object->mass(), m_density.m_value, 3,
+                    m_radius.m_value, m_length.m_value);
+    ode_object->updateMass();
+
+    m_mass.m_value = ode_object->mass().mass;
+}
+
+/****** OscCylinderODE ******/
+
+OscCylinderODE::OscCylinderODE(dWorldID odeWorld, dSpaceID odeSpace, const char *name, OscBase *parent)
+    : OscCylinder(NULL, name, parent)
+{
+    dGeomID odeGeom = dCreateCylinder(odeSpace, m_radius.m_value,
+                                      m_length.m_value);
+
+    m_pSpecial = new ODEObject(this, odeGeom, odeWorld, odeSpace);
+    m_density.setValue(m_density.m_value);
+}
+
+void OscCylinderODE::on_size()
+{
+    if (m_radius.m_value <= 0)
+        m_radius.m_value = 0.0001;
+    if (m_length.m_value <= 0)
+        m_length.m_value = 0.0001;
+
+    ODEObject *ode_object = static_cast<ODEObject*>(special());
+    dGeomCylinderSetParams(ode_object->geom(), m_radius.m_value,
+                           m_length.m_value);
+
+    // reset the mass to maintain same density
+    on_density();
+}
+
+void OscCylinderODE::on_mass()
+{
+    ODEObject *ode_object = static_cast<ODEObject*>(special());
+    dMassSetCylinderTotal(&ode_object->mass(), m_mass.m_value, 3,
+                          m_radius.m_value, m_length.m_value);
+    ode_object->updateMass();
+
+    dReal volume = M_PI*m_radius.m_value*m_radius.m_value*m_length.m_value;
+    m_density.m_value = m_mass.m_value / volume;
+}
+
+void OscCylinderODE::on_density()
+{
+    ODEObject *ode_object = static_cast<ODEObject*>(special());
+    dMassSetCylinder(&ode_object->mass(), m_density.m_value, 3,
+                     m_radius.m_value, m_length.m_value);
+    ode_object->updateMass();
+
+    m_mass.m_value = ode_object->mass().mass;
+}
+
+/****** OscHeightfieldODE ******/
+
+OscHeightfieldODE::OscHeightfieldODE(dWorldID odeWorld, dSpaceID odeSpace,
+                                     const char *name, int columns, int rows,
+                                     OscBase *parent)
+    : OscHeightfield(NULL, name, columns, rows, parent)
+{
+    // The heights are referenced, not copied, so that changing them
+    // only requires updating the bounds.
+    m_odeData = dGeomHeightfieldDataCreate();
+    on_size();
+
+    dGeomID odeGeom = dCreateHeightfield(odeSpace, m_odeData, 1);
+
+    m_pSpecial = new ODEObject(this, odeGeom, odeWorld, odeSpace, true);
+
+    // Rotation is combined with the Y-up to Z-up rotation here
+    // instead of being set on the geom directly.
+    m_rotation.setSetCallback(set_rotation, this);
+    on_rotation();
+}
+
+OscHeightfieldODE::~OscHeightfieldODE()
+{
+    // The geom must be destroyed before its data.
+    if (m_pSpecial) {
+        delete m_pSpecial;
+        m_pSpecial = NULL;
+    }
+    dGeomHeightfieldDataDestroy(m_odeData);
+}
+
+void OscHeightfieldODE::on_size()
+{
+    if (m_size.x() <= 0)
+        m_size.x(0.0001);
+    if (m_size.y() <= 0)
+        m_size.y(0.0001);
+
+    dGeomHeightfieldDataBuildSingle(m_odeData, &m_heights[0], 0,
+                                    m_size.x(), m_size.y(),
+                                    m_columns, m_rows,
+                                    m_size.z(), 0, 0.1, 0);
+    on_heights(0, m_heights.size());
+}
+
+void OscHeightfieldODE::on_rotation()
+{
+    // Convert from a CHAI rotation matrix to an ODE rotation matrix,
+    // then rotate the heightfield's Y axis to Z.
+    dReal r[3][3] = {
+        { m_rotation.getCol0().x(), m_rotation.getCol0().y(), m_rotation.getCol0().z() },
+        { m_rotation.getCol1().x(), m_rotation.getCol1().y(), m_rotation.getCol1().z() },
+        { m_rotation.getCol2().x(), m_rotation.getCol2().y(), m_rotation.getCol2().z() } };
+    const dReal up[3][3] = { { 1, 0, 0 }, { 0, 0, -1 }, { 0, 1, 0 } };
+
+    dMatrix3 m;
+    for (int i=0; i<3; i++) {
+        for (int j=0; j<3; j++)
+            m[i*4+j] = r[i][0]*up[0][j] + r[i][1]*up[1][j] + r[i][2]*up[2][j];
+        m[i*4+3] = 0;
+    }
+
+    ODEObject *ode_object = static_cast<ODEObject*>(special());
+    if (ode_object)
+        dGeomSetRotation(ode_object->geom(), m);
+}
+
+void OscHeightfieldODE::on_heights(int first, int count)
+{
+    std::vector<float>::iterator lo, hi;
+    lo = std::min_element(m_heights.begin(), m_heights.end());
+    hi = std::max_element(m_heights.begin(), m_heights.end());
+    dGeomHeightfieldDataSetBounds(m_odeData, *lo * m_size.z(),
+                                  *hi * m_size.z());
+
+    // Changing the bounds does not mark the geom dirty, so set its
+    // position again for the space to recompute its AABB.
+    ODEObject *ode_object = static_cast<ODEObject*>(special());
+    if (ode_object && ode_object->geom()) {
+        const dReal *p = dGeomGetPosition(ode_object->geom());
+        dGeomSetPosition(ode_object->geom(), p[0], p[1], p[2]);
+    }
+}
+
+/****** OscCompositeODE ******/
+
+OscCompositeODE::OscCompositeODE(dWorldID odeWorld, dSpaceID odeSpace,
+                                 const char *name, OscBase *parent)
+    : OscComposite(NULL, name, parent)
+{
+    m_pSpecial = new ODEObject(this, NULL, odeWorld, odeSpace);
+    m_mass.m_value = static_cast<ODEObject*>(m_pSpecial)->mass().mass;
+}
+
+OscCompositeODE::~OscCompositeODE()
+{
+    // Parts continue as separate objects.
+    while (!m_parts.empty())
+        detach(m_parts.back());
+}
+
+void OscCompositeODE::on_add(const char *name)
+{
+    OscObject *o = simulation()->find_object(name);
+    ODEObject *part = o ? dynamic_cast<ODEObject*>(o->special()) : NULL;
+
+    if (!part || !part->geom() || !part->body()) {
+        printf("[%s] %s cannot be a part of %s.\n",
+               simulation()->type_str(), name, c_name());
+        return;
+    }
+    if (part->attached()) {
+        printf("[%s] %s is already a part of a composite.\n",
+               simulation()->type_str(), name);
+        return;
+    }
+    if (!o->m_constraintList.empty()) {
+        printf("[%s] %s has constraints and cannot be a part of %s.\n",
+               simulation()->type_str(), name, c_name());
+        return;
+    }
+
+    // Attach the geom to the composite's body where it is now.
+    dBodyID body = static_cast<ODEObject*>(special())->body();
+    dGeomID geom = part->geom();
+    dVector3 pos;
+    dMatrix3 rot;
+    dCopyVector3(pos, dGeomGetPosition(geom));
+    std::copy(dGeomGetRotation(geom), dGeomGetRotation(geom)+12, rot);
+
+    dGeomSetBody(geom, body);
+    dGeomSetOffsetWorldPosition(geom, pos[0], pos[1], pos[2]);
+    dGeomSetOffsetWorldRotation(geom, rot);
+
+    dBodyDisable(part->m_odeBody);
+    part->m_odeOwnBody = part->m_odeBody;
+    part->m_odeBody = body;
+    part->m_pComposite = this;
+
+    m_parts.push_back(part);
+    updateMass();
+}
+
+void OscCompositeODE::on_remove(const char *name)
+{
+    OscObject *o = simulation()->find_object(name);
+    ODEObject *part = o ? dynamic_cast<ODEObject*>(o->special()) : NULL;
+
+    if (!part || part->composite() != this) {
+        printf("[%s] %s is not a part of %s.\n",
+               simulation()->type_str(), name, c_name());
+        return;
+    }
+
+    // Constraints made on a part act on the composite's body.
+    if (!o->m_constraintList.empty()) {
+        printf("[%s] %s has constraints and cannot be removed from %s.\n",
+               simulation()->type_str(), name, c_name());
+        return;
+    }
+
+    detach(part);
+}
+
+void OscCompositeODE::detach(ODEObject *part, bool restore)
+{
+    std::vector<ODEObject*>::iterator it;
+    it = std::find(m_parts.begin(), m_parts.end(), part);
+    if (it == m_parts.end())
+        return;
+    m_parts.erase(it);
+
+    // The part continues from its place in the composite, moving
+    // as that point of the composite was moving.
+    if (restore) {
+        dGeomID geom = part->geom();
+        dBodyID own = part->m_odeOwnBody;
+        const dReal *p = dGeomGetPosition(geom);
+        const dReal *w = dBodyGetAngularVel(part->m_odeBody);
+        dVector3 v;
+        dBodyGetPointVel(part->m_odeBody, p[0], p[1], p[2], v);
+
+        dBodySetPosition(own, p[0], p[1], p[2]);
+        dBodySetRotation(own, dGeomGetRotation(geom));
+        dBodySetLinearVel(own, v[0], v[1], v[2]);
+        dBodySetAngularVel(own, w[0], w[1], w[2]);
+        dBodySetMass(own, &part->mass());
+
+        // Clears the offset.
+        dGeomSetBody(geom, own);
+        dBodyEnable(own);
+    }
 
-    Simulation::initialize();
+    part->m_odeBody = part->m_odeOwnBody;
+    part->m_odeOwnBody = NULL;
+    part->m_pComposite = NULL;
+
+    updateMass();
 }
 
-void PhysicsSim::step()
+void OscCompositeODE::updateMass()
 {
-    // Add extra forces to objects
-    // Grabbed object attraction
-    if (m_pGrabbedObject)
+    if (m_parts.empty())
+        return;
+
+    ODEObject *ode_object = static_cast<ODEObject*>(special());
+    dBodyID body = ode_object->body();
+
+    // Sum the masses of the parts, each placed at its offset.
+    dMass total;
+    dMassSetZero(&total);
+    std::vector<ODEObject*>::iterator it;
+    for (it=m_parts.begin(); it!=m_parts.end(); it++)
     {
-        cVector3d grab_force(m_pGrabbedObject->getPosition()
-                             - m_pCursor->m_position);
+        dMass m = (*it)->mass();
+        const dReal *p = dGeomGetOffsetPosition((*it)->geom());
+        dMassRotate(&m, dGeomGetOffsetRotation((*it)->geom()));
+        dMassTranslate(&m, p[0], p[1], p[2]);
+        dMassAdd(&total, &m);
+    }
 
-        grab_force.mul(-fabs(m_grab_stiffness.m_value));
-        grab_force.add(m_pGrabbedODEObject->getVelocity()*(-fabs(m_grab_damping.m_value)));
-        dBodyAddForce(m_pGrabbedODEObject->body(),
-                      grab_force.x(), grab_force.y(), grab_force.z());
+    // ODE requires the centre of mass to be at the body's origin, so
+    // the body is moved there and the parts are moved back by the
+    // same amount to stay in place.
+    dReal c[3] = { total.c[0], total.c[1], total.c[2] };
+    dMassTranslate(&total, -c[0], -c[1], -c[2]);
+    for (it=m_parts.begin(); it!=m_parts.end(); it++)
+    {
+        const dReal *p = dGeomGetOffsetPosition((*it)->geom());
+        dGeomSetOffsetPosition((*it)->geom(),
+                               p[0]-c[0], p[1]-c[1], p[2]-c[2]);
     }
 
-    // Perform simulation step
-	dSpaceCollide (m_odeSpace, this, &ode_nearCallback);
-	dWorldQuickStep (m_odeWorld, m_fTimestep);
-	dJointGroupEmpty (m_odeContactGroup);
+    dVector3 pos, vel;
+    dBodyGetRelPointPos(body, c[0], c[1], c[2], pos);
+    dBodyGetRelPointVel(body, c[0], c[1], c[2], vel);
+    dBodySetPosition(body, pos[0], pos[1], pos[2]);
+    dBodySetLinearVel(body, vel[0], vel[1], vel[2]);
 
-    /* Update positions of each object in the other simulations */
-    std::map<std::string,OscObject*>::iterator it;
-    for (it=world_objects.begin(); it!=world_objects.end(); it++)
-    {
-        ODEObject *o = static_cast<ODEObject*>(it->second->special());
+    ode_object->mass() = total;
+    dBodySetMass(body, &total);
+    m_mass.m_value = total.mass;
+}
 
-        if (o) {
-            o->update();
-            cVector3d pos(o->getPosition());
-            cMatrix3d rot(o->getRotation());
-            send(true, (it->second->path()+"/position").c_str(), "fff",
-                 pos.x(),pos.y(),pos.z());
-            send(true, (it->second->path()+"/rotation").c_str(), "fffffffff",
-                 rot(0,0), rot(0,1), rot(0,2),
-                 rot(1,0), rot(1,1), rot(1,2),
-                 rot(2,0), rot(2,1), rot(2,2));
-        }
+void OscCompositeODE::on_mass()
+{
+    ODEObject *ode_object = static_cast<ODEObject*>(special());
+    if (m_mass.m_value < 1e-9) {
+        printf("[%s] Mass for %s is too small, setting to 1e-9.\n",
+               simulation()->type_str(), c_name());
+        m_mass.m_value = 1e-9;
     }
 
-    /* Update the responses of each constraint. */
-    std::map<std::string,OscConstraint*>::iterator cit;
-    for (cit=world_constraints.begin(); cit!=world_constraints.end(); cit++)
+    if (m_parts.empty()) {
+        dMassAdjust(&ode_object->mass(), m_mass.m_value);
+        ode_object->updateMass();
+        return;
+    }
+
+    // Scale the mass of each part by the same amount.
+    dReal scale = m_mass.m_value / ode_object->mass().mass;
+    std::vector<ODEObject*>::iterator it;
+    for (it=m_parts.begin(); it!=m_parts.end(); it++)
     {
-        cit->second->simulationCallback();
+        dMass &m = (*it)->mass();
+        dMassAdjust(&m, m.mass * scale);
+        OscObject *o = (*it)->object();
+        o->m_mass.m_value = m.mass;
+        o->m_density.m_value *= scale;
     }
 
-    m_counter++;
+    updateMass();
 }
 
-void PhysicsSim::ode_nearCallback (void *data, dGeomID o1, dGeomID o2)
+/****** OscFieldODE ******/
+
+OscFieldODE::OscFieldODE(const char *name, FieldType type, OscBase *parent)
+    : OscField(NULL, name, type, parent)
 {
-    PhysicsSim *me = static_cast<PhysicsSim*>(data);
+    m_pSim = static_cast<PhysicsSim*>(simulation());
+    m_pSim->addField(this);
+}
 
-    int i;
+OscFieldODE::~OscFieldODE()
+{
+    m_pSim->removeField(this);
+}
 
-    // exit without doing anything if the two bodies are connected by a joint
-    dBodyID b1 = dGeomGetBody(o1);
-    dBodyID b2 = dGeomGetBody(o2);
-    if (b1 && b2 && dAreConnectedExcluding (b1,b2,dJointTypeContact)) return;
+void OscFieldODE::evaluate(int count, const dReal *position,
+                           const dReal *velocity, dReal *force, dReal time)
+{
+    const dReal c[3] = { m_position.x(), m_position.y(), m_position.z() };
+    const dReal strength = m_strength.m_value;
+    if (strength == 0)
+        return;
 
-    dContact contact[MAX_CONTACTS];   // up to MAX_CONTACTS contacts per box-box
-    for (i=0; i<MAX_CONTACTS; i++) {
-        contact[i].surface.mode = dContactBounce | dContactSoftCFM;
-        contact[i].surface.mu = dInfinity;
-        contact[i].surface.mu2 = 0;
-        contact[i].surface.bounce = 0.1;
-        contact[i].surface.bounce_vel = 0.1;
-        contact[i].surface.soft_cfm = 0.01;
+    switch (m_type)
+    {
+    case FIELD_RADIAL:
+        // Away from the center, or towards it for negative strength.
+        for (int i=0; i<count; i++) {
+            const dReal *p = &position[i*3];
+            dReal d[3] = { p[0]-c[0], p[1]-c[1], p[2]-c[2] };
+            dReal len = sqrt(d[0]*d[0] + d[1]*d[1] + d[2]*d[2]);
+            dReal s = (len > 1e-9) ? strength * scale(len) / len : 0;
+            force[i*3+0] += d[0]*s;
+            force[i*3+1] += d[1]*s;
+            force[i*3+2] += d[2]*s;
+        }
+        break;
+
+    case FIELD_VORTEX: {
+        // Around the axis through the center, counter-clockwise when
+        // the axis points towards the viewer.
+        cVector3d a(m_axis);
+        if (a.length() == 0)
+            return;
+        a.normalize();
+        for (int i=0; i<count; i++) {
+            const dReal *p = &position[i*3];
+            dReal d[3] = { p[0]-c[0], p[1]-c[1], p[2]-c[2] };
+            dReal t[3] = { a.y()*d[2] - a.z()*d[1],
+                           a.z()*d[0] - a.x()*d[2],
+                           a.x()*d[1] - a.y()*d[0] };
+            dReal len = sqrt(t[0]*t[0] + t[1]*t[1] + t[2]*t[2]);
+            dReal dist = sqrt(d[0]*d[0] + d[1]*d[1] + d[2]*d[2]);
+            dReal s = (len > 1e-9) ? strength * scale(dist) / len : 0;
+            force[i*3+0] += t[0]*s;
+            force[i*3+1] += t[1]*s;
+            force[i*3+2] += t[2]*s;
+        }
+        break;
     }
 
-	if (int numc = dCollide (o1,o2,MAX_CONTACTS,&contact[0].geom,sizeof(dContact)))
-	{
-        OscObject *p1 = static_cast<OscObject*>(dGeomGetData(o1));
-        OscObject *p2 = static_cast<OscObject*>(dGeomGetData(o2));
-        if (p1 && p2) {
-            bool co1 = p1->collidedWith(p2, me->m_counter);
-            bool co2 = p2->collidedWith(p1, me->m_counter);
-            if ( (co1 || co2) && me->m_collide.m_value ) {
-                lo_send(address_send, "/world/collide", "ssf",
-                        p1->c_name(), p2->c_name(),
-                        (double)(p1->m_velocity - p2->m_velocity).length());
-            }
-            // TODO: this strategy will NOT work for multiple collisions between same objects!!
+    case FIELD_DRAG: {
+        // Against velocity relative to the field's own velocity.
+        const dReal w[3] = { m_velocity.x(), m_velocity.y(), m_velocity.z() };
+        for (int i=0; i<count; i++) {
+            const dReal *p = &position[i*3];
+            const dReal *v = &velocity[i*3];
+            dReal d[3] = { p[0]-c[0], p[1]-c[1], p[2]-c[2] };
+            dReal s = -strength * scale(sqrt(d[0]*d[0] + d[1]*d[1] + d[2]*d[2]));
+            force[i*3+0] += (v[0]-w[0])*s;
+            force[i*3+1] += (v[1]-w[1])*s;
+            force[i*3+2] += (v[2]-w[2])*s;
         }
-		for (i=0; i<numc; i++) {
-			dJointID c = dJointCreateContact (me->m_odeWorld, me->m_odeContactGroup, contact+i);
-			dJointAttach (c,b1,b2);
-		}
-	}
-}
+        break;
+    }
 
-void PhysicsSim::set_grabbed(OscObject *pGrabbed)
-{
-    Simulation::set_grabbed(pGrabbed);
-    m_pGrabbedODEObject = NULL;
-    if (pGrabbed)
-        m_pGrabbedODEObject = dynamic_cast<ODEObject*>(pGrabbed->special());
+    case FIELD_NOISE: {
+        // A smooth pattern drifting over time, made from products of
+        // waves along different directions for each component.
+        const dReal f = m_frequency.m_value;
+        for (int i=0; i<count; i++) {
+            const dReal *p = &position[i*3];
+            dReal d[3] = { p[0]-c[0], p[1]-c[1], p[2]-c[2] };
+            dReal s = strength * scale(sqrt(d[0]*d[0] + d[1]*d[1] + d[2]*d[2]));
+            force[i*3+0] += s * sin(f*(0.8*p[1] + 0.6*p[2]) + 1.3*time)
+                              * cos(f*(0.6*p[0] - 0.8*p[2]) + 0.7*time);
+            force[i*3+1] += s * sin(f*(0.8*p[2] + 0.6*p[0]) + 1.1*time)
+                              * cos(f*(0.6*p[1] - 0.8*p[0]) + 0.9*time);
+            force[i*3+2] += s * sin(f*(0.8*p[0] + 0.6*p[1]) + 0.7*time)
+                              * cos(f*(0.6*p[2] - 0.8*p[1]) + 1.3*time);
+        }
+        break;
+    }
+
+    default:
+        break;
+    }
 }
 
-/****** ODEObject ******/
+/****** OscParticlesODE ******/
 
-ODEObject::ODEObject(OscObject *obj, dGeomID odeGeom, dWorldID odeWorld, dSpaceID odeSpace)
-    : m_odeWorld(odeWorld), m_odeSpace(odeSpace)
+OscParticlesODE::OscParticlesODE(dWorldID odeWorld, dSpaceID odeSpace,
+                                 const char *name, int count,
+                                 OscBase *parent)
+    : OscParticles(NULL, name, count, parent), m_odeWorld(odeWorld)
 {
-    m_object = obj;
+    m_odeSpace = dHashSpaceCreate(odeSpace);
+
+    m_bodies.resize(count);
+    m_geoms.resize(count);
+    m_positions.resize(count*3, 0);
+    for (int i=0; i<count; i++) {
+        m_bodies[i] = dBodyCreate(m_odeWorld);
+        m_geoms[i] = dCreateSphere(m_odeSpace, m_radius.m_value);
+        dGeomSetBody(m_geoms[i], m_bodies[i]);
+    }
 
-    m_odeGeom = odeGeom;
-    m_odeBody = NULL;
-    m_odeBody = dBodyCreate(m_odeWorld);
+    m_nextChunk = 0;
+    m_positionsPath = path()+"/positions";
 
-    assert(m_odeGeom!=NULL);
+    // Position and velocity report the mean over all particles.
+    m_position.setRefreshCallback(on_refresh, this);
+    m_velocity.setRefreshCallback(on_refresh, this);
 
-    dBodySetPosition(m_odeBody, 0, 0, 0);
-    dGeomSetPosition(m_odeGeom, 0, 0, 0);
+    addHandler("positions/get", "", positions_get_handler);
 
-    // note: owners must override this by setting the density. can't
-    //       do it here because obj->m_pSpecial is not yet
-    //       initialized.
-    dMassSetSphere(&m_odeMass, 1, 1);
-    dBodySetMass(m_odeBody, &m_odeMass);
+    m_pSim = static_cast<PhysicsSim*>(simulation());
+    m_pSim->addParticles(this);
 
-    dGeomSetBody(m_odeGeom, m_odeBody);
-    dGeomSetData(m_odeGeom, obj);
+    m_radius.setValue(m_radius.m_value);
+}
 
-    if (!obj) return;
+OscParticlesODE::~OscParticlesODE()
+{
+    m_pSim->removeParticles(this);
 
-    obj->m_rotation.setSetCallback(ODEObject::on_set_rotation, this);
-    obj->m_position.setSetCallback(ODEObject::on_set_position, this);
-    obj->m_velocity.setSetCallback(ODEObject::on_set_velocity, this);
-    obj->m_accel.setSetCallback(ODEObject::on_set_accel, this);
-    obj->m_force.setSetCallback(ODEObject::on_set_force, this);
+    for (unsigned int i=0; i<m_bodies.size(); i++)
+        dBodyDestroy(m_bodies[i]);
 
-    obj->addHandler("push", "ffffff", ODEObject::push_handler);
+    // Also destroys the particle geoms.
+    dSpaceDestroy(m_odeSpace);
 }
 
-ODEObject::~ODEObject()
+void OscParticlesODE::update()
 {
-    if (m_odeBody)  dBodyDestroy(m_odeBody);
-    if (m_odeGeom)  dGeomDestroy(m_odeGeom);
+    float *pos = &m_positions[0];
+    for (int i=0; i<m_count; i++) {
+        const dReal *p = dBodyGetPosition(m_bodies[i]);
+        pos[i*3+0] = p[0];
+        pos[i*3+1] = p[1];
+        pos[i*3+2] = p[2];
+    }
 }
 
-void ODEObject::update()
+void OscParticlesODE::publish()
 {
-    OscObject *o = object();
-    if (!o) return;
+    int chunks = (m_count + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    int steps = (int)(visual_timestep_ms / physics_timestep_ms);
+    if (steps < 1)
+        steps = 1;
+    int chunksPerStep = (chunks + steps - 1) / steps;
 
-    cVector3d vel(o->m_velocity);
-    float t = object()->simulation()->timestep();
+    for (int c=0; c < chunksPerStep; c++)
+    {
+        if (m_nextChunk >= chunks)
+            m_nextChunk = 0;
 
-    // Set position & velocity
-    // (without feeding back effect to the simulation)
-    o->m_position.setValue(getPosition(), false);
-    o->m_velocity.setValue(getVelocity(), false);
-    o->m_accel.setValue((vel - o->m_velocity) / t, false);
-}
+        int first = m_nextChunk * CHUNK_SIZE;
+        int n = std::min(CHUNK_SIZE, m_count - first);
+        lo_blob b = lo_blob_new(n*3*sizeof(float), &m_positions[first*3]);
+        simulation()->sendtotype(Simulation::ST_VISUAL, 0,
+                                 m_positionsPath.c_str(), "ib", first, b);
+        lo_blob_free(b);
 
-void ODEObject::on_set_rotation(void *me, OscMatrix3 &r)
-{
-    // Convert from a CHAI rotation matrix to an ODE rotation matrix
-    dMatrix3 m;
-    m[ 0] = r.getCol0().x();
-    m[ 1] = r.getCol0().y();
-    m[ 2] = r.getCol0().z();
-    m[ 3] = 0;
-    m[ 4] = r.getCol1().x();
-    m[ 5] = r.getCol1().y();
-    m[ 6] = r.getCol1().z();
-    m[ 7] = 0;
-    m[ 8] = r.getCol2().x();
-    m[ 9] = r.getCol2().y();
-    m[10] = r.getCol2().z();
-    m[11] = 0;
-    dGeomSetRotation(((ODEObject*)me)->m_odeGeom, m);
+        m_nextChunk++;
+    }
 }
 
-void ODEObject::on_set_position(void *me, OscVector3 &p)
+void OscParticlesODE::arrange()
 {
-    dGeomSetPosition(((ODEObject*)me)->m_odeGeom, p.x(), p.y(), p.z());
-}
+    int side = (int)ceil(pow(m_count, 1.0/3.0));
+    dReal spacing = m_radius.m_value*2.2;
+    dReal offset = (side-1)*spacing/2;
+
+    for (int i=0; i<m_count; i++) {
+        dBodySetPosition(m_bodies[i],
+                         m_position.x() - offset + (i % side)*spacing,
+                         m_position.y() - offset + ((i / side) % side)*spacing,
+                         m_position.z() - offset + (i / (side*side))*spacing);
+        dBodySetLinearVel(m_bodies[i], 0, 0, 0);
+        dBodySetAngularVel(m_bodies[i], 0, 0, 0);
+    }
 
-void ODEObject::on_set_velocity(void *me, OscVector3 &v)
-{
-    dBodySetLinearVel(((ODEObject*)me)->m_odeBody, v.x(), v.y(), v.z());
+    update();
 }
 
-void ODEObject::on_set_accel(void *_me, OscVector3 &a)
+void OscParticlesODE::setMass()
 {
-    OscObject *me = static_cast<OscObject*>(_me);
-    me->m_force.setValue(a / ((ODEObject*)me)->m_odeMass.mass, false);
-    dBodySetForce(((ODEObject*)me)->m_odeBody,
-                  me->m_force.x(), me->m_force.y(), me->m_force.z());
+    dMass mass;
+    dMassSetSphere(&mass, m_density.m_value, m_radius.m_value);
+    for (int i=0; i<m_count; i++)
+        dBodySetMass(m_bodies[i], &mass);
+
+    m_mass.m_value = mass.mass;
 }
 
-void ODEObject::on_set_force(void *me, OscVector3 &f)
+void OscParticlesODE::on_refresh(void *_me, OscValue &v)
 {
-    dBodyAddForce(((ODEObject*)me)->m_odeBody, f.x(), f.y(), f.z());
-}
+    OscParticlesODE *me = static_cast<OscParticlesODE*>(_me);
+    if (me->m_count < 1)
+        return;
+
+    cVector3d pos, vel;
+    for (int i=0; i<me->m_count; i++) {
+        const dReal *p = dBodyGetPosition(me->m_bodies[i]);
+        const dReal *v = dBodyGetLinearVel(me->m_bodies[i]);
+        pos.add(cVector3d(p[0], p[1], p[2]));
+        vel.add(cVector3d(v[0], v[1], v[2]));
+    }
 
+    me->m_position.setValue(pos / me->m_count, false);
+    me->m_velocity.setValue(vel / me->m_count, false);
+}
 
-int ODEObject::push_handler(const char *path, const char *types,
-                            lo_arg **argv, int argc,
-                            void *data, void *user_data)
+void OscParticlesODE::on_position()
 {
-    OscObject *me = static_cast<OscObject*>(user_data);
-    ODEObject *ode_object = static_cast<ODEObject*>(me->special());
-    me->m_force.setValue(cVector3d(argv[0]->f, argv[1]->f, argv[2]->f), false);
-    dBodyAddForceAtPos(ode_object->body(),
-                       argv[0]->f, argv[1]->f, argv[2]->f,
-                       argv[3]->f, argv[4]->f, argv[5]->f);
-    return 0;
+    arrange();
 }
 
-/****** ODEConstraint ******/
-
-ODEConstraint::ODEConstraint(OscConstraint *c, dJointID odeJoint,
-                             dWorldID odeWorld, dSpaceID odeSpace,
-                             OscObject *object1, OscObject *object2)
+void OscParticlesODE::on_velocity()
 {
-    m_constraint = c;
-    m_odeWorld = odeWorld;
-    m_odeSpace = odeSpace;
-    m_odeBody1 = 0;
-    m_odeBody2 = 0;
-    m_odeJoint = odeJoint;
-
-    ODEObject *o = NULL;
-    if (object1)
-        o = dynamic_cast<ODEObject*>(object1->special());
-
-    if (o)
-        m_odeBody1 = o->m_odeBody;
-
-    if (object2) {
-        o = NULL;
-        if (object2)
-            o = dynamic_cast<ODEObject*>(object2->special());
-        if (o)
-            m_odeBody2 = o->m_odeBody;
-    }
-    else {
-        printf("constraint created with bodies %#x and world.\n", m_odeBody1);
-    }
-
-    if (m_odeJoint)
-        dJointAttach(m_odeJoint, m_odeBody1, m_odeBody2);
-
-    printf("constraint created with bodies %#x and %#x.\n", m_odeBody1, m_odeBody2);
+    for (int i=0; i<m_count; i++)
+        dBodySetLinearVel(m_bodies[i],
+                          m_velocity.x(), m_velocity.y(), m_velocity.z());
 }
 
-ODEConstraint::~ODEConstraint()
+void OscParticlesODE::on_force()
 {
-    if (m_odeJoint)
-        dJointDestroy(m_odeJoint);
+    // The force is applied to each particle.
+    for (int i=0; i<m_count; i++)
+        dBodyAddForce(m_bodies[i], m_force.x(), m_force.y(), m_force.z());
 }
 
-/****** OscSphereODE ******/
-
-OscSphereODE::OscSphereODE(dWorldID odeWorld, dSpaceID odeSpace, const char *name, OscBase *parent)
-    : OscSphere(NULL, name, parent)
+void OscParticlesODE::on_radius()
 {
-    dGeomID odeGeom = dCreateSphere(odeSpace, m_radius.m_value);
+    if (m_radius.m_value <= 0)
+        m_radius.m_value = 0.0001;
 
-    m_pSpecial = new ODEObject(this, odeGeom, odeWorld, odeSpace);
-    m_density.setValue(m_density.m_value);
-}
+    for (int i=0; i<m_count; i++)
+        dGeomSphereSetRadius(m_geoms[i], m_radius.m_value);
 
-void OscSphereODE::on_radius()
-{
-    ODEObject *ode_object = static_cast<ODEObject*>(special());
-    dGeomSphereSetRadius(ode_object->geom(), m_radius.m_value);
+    // Particles all have the same size, so a single level of cells
+    // just larger than a particle is enough.
+    int level = (int)ceil(log2(m_radius.m_value*2));
+    dHashSpaceSetLevels(m_odeSpace, level, level);
 
     // reset the mass to maintain same density
-    dMassSetSphere(&ode_object->mass(), m_density.m_value, m_radius.m_value);
-
-    m_mass.m_value = ode_object->mass().mass;
+    setMass();
 }
 
-void OscSphereODE::on_mass()
+void OscParticlesODE::on_mass()
 {
-    ODEObject *ode_object = static_cast<ODEObject*>(special());
     if (m_mass.m_value < 1e-9) {
         printf("[%s] Mass for %s is too small, setting to 1e-9.\n",
-               simulation()->type_str(), c_name(), m_mass.m_value);
-        m_mass.m_value = 1e-6;
+               simulation()->type_str(), c_name());
+        m_mass.m_value = 1e-9;
     }
-    dMassSetSphereTotal(&ode_object->mass(), m_mass.m_value, m_radius.m_value);
-    dBodySetMass(ode_object->body(), &ode_object->mass());
 
+    // Mass is per particle.
     dReal volume = 4*M_PI*m_radius.m_value*m_radius.m_value*m_radius.m_value/3;
     m_density.m_value = m_mass.m_value / volume;
+    setMass();
 }
 
-void OscSphereODE::on_density()
+void OscParticlesODE::on_density()
 {
-    ODEObject *ode_object = static_cast<ODEObject*>(special());
-    dMassSetSphere(&ode_object->mass(), m_density.m_value, m_radius.m_value);
-    dBodySetMass(ode_object->body(), &ode_object->mass());
+    setMass();
+}
 
-    m_mass.m_value = ode_object->mass().mass;
+int OscParticlesODE::positions_get_handler(const char *path, const char *types,
+                                           lo_arg **argv, int argc,
+                                           void *data, void *user_data)
+{
+    OscParticlesODE *me = static_cast<OscParticlesODE*>(user_data);
+
+    // Reply with as few blobs as fit in a UDP packet.
+    const int REPLY_SIZE = 4096;
+    for (int first=0; first < me->m_count; first += REPLY_SIZE)
+    {
+        int n = std::min(REPLY_SIZE, me->m_count - first);
+        lo_blob b = lo_blob_new(n*3*sizeof(float), &me->m_positions[first*3]);
+        lo_send(address_send, me->m_positionsPath.c_str(), "ib", first, b);
+        lo_blob_free(b);
+    }
+    return 0;
 }
 
 /****** OscPrismODE ******/
@@ -529,7 +2377,7 @@ void OscPrismODE::on_size()
     // reset the mass to maintain same density
     dMassSetBox(&ode_object->mass(), m_density.m_value,
                 m_size(0), m_size(1), m_size(2));
-    dBodySetMass(ode_object->body(), &ode_object->mass());
+    ode_object->updateMass();
 
     m_mass.m_value = ode_object->mass().mass;
 }
@@ -539,7 +2387,7 @@ void OscPrismODE::on_mass()
     ODEObject *ode_object = static_cast<ODEObject*>(special());
     dMassSetBoxTotal(&ode_object->mass(), m_mass.m_value,
                      m_size.x(), m_size.y(), m_size.z());
-    dBodySetMass(ode_object->body(), &ode_object->mass());
+    ode_object->updateMass();
 
     dReal volume = m_size.x() * m_size.y() * m_size.z();
     m_density.m_value = m_mass.m_value / volume;
@@ -550,7 +2398,7 @@ void OscPrismODE::on_density()
     ODEObject *ode_object = static_cast<ODEObject*>(special());
     dMassSetBox(&ode_object->mass(), m_density.m_value,
                 m_size.x(), m_size.y(), m_size.z());
-    dBodySetMass(ode_object->body(), &ode_object->mass());
+    ode_object->updateMass();
 
     m_mass.m_value = ode_object->mass().mass;
 }
@@ -573,6 +2421,8 @@ OscHingeODE::OscHingeODE(dWorldID odeWorld, dSpaceID odeSpace,
     m_pSpecial = new ODEConstraint(this, odeJoint, odeWorld, odeSpace,
                                    object1, object2);
 
+    static_cast<PhysicsSim*>(simulation())->m_hingeResponses.add(this);
+
     dJointSetHingeAnchor(odeJoint, anchor.x(), anchor.y(), anchor.z());
     dJointSetHingeAxis(odeJoint, axis.x(), axis.y(), axis.z());
 
@@ -582,31 +2432,34 @@ OscHingeODE::OscHingeODE(dWorldID odeWorld, dSpaceID odeSpace,
 
 OscHingeODE::~OscHingeODE()
 {
+    static_cast<PhysicsSim*>(simulation())->m_hingeResponses.remove(this);
     delete m_response;
 }
 
-//! This function is called once per simulation step, allowing the
-//! constraint to be "motorized" according to some response.  It runs
-//! in the physics thread.
-void OscHingeODE::simulationCallback()
+void OscHingeODE::readResponse(dReal *position, dReal *rate)
 {
-    ODEConstraint& me = *static_cast<ODEConstraint*>(special());
-
-    dReal angle = dJointGetHingeAngle(me.joint());
-    dReal rate = dJointGetHingeAngleRate(me.joint());
+    dJointID joint = static_cast<ODEConstraint*>(special())->joint();
+    position[0] = dJointGetHingeAngle(joint);
+    rate[0] = dJointGetHingeAngleRate(joint);
+}
 
-    dReal addtorque =
-        - m_response->m_stiffness.m_value*angle
-        - m_response->m_damping.m_value*rate;
+void OscHingeODE::applyResponse(const dReal *position, const dReal *force)
+{
+    m_torque.m_value = force[0];
+    m_angle.m_value = position[0];
 
-    // Limit the torque otherwise we get ODE assertions.
-    if (addtorque >  1000) addtorque =  1000;
-    if (addtorque < -1000) addtorque = -1000;
+    dJointAddHingeTorque(static_cast<ODEConstraint*>(special())->joint(),
+                         force[0]);
+}
 
-    m_torque.m_value = addtorque;
-    m_angle.m_value = angle;
+void OscHingeODE::on_response()
+{
+    static_cast<PhysicsSim*>(simulation())->m_hingeResponses.setResponse(
+        this, 0, m_response);
 
-    dJointAddHingeTorque(me.joint(), addtorque);
+    ODEConstraint *me = static_cast<ODEConstraint*>(special());
+    if (me)
+        me->setResponseStops(m_response, dJointSetHingeParam);
 }
 
 OscHinge2ODE::OscHinge2ODE(dWorldID odeWorld, dSpaceID odeSpace,
@@ -625,6 +2478,8 @@ OscHinge2ODE::OscHinge2ODE(dWorldID odeWorld, dSpaceID odeSpace,
     m_pSpecial = new ODEConstraint(this, odeJoint, odeWorld, odeSpace,
                                    object1, object2);
 
+    static_cast<PhysicsSim*>(simulation())->m_hinge2Responses.add(this);
+
     dJointSetHinge2Anchor(odeJoint, x, y, z);
     dJointSetHinge2Axis1(odeJoint, a1x, a1y, a1z);
     dJointSetHinge2Axis2(odeJoint, a2x, a2y, a2z);
@@ -637,40 +2492,48 @@ OscHinge2ODE::OscHinge2ODE(dWorldID odeWorld, dSpaceID odeSpace,
 
 OscHinge2ODE::~OscHinge2ODE()
 {
+    static_cast<PhysicsSim*>(simulation())->m_hinge2Responses.remove(this);
     delete m_response;
 }
 
-//! This function is called once per simulation step, allowing the
-//! constraint to be "motorized" according to some response.
-void OscHinge2ODE::simulationCallback()
+void OscHinge2ODE::readResponse(dReal *position, dReal *rate)
 {
-    ODEConstraint& me = *static_cast<ODEConstraint*>(special());
-
-    dReal angle1 = dJointGetHinge2Angle1(me.joint());
-    dReal rate1 = dJointGetHinge2Angle1Rate(me.joint());
-
-    dReal addtorque1 =
-        - m_response->m_stiffness.m_value*angle1
-        - m_response->m_damping.m_value*rate1;
+    dJointID joint = static_cast<ODEConstraint*>(special())->joint();
+    position[0] = dJointGetHinge2Angle1(joint);
+    rate[0] = dJointGetHinge2Angle1Rate(joint);
 
 #if 0  // TODO: dJointGetHinge2Angle2 is not yet available in ODE.
-    dReal angle2 = dJointGetHinge2Angle2(me.joint());
+    position[1] = dJointGetHinge2Angle2(joint);
 #else
-    dReal angle2 = 0;
+    position[1] = 0;
 #endif
-    dReal rate2 = dJointGetHinge2Angle2Rate(me.joint());
+    rate[1] = dJointGetHinge2Angle2Rate(joint);
+}
 
-    dReal addtorque2 =
-        - m_response->m_stiffness.m_value*angle2
-        - m_response->m_damping.m_value*rate2;
+void OscHinge2ODE::applyResponse(const dReal *position, const dReal *force)
+{
+    m_torque1.m_value = force[0];
+    m_torque2.m_value = force[1];
 
-    m_torque1.m_value = addtorque1;
-    m_torque2.m_value = addtorque2;
+    m_angle1.m_value = position[0];
+    m_angle2.m_value = position[1];
 
-    m_angle1.m_value = angle1;
-    m_angle2.m_value = angle2;
+    dJointAddHinge2Torques(static_cast<ODEConstraint*>(special())->joint(),
+                           force[0], force[1]);
+}
 
-    dJointAddHinge2Torques(me.joint(), addtorque1, addtorque2);
+void OscHinge2ODE::on_response()
+{
+    // ODE does not support stops on the second axis, so its response
+    // is always explicit.
+    ResponseBatch<OscHinge2ODE> &batch =
+        static_cast<PhysicsSim*>(simulation())->m_hinge2Responses;
+    batch.setResponse(this, 0, m_response);
+    batch.setResponse(this, 1, m_response, false);
+
+    ODEConstraint *me = static_cast<ODEConstraint*>(special());
+    if (me)
+        me->setResponseStops(m_response, dJointSetHinge2Param);
 }
 
 OscFixedODE::OscFixedODE(dWorldID odeWorld, dSpaceID odeSpace,
@@ -723,6 +2586,8 @@ OscFreeODE::OscFreeODE(dWorldID odeWorld, dSpaceID odeSpace,
     m_pSpecial = new ODEConstraint(this, NULL, odeWorld, odeSpace,
                                    object1, object2);
 
+    static_cast<PhysicsSim*>(simulation())->m_freeResponses.add(this);
+
     ODEConstraint& cons = *static_cast<ODEConstraint*>(special());
     const dReal *pos1 = dBodyGetPosition(cons.body1());
     const dReal *pos2 = dBodyGetPosition(cons.body2());
@@ -736,7 +2601,7 @@ OscFreeODE::OscFreeODE(dWorldID odeWorld, dSpaceID odeSpace,
            object1->c_name(), object2->c_name());
 }
 
-void OscFreeODE::simulationCallback()
+void OscFreeODE::readResponse(dReal *position, dReal *rate)
 {
     ODEConstraint& me = *static_cast<ODEConstraint*>(special());
 
@@ -746,29 +2611,32 @@ void OscFreeODE::simulationCallback()
     const dReal *vel1 = dBodyGetLinearVel(me.body1());
     const dReal *vel2 = dBodyGetLinearVel(me.body2());
 
-    dReal force[3];
-
-    force[0] =
-        - ((pos2[0]-pos1[0]-m_initial_distance[0])
-           * m_response->m_stiffness.m_value)
-        - (vel2[0]-vel1[0]) * m_response->m_damping.m_value;
-
-    force[1] =
-        - ((pos2[1]-pos1[1]-m_initial_distance[1])
-           * m_response->m_stiffness.m_value)
-        - (vel2[1]-vel1[1]) * m_response->m_damping.m_value;
+    for (int i=0; i<3; i++) {
+        position[i] = pos2[i] - pos1[i] - m_initial_distance[i];
+        rate[i] = vel2[i] - vel1[i];
+    }
+}
 
-    force[2] =
-        - ((pos2[2]-pos1[2]-m_initial_distance[2])
-           * m_response->m_stiffness.m_value)
-        - (vel2[2]-vel1[2]) * m_response->m_damping.m_value;
+void OscFreeODE::applyResponse(const dReal *position, const dReal *force)
+{
+    ODEConstraint& me = *static_cast<ODEConstraint*>(special());
 
     dBodyAddForce(me.body1(), -force[0], -force[1], -force[2]);
     dBodyAddForce(me.body2(),  force[0],  force[1],  force[2]);
 }
 
+void OscFreeODE::on_response()
+{
+    // There is no ODE joint to solve the response implicitly.
+    ResponseBatch<OscFreeODE> &batch =
+        static_cast<PhysicsSim*>(simulation())->m_freeResponses;
+    for (int i=0; i<3; i++)
+        batch.setResponse(this, i, m_response, false);
+}
+
 OscFreeODE::~OscFreeODE()
 {
+    static_cast<PhysicsSim*>(simulation())->m_freeResponses.remove(this);
     delete m_response;
 }
 
@@ -816,6 +2684,8 @@ OscSlideODE::OscSlideODE(dWorldID odeWorld, dSpaceID odeSpace,
     m_pSpecial = new ODEConstraint(this, odeJoint, odeWorld, odeSpace,
                                    object1, object2);
 
+    static_cast<PhysicsSim*>(simulation())->m_slideResponses.add(this);
+
     dJointSetSliderAxis(odeJoint, ax, ay, az);
     /* TODO access to dJointGetSliderPosition */
 
@@ -827,24 +2697,34 @@ OscSlideODE::OscSlideODE(dWorldID odeWorld, dSpaceID odeSpace,
 
 OscSlideODE::~OscSlideODE()
 {
+    static_cast<PhysicsSim*>(simulation())->m_slideResponses.remove(this);
     delete m_response;
 }
 
-void OscSlideODE::simulationCallback()
+void OscSlideODE::readResponse(dReal *position, dReal *rate)
 {
-    ODEConstraint& me = *static_cast<ODEConstraint*>(special());
+    dJointID joint = static_cast<ODEConstraint*>(special())->joint();
+    position[0] = dJointGetSliderPosition(joint);
+    rate[0] = dJointGetSliderPositionRate(joint);
+}
 
-    dReal pos = dJointGetSliderPosition(me.joint());
-    dReal rate = dJointGetSliderPositionRate(me.joint());
+void OscSlideODE::applyResponse(const dReal *position, const dReal *force)
+{
+    m_force.m_value = force[0];
+    m_position.m_value = position[0];
 
-    dReal addforce =
-        - m_response->m_stiffness.m_value*pos
-        - m_response->m_damping.m_value*rate;
+    dJointAddSliderForce(static_cast<ODEConstraint*>(special())->joint(),
+                         force[0]);
+}
 
-    m_force.m_value = addforce;
-    m_position.m_value = pos;
+void OscSlideODE::on_response()
+{
+    static_cast<PhysicsSim*>(simulation())->m_slideResponses.setResponse(
+        this, 0, m_response);
 
-    dJointAddSliderForce(me.joint(), addforce);
+    ODEConstraint *me = static_cast<ODEConstraint*>(special());
+    if (me)
+        me->setResponseStops(m_response, dJointSetSliderParam);
 }
 
 //! A piston requires a fixed anchor point and an axis
@@ -866,6 +2746,8 @@ OscPistonODE::OscPistonODE(dWorldID odeWorld, dSpaceID odeSpace,
     m_pSpecial = new ODEConstraint(this, odeJoint, odeWorld, odeSpace,
                                    object1, object2);
 
+    static_cast<PhysicsSim*>(simulation())->m_pistonResponses.add(this);
+
     dJointSetPistonAnchor(odeJoint, anchor.x(), anchor.y(), anchor.z());
     dJointSetPistonAxis(odeJoint, axis.x(), axis.y(), axis.z());
 
@@ -875,24 +2757,34 @@ OscPistonODE::OscPistonODE(dWorldID odeWorld, dSpaceID odeSpace,
 
 OscPistonODE::~OscPistonODE()
 {
+    static_cast<PhysicsSim*>(simulation())->m_pistonResponses.remove(this);
     delete m_response;
 }
 
-void OscPistonODE::simulationCallback()
+void OscPistonODE::readResponse(dReal *position, dReal *rate)
 {
-    ODEConstraint& me = *static_cast<ODEConstraint*>(special());
+    dJointID joint = static_cast<ODEConstraint*>(special())->joint();
+    position[0] = dJointGetPistonPosition(joint);
+    rate[0] = dJointGetPistonPositionRate(joint);
+}
 
-    dReal pos = dJointGetPistonPosition(me.joint());
-    dReal rate = dJointGetPistonPositionRate(me.joint());
+void OscPistonODE::applyResponse(const dReal *position, const dReal *force)
+{
+    m_force.m_value = force[0];
+    m_position.m_value = position[0];
 
-    dReal addforce =
-        - m_response->m_stiffness.m_value*pos
-        - m_response->m_damping.m_value*rate;
+    dJointAddPistonForce(static_cast<ODEConstraint*>(special())->joint(),
+                         force[0]);
+}
 
-    m_force.m_value = addforce;
-    m_position.m_value = pos;
+void OscPistonODE::on_response()
+{
+    static_cast<PhysicsSim*>(simulation())->m_pistonResponses.setResponse(
+        this, 0, m_response);
 
-    dJointAddPistonForce(me.joint(), addforce);
+    ODEConstraint *me = static_cast<ODEConstraint*>(special());
+    if (me)
+        me->setResponseStops(m_response, dJointSetPistonParam);
 }
 
 OscUniversalODE::OscUniversalODE(dWorldID odeWorld, dSpaceID odeSpace,
@@ -911,6 +2803,8 @@ OscUniversalODE::OscUniversalODE(dWorldID odeWorld, dSpaceID odeSpace,
     m_pSpecial = new ODEConstraint(this, odeJoint, odeWorld, odeSpace,
                                    object1, object2);
 
+    static_cast<PhysicsSim*>(simulation())->m_universalResponses.add(this);
+
     dJointSetUniversalAnchor(odeJoint, x, y, z);
     dJointSetUniversalAxis1(odeJoint, a1x, a1y, a1z);
     dJointSetUniversalAxis2(odeJoint, a2x, a2y, a2z);
@@ -923,33 +2817,41 @@ OscUniversalODE::OscUniversalODE(dWorldID odeWorld, dSpaceID odeSpace,
 
 OscUniversalODE::~OscUniversalODE()
 {
+    static_cast<PhysicsSim*>(simulation())->m_universalResponses.remove(this);
     delete m_response;
 }
 
-//! This function is called once per simulation step, allowing the
-//! constraint to be "motorized" according to some response.
-void OscUniversalODE::simulationCallback()
+void OscUniversalODE::readResponse(dReal *position, dReal *rate)
 {
-    ODEConstraint& me = *static_cast<ODEConstraint*>(special());
-
-    dReal angle1 = dJointGetUniversalAngle1(me.joint());
-    dReal rate1 = dJointGetUniversalAngle1Rate(me.joint());
-
-    dReal addtorque1 =
-        - m_response->m_stiffness.m_value*angle1
-        - m_response->m_damping.m_value*rate1;
-
-    dReal angle2 = dJointGetUniversalAngle2(me.joint());
-    dReal rate2 = dJointGetUniversalAngle2Rate(me.joint());
+    dJointID joint = static_cast<ODEConstraint*>(special())->joint();
+    position[0] = dJointGetUniversalAngle1(joint);
+    rate[0] = dJointGetUniversalAngle1Rate(joint);
+    position[1] = dJointGetUniversalAngle2(joint);
+    rate[1] = dJointGetUniversalAngle2Rate(joint);
+}
 
-    dReal addtorque2 =
-        - m_response->m_stiffness.m_value*angle2
-        - m_response->m_damping.m_value*rate2;
+void OscUniversalODE::applyResponse(const dReal *position, const dReal *force)
+{
+    m_torque1.m_value = force[0];
+    m_torque2.m_value = force[1];
+    m_angle1.m_value = position[0];
+    m_angle2.m_value = position[1];
 
-    m_torque1.m_value = addtorque1;
-    m_torque2.m_value = addtorque2;
-    m_angle1.m_value = angle1;
-    m_angle2.m_value = angle2;
+    dJointAddUniversalTorques(static_cast<ODEConstraint*>(special())->joint(),
+                              force[0], force[1]);
+}
 
-    dJointAddUniversalTorques(me.joint(), addtorque1, addtorque2);
+void OscUniversalODE::on_response()
+{
+    ResponseBatch<OscUniversalODE> &batch =
+        static_cast<PhysicsSim*>(simulation())->m_universalResponses;
+    batch.setResponse(this, 0, m_response);
+    batch.setResponse(this, 1, m_response);
+
+    ODEConstraint *me = static_cast<ODEConstraint*>(special());
+    if (me) {
+        me->setResponseStops(m_response, dJointSetUniversalParam);
+        me->setResponseStops(m_response, dJointSetUniversalParam,
+                             dParamGroup2);
+    }
 }
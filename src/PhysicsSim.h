@@ -5,9 +5,151 @@
 
 #include "Simulation.h"
 #include "OscObject.h"
+#include "WorkerPool.h"
+#include "ObjectPool.h"
+#include "BarnesHut.h"
 #include <ode/ode.h>
 
 class ODEObject;
+class OscHingeODE;
+class OscHinge2ODE;
+class OscSlideODE;
+class OscPistonODE;
+class OscUniversalODE;
+class OscFreeODE;
+class OscParticlesODE;
+class OscCompositeODE;
+class OscFieldODE;
+
+//! Contacts found by the narrowphase for one range of candidate
+//! pairs, written by a single task so that results can be merged in
+//! pair order regardless of which thread computed them.
+struct NarrowphaseBuffer
+{
+    struct PairContacts
+    {
+        dGeomID o1, o2;
+        int first;
+        int count;
+    };
+
+    std::vector<dContact> contacts;
+    std::vector<PairContacts> pairs;
+};
+
+/*! Spring-damper responses of all constraints of one type, stored
+ *  contiguously with a fixed number of axes per constraint so that
+ *  they can be evaluated together on each step.  T must provide
+ *  readResponse() and applyResponse() for its axes, and an
+ *  m_responseIndex member giving its place in the batch. */
+template <class T>
+class ResponseBatch
+{
+  public:
+    ResponseBatch(int axes, dReal limit=0)
+        : m_axes(axes), m_limit(limit) {}
+
+    void add(T *c)
+    {
+        c->m_responseIndex = m_constraints.size();
+        m_constraints.push_back(c);
+        resize();
+    }
+
+    void remove(T *c)
+    {
+        // Move the last constraint into the removed one's place to
+        // keep the arrays dense.
+        int i = c->m_responseIndex;
+        int last = m_constraints.size()-1;
+        if (i < 0 || i > last)
+            return;
+
+        if (i != last) {
+            m_constraints[i] = m_constraints[last];
+            m_constraints[i]->m_responseIndex = i;
+            for (int a=0; a<m_axes; a++) {
+                m_stiffness[i*m_axes+a] = m_stiffness[last*m_axes+a];
+                m_damping[i*m_axes+a] = m_damping[last*m_axes+a];
+            }
+        }
+
+        m_constraints.pop_back();
+        resize();
+        c->m_responseIndex = -1;
+    }
+
+    /*! Copy the coefficients of a response to one axis of a
+     *  constraint.  If the response is implicit and the axis can be
+     *  solved implicitly, the coefficients are zero since the joint
+     *  stops apply the spring instead. */
+    void setResponse(T *c, int axis, OscResponse *response,
+                     bool implicitAxis=true)
+    {
+        int j = c->m_responseIndex*m_axes + axis;
+        if (implicitAxis && response->m_implicit.m_value) {
+            m_stiffness[j] = 0;
+            m_damping[j] = 0;
+        } else {
+            m_stiffness[j] = response->m_stiffness.m_value;
+            m_damping[j] = response->m_damping.m_value;
+        }
+    }
+
+    //! Read back joint state, compute and apply all responses.
+    void evaluate()
+    {
+        int n = m_constraints.size();
+        if (n == 0)
+            return;
+
+        for (int i=0; i<n; i++)
+            m_constraints[i]->readResponse(&m_position[i*m_axes],
+                                           &m_rate[i*m_axes]);
+
+        // Damped spring for every axis, in plain loops over
+        // contiguous arrays so that they can be vectorized.
+        int count = n*m_axes;
+        const dReal *k = &m_stiffness[0];
+        const dReal *d = &m_damping[0];
+        const dReal *p = &m_position[0];
+        const dReal *r = &m_rate[0];
+        dReal *f = &m_force[0];
+        for (int j=0; j<count; j++)
+            f[j] = -k[j]*p[j] - d[j]*r[j];
+
+        // Limit the response otherwise we get ODE assertions.
+        if (m_limit > 0)
+            for (int j=0; j<count; j++)
+                f[j] = f[j] > m_limit ? m_limit
+                     : (f[j] < -m_limit ? -m_limit : f[j]);
+
+        for (int i=0; i<n; i++)
+            m_constraints[i]->applyResponse(&m_position[i*m_axes],
+                                            &m_force[i*m_axes]);
+    }
+
+  protected:
+    int m_axes;
+    dReal m_limit;
+
+    std::vector<T*> m_constraints;
+    std::vector<dReal> m_stiffness;
+    std::vector<dReal> m_damping;
+    std::vector<dReal> m_position;
+    std::vector<dReal> m_rate;
+    std::vector<dReal> m_force;
+
+    void resize()
+    {
+        int count = m_constraints.size()*m_axes;
+        m_stiffness.resize(count, 0);
+        m_damping.resize(count, 0);
+        m_position.resize(count, 0);
+        m_rate.resize(count, 0);
+        m_force.resize(count, 0);
+    }
+};
 
 class PhysicsSim : public Simulation
 {
@@ -25,9 +167,50 @@ class PhysicsSim : public Simulation
         { dWorldSetGravity(m_odeWorld, m_gravity.x(),
                            m_gravity.y(), m_gravity.z()); }
 
+    virtual void on_physics_threads();
+    virtual void on_physics_substeps();
+
+    //! Return the duration of a single ODE step, taking sub-steps
+    //! into account.
+    dReal stepSize()
+        { return m_physics_substeps.m_value > 1
+              ? m_fTimestep / (int)m_physics_substeps.m_value
+              : m_fTimestep; }
+
     //! Set the grabbed object or ungrab by setting to NULL.
     virtual void set_grabbed(OscObject *pGrabbed);
 
+    //! Add an object's body to the arrays updated on each step.
+    void addBody(ODEObject *o);
+    //! Remove an object's body from the arrays updated on each step.
+    void removeBody(ODEObject *o);
+
+    //! Return the velocity of a body as of the end of the last step,
+    //! or the step before it.
+    const dReal *bodyVelocity(int index)
+        { return &m_bodyVelocity[index*3]; }
+    const dReal *bodyPrevVelocity(int index)
+        { return &m_bodyPrevVelocity[index*3]; }
+
+    //! Add a particle system to those collided and published on
+    //! each step.
+    void addParticles(OscParticlesODE *p);
+    //! Remove a particle system from those updated on each step.
+    void removeParticles(OscParticlesODE *p);
+
+    //! Add a force field to those applied on each step.
+    void addField(OscFieldODE *f);
+    //! Remove a force field from those applied on each step.
+    void removeField(OscFieldODE *f);
+
+    //! Constraint responses, grouped by constraint type.
+    ResponseBatch<OscHingeODE> m_hingeResponses;
+    ResponseBatch<OscHinge2ODE> m_hinge2Responses;
+    ResponseBatch<OscSlideODE> m_slideResponses;
+    ResponseBatch<OscPistonODE> m_pistonResponses;
+    ResponseBatch<OscUniversalODE> m_universalResponses;
+    ResponseBatch<OscFreeODE> m_freeResponses;
+
   protected:
     dWorldID m_odeWorld;
     dSpaceID m_odeSpace;
@@ -39,12 +222,117 @@ class PhysicsSim : public Simulation
     bool m_bGetCollide;
     int m_counter;
 
+    //! Threading implementation and pool used for stepping islands
+    //! in parallel, or NULL when stepping in the physics thread only.
+    dThreadingImplementationID m_odeThreading;
+    dThreadingThreadPoolID m_odeThreadPool;
+
+    //! Workers for the collision narrowphase, or NULL when it runs
+    //! in the physics thread only.
+    WorkerPool *m_pNarrowphasePool;
+
+    //! Candidate pairs from the broadphase, and one contact buffer
+    //! per narrowphase task.
+    std::vector<std::pair<dGeomID, dGeomID> > m_collidePairs;
+    std::vector<NarrowphaseBuffer> m_narrowphaseBuffers;
+
+    //! Candidate pairs involving a trimesh or heightfield, which
+    //! are tested serially after the other pairs, and their contacts.
+    std::vector<std::pair<dGeomID, dGeomID> > m_serialPairs;
+    NarrowphaseBuffer m_serialBuffer;
+
+    /*! Dense array of bodies, and their state as of the end of the
+     *  last step in structure-of-arrays form, indexed by
+     *  ODEObject::index().  Positions and velocities have 3 elements
+     *  per body and rotations 9 (row-major).  OscObject values are
+     *  only brought up to date from these when they are queried. */
+    std::vector<ODEObject*> m_bodies;
+    std::vector<dReal> m_bodyPosition;
+    std::vector<dReal> m_bodyVelocity;
+    std::vector<dReal> m_bodyPrevVelocity;
+    std::vector<dReal> m_bodyRotation;
+
+    //! Paths for publishing each body's position and rotation.
+    std::vector<std::string> m_bodyPositionPath;
+    std::vector<std::string> m_bodyRotationPath;
+
+    //! Particle systems, each with its own collision space.
+    std::vector<OscParticlesODE*> m_particles;
+
+    /*! Force fields, and the bodies they act on with their positions,
+     *  velocities and the sum of all field forces, 3 elements per
+     *  body. */
+    std::vector<OscFieldODE*> m_fields;
+    std::vector<dBodyID> m_fieldBodies;
+    std::vector<dReal> m_fieldPosition;
+    std::vector<dReal> m_fieldVelocity;
+    std::vector<dReal> m_fieldForce;
+
+    /*! Octree for the mutual attraction of bodies, and the bodies it
+     *  acts on with their positions, charges and resulting forces. */
+    BarnesHut m_attractionTree;
+    std::vector<dBodyID> m_attractionBodies;
+    std::vector<double> m_attractionPosition;
+    std::vector<double> m_attractionCharge;
+    std::vector<double> m_attractionForce;
+
+    //! Forces and torques added to bodies between steps, re-applied
+    //! on each sub-step.
+    struct SavedForce
+    {
+        dBodyID body;
+        dReal force[3];
+        dReal torque[3];
+    };
+    std::vector<SavedForce> m_savedForces;
+
+    //! Accumulated step time for reporting the average step duration.
+    double m_fStepTimeTotal;
+    int m_nStepTimeCount;
+
     virtual void initialize();
     virtual void step();
 
+    //! Attach a pool of the given number of threads to the ODE world.
+    void setThreads(int threads);
+    //! Detach and free the ODE threading implementation, if any.
+    void freeThreads();
+
+    //! Record forces added to bodies since the last step.
+    void saveForces();
+    //! Record the force and torque on one body, if any.
+    void saveForce(dBodyID body);
+    //! Add the recorded forces to bodies again.
+    void restoreForces();
+
+    //! Add the force of all fields to every free, enabled body.
+    void applyFields();
+    //! Add a body to those that fields are evaluated for.
+    void addFieldBody(dBodyID body);
+
+    //! Add the mutual attraction of all bodies with a positive charge
+    //! to those that are enabled.
+    void applyAttraction();
+    //! Add a body to those attracting each other.
+    void addAttractionBody(dBodyID body, double charge);
+
+    //! Find contacts for the candidate pairs, then create contact
+    //! joints and report collisions in pair order.
+    void collide();
+
     static void ode_errorhandler(int errnum, const char *msg, va_list ap)
         { printf("ODE error %d: %s\n", errnum, msg); }
     static void ode_nearCallback (void *data, dGeomID o1, dGeomID o2);
+    static void narrowphase_task(void *data, int task);
+    static void narrowphase_pair(NarrowphaseBuffer &buf,
+                                 dGeomID o1, dGeomID o2);
+    static bool serialCollider(dGeomID g)
+        { int c = dGeomGetClass(g);
+          return c == dTriMeshClass || c == dHeightfieldClass; }
+    static void ode_threadStart()
+        { dAllocateODEDataForThread(dAllocateMaskAll); }
+    static void ode_threadFinish()
+        { dCleanupODEAllDataForThread(); }
 };
 
 class PhysicsPrismFactory : public PrismFactory
@@ -71,6 +359,104 @@ protected:
     bool create(const char *name, float x, float y, float z);
 };
 
+class PhysicsMeshFactory : public MeshFactory
+{
+public:
+    PhysicsMeshFactory(Simulation *parent) : MeshFactory(parent) {}
+    virtual ~PhysicsMeshFactory() {}
+
+    virtual PhysicsSim* simulation() { return static_cast<PhysicsSim*>(m_parent); }
+
+protected:
+    bool create(const char *name, const char *filename,
+                float x, float y, float z);
+};
+
+class PhysicsParticlesFactory : public ParticlesFactory
+{
+public:
+    PhysicsParticlesFactory(Simulation *parent) : ParticlesFactory(parent) {}
+    virtual ~PhysicsParticlesFactory() {}
+
+    virtual PhysicsSim* simulation() { return static_cast<PhysicsSim*>(m_parent); }
+
+protected:
+    bool create(const char *name, int count, float x, float y, float z);
+};
+
+class PhysicsPlaneFactory : public PlaneFactory
+{
+public:
+    PhysicsPlaneFactory(Simulation *parent) : PlaneFactory(parent) {}
+    virtual ~PhysicsPlaneFactory() {}
+
+    virtual PhysicsSim* simulation() { return static_cast<PhysicsSim*>(m_parent); }
+
+protected:
+    bool create(const char *name, float x, float y, float z);
+};
+
+class PhysicsCapsuleFactory : public CapsuleFactory
+{
+public:
+    PhysicsCapsuleFactory(Simulation *parent) : CapsuleFactory(parent) {}
+    virtual ~PhysicsCapsuleFactory() {}
+
+    virtual PhysicsSim* simulation() { return static_cast<PhysicsSim*>(m_parent); }
+
+protected:
+    bool create(const char *name, float x, float y, float z);
+};
+
+class PhysicsCylinderFactory : public CylinderFactory
+{
+public:
+    PhysicsCylinderFactory(Simulation *parent) : CylinderFactory(parent) {}
+    virtual ~PhysicsCylinderFactory() {}
+
+    virtual PhysicsSim* simulation() { return static_cast<PhysicsSim*>(m_parent); }
+
+protected:
+    bool create(const char *name, float x, float y, float z);
+};
+
+class PhysicsHeightfieldFactory : public HeightfieldFactory
+{
+public:
+    PhysicsHeightfieldFactory(Simulation *parent) : HeightfieldFactory(parent) {}
+    virtual ~PhysicsHeightfieldFactory() {}
+
+    virtual PhysicsSim* simulation() { return static_cast<PhysicsSim*>(m_parent); }
+
+protected:
+    bool create(const char *name, int columns, int rows,
+                float x, float y, float z);
+};
+
+class PhysicsCompositeFactory : public CompositeFactory
+{
+public:
+    PhysicsCompositeFactory(Simulation *parent) : CompositeFactory(parent) {}
+    virtual ~PhysicsCompositeFactory() {}
+
+    virtual PhysicsSim* simulation() { return static_cast<PhysicsSim*>(m_parent); }
+
+protected:
+    bool create(const char *name, float x, float y, float z);
+};
+
+class PhysicsFieldFactory : public FieldFactory
+{
+public:
+    PhysicsFieldFactory(Simulation *parent) : FieldFactory(parent) {}
+    virtual ~PhysicsFieldFactory() {}
+
+    virtual PhysicsSim* simulation() { return static_cast<PhysicsSim*>(m_parent); }
+
+protected:
+    bool create(const char *name, const char *type, float x, float y, float z);
+};
+
 class PhysicsHingeFactory : public HingeFactory
 {
 public:
@@ -175,22 +561,63 @@ protected:
                 double a1z, double a2x, double a2y, double a2z);
 };
 
-class ODEObject : public OscObjectSpecial
+/*! Queries answered from the broadphase of the world's collision
+ *  space, so that only geoms near the queried region are tested. */
+class PhysicsSpatialQuery : public SpatialQuery
 {
 public:
-    ODEObject(OscObject *obj, dGeomID odeGeom, dWorldID odeWorld, dSpaceID odeSpace);
+    PhysicsSpatialQuery(Simulation *parent) : SpatialQuery(parent) {}
+    virtual ~PhysicsSpatialQuery() {}
+
+    virtual PhysicsSim* simulation() { return static_cast<PhysicsSim*>(m_parent); }
+
+protected:
+    void raycast(float x, float y, float z,
+                 float dx, float dy, float dz, float length);
+    void sphere(float x, float y, float z, float radius);
+    void nearest(float x, float y, float z, int count);
+
+    /*! Find the geoms of objects in the world whose bounding boxes
+     *  overlap that of the query geom. */
+    void candidates(dGeomID query);
+    static void candidate_callback(void *data, dGeomID o1, dGeomID o2);
+
+    //! Return the object of a geom, if it has not been destroyed.
+    OscObject *object(dGeomID geom);
+
+    dGeomID m_query;
+    std::vector<dGeomID> m_candidates;
+};
+
+class ODEObject : public OscObjectSpecial, public Pooled<ODEObject>
+{
+public:
+    /*! A static object has a geom but no body, and so is not moved
+     *  by the simulation.  A composite has a body but no geom. */
+    ODEObject(OscObject *obj, dGeomID odeGeom, dWorldID odeWorld, dSpaceID odeSpace,
+              bool bStatic=false);
     virtual ~ODEObject();
 
+    // Parts of a composite report the pose of their own geom.
     cVector3d getPosition() {
-      const dReal *p = dBodyGetPosition(m_odeBody);
+      const dReal *p = attached() ? dGeomGetPosition(m_odeGeom)
+                                  : dBodyGetPosition(m_odeBody);
       return cVector3d(p[0], p[1], p[2]);
     }
     cVector3d getVelocity() { 
-      const dReal *v = dBodyGetLinearVel(m_odeBody);
+      dVector3 v;
+      if (attached()) {
+          const dReal *p = dGeomGetPosition(m_odeGeom);
+          dBodyGetPointVel(m_odeBody, p[0], p[1], p[2], v);
+      }
+      else
+          dCopyVector3(v, dBodyGetLinearVel(m_odeBody));
       return cVector3d(v[0], v[1], v[2]);
     }
     cMatrix3d getRotation() {
-      const dReal *r = dBodyGetRotation(m_odeBody); cMatrix3d m;
+      const dReal *r = attached() ? dGeomGetRotation(m_odeGeom)
+                                  : dBodyGetRotation(m_odeBody);
+      cMatrix3d m;
       m.set(r[0], r[1], r[2], r[4], r[5], r[6], r[8], r[9], r[10]);
       return m; }
 
@@ -199,11 +626,27 @@ public:
     
     //! Remove the association between the body and geom.
     void disconnectBody()
-        { dGeomSetBody(m_odeGeom, 0); dBodyDisable(m_odeBody); }
+        { if (!m_odeBody) return;
+          if (m_odeGeom) dGeomSetBody(m_odeGeom, 0);
+          dBodyDisable(m_odeBody); }
     
     //! Create the association between the body and geom.
     void connectBody()
-        { dGeomSetBody(m_odeGeom, m_odeBody); dBodyEnable(m_odeBody); }
+        { if (!m_odeBody) return;
+          if (m_odeGeom) dGeomSetBody(m_odeGeom, m_odeBody);
+          dBodyEnable(m_odeBody); }
+
+    /*! Apply a change to this object's mass, which for a part of a
+     *  composite changes the mass of the composite. */
+    void updateMass();
+
+    //! Return true if this object is a part of a composite.
+    bool attached() { return m_pComposite != NULL; }
+    OscCompositeODE *composite() { return m_pComposite; }
+
+    /*! Replace the geom, destroying the previous one.  The new geom
+     *  is attached to the same body and space. */
+    void setGeom(dGeomID odeGeom);
 
     dBodyID  body()  { return m_odeBody;  } //! Return the dBodyID
     dGeomID  geom()  { return m_odeGeom;  } //! Return the dGeomID
@@ -213,6 +656,10 @@ public:
 
     OscObject *object() { return m_object; }
 
+    //! Return the index of this object's body in the physics
+    //! simulation's body arrays, or -1 if it has none.
+    int index() { return m_index; }
+
 protected:
     dBodyID  m_odeBody;
     dGeomID  m_odeGeom;
@@ -222,6 +669,16 @@ protected:
 
     OscObject *m_object;
 
+    PhysicsSim *m_pSim;
+    int m_index;
+
+    /*! While this object is a part of a composite, m_odeBody is the
+     *  composite's body and the object's own body is kept, disabled,
+     *  in m_odeOwnBody. */
+    OscCompositeODE *m_pComposite;
+    dBodyID m_odeOwnBody;
+
+    static void on_refresh(void* me, OscValue &v);
     static void on_set_force(void* me, OscVector3 &f);
     static void on_set_position(void* me, OscVector3 &p);
     static void on_set_rotation(void* me, OscMatrix3 &r);
@@ -232,6 +689,8 @@ protected:
                             int argc, void *data, void *user_data);
 
     friend class ODEConstraint;
+    friend class PhysicsSim;
+    friend class OscCompositeODE;
 };
 
 class ODEConstraint : public OscConstraintSpecial
@@ -242,11 +701,24 @@ public:
                   OscObject *object1, OscObject *object2);
     virtual ~ODEConstraint();
 
+    /*! Detach the joint from its bodies, so that any torque or force
+     *  still applied through it has no effect. */
+    virtual void disable();
+
     dJointID joint() { return m_odeJoint; }
     OscConstraint *constraint() { return m_constraint; }
     dBodyID body1() { return m_odeBody1; }
     dBodyID body2() { return m_odeBody2; }
 
+    typedef void JointParamFunction(dJointID, int, dReal);
+
+    /*! Configure the stops of one joint axis to act as a damped
+     *  spring for the given response if it is implicit, or remove
+     *  them otherwise.  The group selects the axis, e.g. 0 or
+     *  dParamGroup2. */
+    void setResponseStops(OscResponse *response,
+                          JointParamFunction *setParam, int group=0);
+
 protected:
     OscConstraint *m_constraint;
     dWorldID m_odeWorld;
@@ -256,7 +728,7 @@ protected:
     dBodyID  m_odeBody2;
 };
 
-class OscSphereODE : public OscSphere
+class OscSphereODE : public OscSphere, public Pooled<OscSphereODE>
 {
 public:
 	OscSphereODE(dWorldID odeWorld, dSpaceID odeSpace, const char *name, OscBase *parent=NULL);
@@ -271,7 +743,7 @@ protected:
         { static_cast<PhysicsSim*>(simulation())->set_grabbed(this); }
 };
 
-class OscPrismODE : public OscPrism
+class OscPrismODE : public OscPrism, public Pooled<OscPrismODE>
 {
 public:
 	OscPrismODE(dWorldID odeWorld, dSpaceID odeSpace, const char *name, OscBase *parent=NULL);
@@ -286,6 +758,231 @@ protected:
         { static_cast<PhysicsSim*>(simulation())->set_grabbed(this); }
 };
 
+/*! A mesh loaded from a file, colliding either as a triangle mesh or
+ *  as its convex hull.  The hull is much cheaper for dynamic objects
+ *  and is used by default. */
+class OscMeshODE : public OscMesh
+{
+public:
+	OscMeshODE(dWorldID odeWorld, dSpaceID odeSpace, const char *name,
+               const char *filename, OscBase *parent=NULL);
+    virtual ~OscMeshODE();
+
+    //! Return true if the file was loaded.
+    bool loaded() { return !m_points.empty(); }
+
+protected:
+    virtual void on_size();
+    virtual void on_convex();
+    virtual void on_mass();
+    virtual void on_density();
+
+    virtual void on_grab()
+        { static_cast<PhysicsSim*>(simulation())->set_grabbed(this); }
+
+    //! Read the vertices and triangles of all meshes in a file.
+    bool load(const char *filename);
+
+    //! Create a new geom from the loaded data at the current size.
+    dGeomID createGeom(dSpaceID odeSpace);
+
+    std::vector<float> m_points;        //! vertices as loaded
+    std::vector<dTriIndex> m_indices;   //! triangles as loaded
+    cVector3d m_extent;                 //! bounding box size of m_points
+
+    //! Indexes into m_points of the hull vertices, or empty if none.
+    std::vector<int> m_hullVertices;
+    //! Hull triangles, indexing m_hullVertices.
+    std::vector<int> m_hullTriangles;
+
+    // Scaled data referenced by the geom, which ODE does not copy.
+    std::vector<float> m_scaled;
+    std::vector<dReal> m_hullPoints;
+    std::vector<dReal> m_hullPlanes;
+    std::vector<unsigned int> m_hullPolygons;
+    dTriMeshDataID m_odeData;
+};
+
+//! A static ODE plane.
+class OscPlaneODE : public OscPlane
+{
+public:
+	OscPlaneODE(dWorldID odeWorld, dSpaceID odeSpace, const char *name, OscBase *parent=NULL);
+    virtual ~OscPlaneODE() {}
+
+protected:
+    virtual void on_position() { setParams(); }
+    virtual void on_normal() { setParams(); }
+
+    //! Update the plane equation from the position and normal.
+    void setParams();
+};
+
+class OscCapsuleODE : public OscCapsule, public Pooled<OscCapsuleODE>
+{
+public:
+	OscCapsuleODE(dWorldID odeWorld, dSpaceID odeSpace, const char *name, OscBase *parent=NULL);
+    virtual ~OscCapsuleODE() {}
+
+protected:
+    virtual void on_radius() { on_size(); }
+    virtual void on_length() { on_size(); }
+    virtual void on_mass();
+    virtual void on_density();
+
+    //! Resize the geom and reset the mass to keep the same density.
+    void on_size();
+
+    virtual void on_grab()
+        { static_cast<PhysicsSim*>(simulation())->set_grabbed(this); }
+};
+
+class OscCylinderODE : public OscCylinder, public Pooled<OscCylinderODE>
+{
+public:
+	OscCylinderODE(dWorldID odeWorld, dSpaceID odeSpace, const char *name, OscBase *parent=NULL);
+    virtual ~OscCylinderODE() {}
+
+protected:
+    virtual void on_radius() { on_size(); }
+    virtual void on_length() { on_size(); }
+    virtual void on_mass();
+    virtual void on_density();
+
+    //! Resize the geom and reset the mass to keep the same density.
+    void on_size();
+
+    virtual void on_grab()
+        { static_cast<PhysicsSim*>(simulation())->set_grabbed(this); }
+};
+
+/*! A static ODE heightfield.  ODE heightfields have Y up, so the geom
+ *  is rotated to have Z up as in the rest of the world. */
+class OscHeightfieldODE : public OscHeightfield
+{
+public:
+	OscHeightfieldODE(dWorldID odeWorld, dSpaceID odeSpace, const char *name,
+                      int columns, int rows, OscBase *parent=NULL);
+    virtual ~OscHeightfieldODE();
+
+protected:
+    virtual void on_size();
+    virtual void on_rotation();
+    virtual void on_heights(int first, int count);
+
+    dHeightfieldDataID m_odeData;
+};
+
+/*! A composite in ODE is a body with no geom of its own.  The geoms
+ *  of its parts are attached to its body at their current offsets,
+ *  and its mass is the sum of the parts' masses. */
+class OscCompositeODE : public OscComposite
+{
+public:
+	OscCompositeODE(dWorldID odeWorld, dSpaceID odeSpace, const char *name, OscBase *parent=NULL);
+    virtual ~OscCompositeODE();
+
+    //! Release a part, restoring its own body if restore is true.
+    void detach(ODEObject *part, bool restore=true);
+
+    //! Recompute the mass of the body from the masses of its parts.
+    void updateMass();
+
+protected:
+    virtual void on_add(const char *name);
+    virtual void on_remove(const char *name);
+    virtual void on_mass();
+
+    virtual void on_grab()
+        { static_cast<PhysicsSim*>(simulation())->set_grabbed(this); }
+
+    std::vector<ODEObject*> m_parts;
+};
+
+/*! A force field in ODE, which has no body or geom of its own. */
+class OscFieldODE : public OscField
+{
+public:
+	OscFieldODE(const char *name, FieldType type, OscBase *parent=NULL);
+    virtual ~OscFieldODE();
+
+    /*! Add this field's force on count bodies to force, given their
+     *  positions and velocities as consecutive x, y, z values.  Each
+     *  field type is a single pass over the arrays with no branches
+     *  on the type inside the loop. */
+    void evaluate(int count, const dReal *position, const dReal *velocity,
+                  dReal *force, dReal time);
+
+protected:
+    //! Return the scale of the field at distance d from its position.
+    dReal scale(dReal d) {
+        if (m_radius.m_value <= 0) return 1;
+        if (d >= m_radius.m_value) return 0;
+        return pow(1 - d / m_radius.m_value, m_falloff.m_value);
+    }
+
+    PhysicsSim *m_pSim;
+};
+
+/*! A particle system in ODE.  Each particle is a body with a sphere
+ *  geom, kept in a hash space of its own that sits in the world's
+ *  quadtree as a single geom, so that the many small particles do not
+ *  crowd the tree's cells.  Particle geoms carry no OscObject, so
+ *  their collisions are not reported. */
+class OscParticlesODE : public OscParticles
+{
+public:
+    OscParticlesODE(dWorldID odeWorld, dSpaceID odeSpace, const char *name,
+                    int count, OscBase *parent=NULL);
+    virtual ~OscParticlesODE();
+
+    dSpaceID space() { return m_odeSpace; }
+
+    const std::vector<dBodyID>& bodies() { return m_bodies; }
+
+    //! Copy the positions of all particles after a step.
+    void update();
+
+    /*! Send the positions of the next few chunks of particles to the
+     *  visual simulation.  Chunks are spread over the physics steps
+     *  of one visual frame, so each particle is sent once per frame
+     *  without flooding the message queues. */
+    void publish();
+
+protected:
+    virtual void on_position();
+    virtual void on_velocity();
+    virtual void on_force();
+    virtual void on_radius();
+    virtual void on_mass();
+    virtual void on_density();
+
+    //! Place the particles in a cubic lattice centered on the
+    //! object's position, at rest.
+    void arrange();
+
+    //! Set the mass of every particle from the shared density.
+    void setMass();
+
+    dWorldID m_odeWorld;
+    dSpaceID m_odeSpace;
+    std::vector<dBodyID> m_bodies;
+    std::vector<dGeomID> m_geoms;
+
+    //! Positions as of the last step, 3 floats per particle.
+    std::vector<float> m_positions;
+
+    int m_nextChunk;
+    std::string m_positionsPath;
+    PhysicsSim *m_pSim;
+
+    static void on_refresh(void* me, OscValue &v);
+
+    static int positions_get_handler(const char *path, const char *types,
+                                     lo_arg **argv, int argc, void *data,
+                                     void *user_data);
+};
+
 class OscHingeODE : public OscHinge
 {
 public:
@@ -294,7 +991,12 @@ public:
                 double x, double y, double z, double ax, double ay, double az);
     virtual ~OscHingeODE();
 
-    virtual void simulationCallback();
+    virtual void on_response();
+
+    //! Access to the joint state for the batched response.
+    void readResponse(dReal *position, dReal *rate);
+    void applyResponse(const dReal *position, const dReal *force);
+    int m_responseIndex;
 
 protected:
     virtual void on_torque()
@@ -314,7 +1016,12 @@ public:
 
     virtual ~OscHinge2ODE();
 
-    virtual void simulationCallback();
+    virtual void on_response();
+
+    //! Access to the joint state for the batched response.
+    void readResponse(dReal *position, dReal *rate);
+    void applyResponse(const dReal *position, const dReal *force);
+    int m_responseIndex;
 
 protected:
     virtual void on_torque1()
@@ -347,7 +1054,12 @@ public:
 
     virtual ~OscFreeODE();
 
-    virtual void simulationCallback();
+    virtual void on_response();
+
+    //! Access to the joint state for the batched response.
+    void readResponse(dReal *position, dReal *rate);
+    void applyResponse(const dReal *position, const dReal *force);
+    int m_responseIndex;
 
 protected:
     virtual void on_force();
@@ -375,7 +1087,12 @@ public:
 
     virtual ~OscSlideODE();
 
-    virtual void simulationCallback();
+    virtual void on_response();
+
+    //! Access to the joint state for the batched response.
+    void readResponse(dReal *position, dReal *rate);
+    void applyResponse(const dReal *position, const dReal *force);
+    int m_responseIndex;
 
 protected:
     virtual void on_force()
@@ -394,7 +1111,12 @@ public:
 
     virtual ~OscPistonODE();
 
-    virtual void simulationCallback();
+    virtual void on_response();
+
+    //! Access to the joint state for the batched response.
+    void readResponse(dReal *position, dReal *rate);
+    void applyResponse(const dReal *position, const dReal *force);
+    int m_responseIndex;
 
 protected:
     virtual void on_force()
@@ -415,7 +1137,12 @@ public:
 
     virtual ~OscUniversalODE();
 
-    virtual void simulationCallback();
+    virtual void on_response();
+
+    //! Access to the joint state for the batched response.
+    void readResponse(dReal *position, dReal *rate);
+    void applyResponse(const dReal *position, const dReal *force);
+    int m_responseIndex;
 
 protected:
     virtual void on_torque1()
@@ -2,6 +2,14 @@
 
 #include <chrono>
 #include <cerrno>
+#include <cstring>
+#include <algorithm>
+
+#ifndef WIN32
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#endif
 
 #include <lo/lo.h>
 
@@ -130,6 +138,289 @@ int MeshFactory::create_handler(const char *path, const char *types, lo_arg **ar
     return 0;
 }
 
+ParticlesFactory::ParticlesFactory(Simulation *parent)
+    : ShapeFactory("particles", parent)
+{
+    // Name, Count, optional position
+    addHandler("create", "si", create_handler);
+    addHandler("create", "sifff", create_handler);
+}
+
+ParticlesFactory::~ParticlesFactory()
+{
+}
+
+int ParticlesFactory::create_handler(const char *path, const char *types, lo_arg **argv,
+                                      int argc, void *data, void *user_data)
+{
+    ParticlesFactory *me = static_cast<ParticlesFactory*>(user_data);
+
+    // Optional position, default (0,0,0)
+    cVector3d pos;
+    if (argc>2)
+        pos.x(argv[2]->f);
+    if (argc>3)
+        pos.y(argv[3]->f);
+    if (argc>4)
+        pos.z(argv[4]->f);
+
+    if (argv[1]->i <= 0) {
+        printf("[%s] Error creating particles '%s', "
+               "count must be greater than zero.\n",
+               me->simulation()->type_str(), &argv[0]->s);
+        return 0;
+    }
+
+    OscObject *o = me->simulation()->find_object(&argv[0]->s);
+    if (o)
+        printf("[%s] Already an object named %s\n",
+               me->simulation()->type_str(), &argv[0]->s);
+    else
+        if (!me->create(&argv[0]->s, argv[1]->i, pos.x(), pos.y(), pos.z()))
+            printf("[%s] Error creating particles '%s'.\n",
+                   me->simulation()->type_str(), &argv[0]->s);
+
+    return 0;
+}
+
+PlaneFactory::PlaneFactory(Simulation *parent)
+    : ShapeFactory("plane", parent)
+{
+    // Name, optional position
+    addHandler("create", "sfff", create_handler);
+}
+
+PlaneFactory::~PlaneFactory()
+{
+}
+
+int PlaneFactory::create_handler(const char *path, const char *types, lo_arg **argv,
+                                 int argc, void *data, void *user_data)
+{
+    PlaneFactory *me = static_cast<PlaneFactory*>(user_data);
+
+    // Optional position, default (0,0,0)
+    cVector3d pos;
+    if (argc>0)
+        pos.x(argv[1]->f);
+    if (argc>1)
+        pos.y(argv[2]->f);
+    if (argc>2)
+        pos.z(argv[3]->f);
+
+    OscObject *o = me->simulation()->find_object(&argv[0]->s);
+    if (o)
+        printf("[%s] Already an object named %s\n",
+               me->simulation()->type_str(), &argv[0]->s);
+    else
+        if (!me->create(&argv[0]->s, pos.x(), pos.y(), pos.z()))
+            printf("[%s] Error creating plane '%s'.\n",
+                   me->simulation()->type_str(), &argv[0]->s);
+
+    return 0;
+}
+
+CapsuleFactory::CapsuleFactory(Simulation *parent)
+    : ShapeFactory("capsule", parent)
+{
+    // Name, optional position
+    addHandler("create", "sfff", create_handler);
+}
+
+CapsuleFactory::~CapsuleFactory()
+{
+}
+
+int CapsuleFactory::create_handler(const char *path, const char *types, lo_arg **argv,
+                                   int argc, void *data, void *user_data)
+{
+    CapsuleFactory *me = static_cast<CapsuleFactory*>(user_data);
+
+    // Optional position, default (0,0,0)
+    cVector3d pos;
+    if (argc>0)
+        pos.x(argv[1]->f);
+    if (argc>1)
+        pos.y(argv[2]->f);
+    if (argc>2)
+        pos.z(argv[3]->f);
+
+    OscObject *o = me->simulation()->find_object(&argv[0]->s);
+    if (o)
+        printf("[%s] Already an object named %s\n",
+               me->simulation()->type_str(), &argv[0]->s);
+    else
+        if (!me->create(&argv[0]->s, pos.x(), pos.y(), pos.z()))
+            printf("[%s] Error creating capsule '%s'.\n",
+                   me->simulation()->type_str(), &argv[0]->s);
+
+    return 0;
+}
+
+CylinderFactory::CylinderFactory(Simulation *parent)
+    : ShapeFactory("cylinder", parent)
+{
+    // Name, optional position
+    addHandler("create", "sfff", create_handler);
+}
+
+CylinderFactory::~CylinderFactory()
+{
+}
+
+int CylinderFactory::create_handler(const char *path, const char *types, lo_arg **argv,
+                                    int argc, void *data, void *user_data)
+{
+    CylinderFactory *me = static_cast<CylinderFactory*>(user_data);
+
+    // Optional position, default (0,0,0)
+    cVector3d pos;
+    if (argc>0)
+        pos.x(argv[1]->f);
+    if (argc>1)
+        pos.y(argv[2]->f);
+    if (argc>2)
+        pos.z(argv[3]->f);
+
+    OscObject *o = me->simulation()->find_object(&argv[0]->s);
+    if (o)
+        printf("[%s] Already an object named %s\n",
+               me->simulation()->type_str(), &argv[0]->s);
+    else
+        if (!me->create(&argv[0]->s, pos.x(), pos.y(), pos.z()))
+            printf("[%s] Error creating cylinder '%s'.\n",
+                   me->simulation()->type_str(), &argv[0]->s);
+
+    return 0;
+}
+
+HeightfieldFactory::HeightfieldFactory(Simulation *parent)
+    : ShapeFactory("heightfield", parent)
+{
+    // Name, Columns, Rows, optional position
+    addHandler("create", "sii", create_handler);
+    addHandler("create", "siifff", create_handler);
+}
+
+HeightfieldFactory::~HeightfieldFactory()
+{
+}
+
+int HeightfieldFactory::create_handler(const char *path, const char *types, lo_arg **argv,
+                                       int argc, void *data, void *user_data)
+{
+    HeightfieldFactory *me = static_cast<HeightfieldFactory*>(user_data);
+
+    // Optional position, default (0,0,0)
+    cVector3d pos;
+    if (argc>3)
+        pos.x(argv[3]->f);
+    if (argc>4)
+        pos.y(argv[4]->f);
+    if (argc>5)
+        pos.z(argv[5]->f);
+
+    if (argv[1]->i < 2 || argv[2]->i < 2) {
+        printf("[%s] Error creating heightfield '%s', "
+               "at least 2 columns and 2 rows are needed.\n",
+               me->simulation()->type_str(), &argv[0]->s);
+        return 0;
+    }
+
+    OscObject *o = me->simulation()->find_object(&argv[0]->s);
+    if (o)
+        printf("[%s] Already an object named %s\n",
+               me->simulation()->type_str(), &argv[0]->s);
+    else
+        if (!me->create(&argv[0]->s, argv[1]->i, argv[2]->i,
+                        pos.x(), pos.y(), pos.z()))
+            printf("[%s] Error creating heightfield '%s'.\n",
+                   me->simulation()->type_str(), &argv[0]->s);
+
+    return 0;
+}
+
+CompositeFactory::CompositeFactory(Simulation *parent)
+    : ShapeFactory("composite", parent)
+{
+    // Name, optional position
+    addHandler("create", "sfff", create_handler);
+}
+
+CompositeFactory::~CompositeFactory()
+{
+}
+
+int CompositeFactory::create_handler(const char *path, const char *types, lo_arg **argv,
+                                     int argc, void *data, void *user_data)
+{
+    CompositeFactory *me = static_cast<CompositeFactory*>(user_data);
+
+    // Optional position, default (0,0,0)
+    cVector3d pos;
+    if (argc>0)
+        pos.x(argv[1]->f);
+    if (argc>1)
+        pos.y(argv[2]->f);
+    if (argc>2)
+        pos.z(argv[3]->f);
+
+    OscObject *o = me->simulation()->find_object(&argv[0]->s);
+    if (o)
+        printf("[%s] Already an object named %s\n",
+               me->simulation()->type_str(), &argv[0]->s);
+    else
+        if (!me->create(&argv[0]->s, pos.x(), pos.y(), pos.z()))
+            printf("[%s] Error creating composite '%s'.\n",
+                   me->simulation()->type_str(), &argv[0]->s);
+
+    return 0;
+}
+
+FieldFactory::FieldFactory(Simulation *parent)
+    : ShapeFactory("field", parent)
+{
+    // Name, Type, optional position
+    addHandler("create", "ss", create_handler);
+    addHandler("create", "ssfff", create_handler);
+}
+
+FieldFactory::~FieldFactory()
+{
+}
+
+int FieldFactory::create_handler(const char *path, const char *types, lo_arg **argv,
+                                 int argc, void *data, void *user_data)
+{
+    FieldFactory *me = static_cast<FieldFactory*>(user_data);
+
+    // Optional position, default (0,0,0)
+    cVector3d pos;
+    if (argc>2)
+        pos.x(argv[2]->f);
+    if (argc>3)
+        pos.y(argv[3]->f);
+    if (argc>4)
+        pos.z(argv[4]->f);
+
+    if (OscField::str_type(&argv[1]->s) == OscField::FIELD_UNKNOWN) {
+        printf("[%s] Error creating field '%s', unknown type '%s'.\n",
+               me->simulation()->type_str(), &argv[0]->s, &argv[1]->s);
+        return 0;
+    }
+
+    OscObject *o = me->simulation()->find_object(&argv[0]->s);
+    if (o)
+        printf("[%s] Already an object named %s\n",
+               me->simulation()->type_str(), &argv[0]->s);
+    else
+        if (!me->create(&argv[0]->s, &argv[1]->s, pos.x(), pos.y(), pos.z()))
+            printf("[%s] Error creating field '%s'.\n",
+                   me->simulation()->type_str(), &argv[0]->s);
+
+    return 0;
+}
+
 HingeFactory::HingeFactory(Simulation *parent)
     : ShapeFactory("hinge", parent)
 {
@@ -549,10 +840,70 @@ int UniversalFactory::create_handler(const char *path, const char *types, lo_arg
     return 0;
 }
 
+SpatialQuery::SpatialQuery(Simulation *parent)
+    : OscBase("query", parent)
+{
+    // Origin, direction, optional length
+    addHandler("raycast", "ffffff", raycast_handler);
+    addHandler("raycast", "fffffff", raycast_handler);
+
+    // Center, radius
+    addHandler("sphere", "ffff", sphere_handler);
+
+    // Point, number of objects
+    addHandler("nearest", "fffi", nearest_handler);
+}
+
+SpatialQuery::~SpatialQuery()
+{
+}
+
+int SpatialQuery::raycast_handler(const char *path, const char *types, lo_arg **argv,
+                                  int argc, void *data, void *user_data)
+{
+    SpatialQuery *me = static_cast<SpatialQuery*>(user_data);
+
+    cVector3d dir(argv[3]->f, argv[4]->f, argv[5]->f);
+    if (dir.length() == 0) {
+        printf("[%s] Raycast direction cannot be zero.\n",
+               me->simulation()->type_str());
+        return 0;
+    }
+
+    // Default length is long enough to cross the world.
+    float length = (argc > 6) ? argv[6]->f : 100;
+
+    me->raycast(argv[0]->f, argv[1]->f, argv[2]->f,
+                dir.x(), dir.y(), dir.z(), length);
+    return 0;
+}
+
+int SpatialQuery::sphere_handler(const char *path, const char *types, lo_arg **argv,
+                                 int argc, void *data, void *user_data)
+{
+    SpatialQuery *me = static_cast<SpatialQuery*>(user_data);
+    if (argv[3]->f <= 0)
+        return 0;
+
+    me->sphere(argv[0]->f, argv[1]->f, argv[2]->f, argv[3]->f);
+    return 0;
+}
+
+int SpatialQuery::nearest_handler(const char *path, const char *types, lo_arg **argv,
+                                  int argc, void *data, void *user_data)
+{
+    SpatialQuery *me = static_cast<SpatialQuery*>(user_data);
+    if (argv[3]->i < 1)
+        return 0;
+
+    me->nearest(argv[0]->f, argv[1]->f, argv[2]->f, argv[3]->i);
+    return 0;
+}
+
 /****** SimulationReceiver *******/
 
 SimulationReceiver::SimulationReceiver(const char *url, int type)
-    : m_type(type), m_queue(0)
+    : m_type(type), m_queue(0), m_outboxQueue(0)
 {
     m_addr = lo_address_new_from_url(url);
     switch (m_type) {
@@ -570,12 +921,15 @@ SimulationReceiver::SimulationReceiver(const char *url, int type)
     m_bUseQueue = false;
 }
 
-SimulationReceiver::SimulationReceiver(Simulation &sim)
+SimulationReceiver::SimulationReceiver(Simulation &sim, bool outbox)
     : m_addr(sim.addr()), m_fTimestep(sim.timestep()),
-      m_type(sim.type()), m_queue(msg_queue_size)
+      m_type(sim.type()), m_queue(msg_queue_size),
+      m_outboxQueue(outbox ? msg_queue_size : 0)
 {
     m_bUseQueue = true;
     sim.add_queue(&m_queue);
+    if (outbox)
+        sim.add_queue(&m_outboxQueue);
 }
 
 void SimulationReceiver::send_lo_message(const char *path, lo_message msg)
@@ -588,6 +942,16 @@ void SimulationReceiver::send_lo_message(const char *path, lo_message msg)
         lo_send_message(addr(), path, msg);
 }
 
+void SimulationReceiver::send_outbox_message(const char *path, lo_message msg)
+{
+#ifdef USE_QUEUES
+    if (m_bUseQueue)
+        m_outboxQueue.write_lo_message(path, msg);
+    else
+#endif
+        lo_send_message(addr(), path, msg);
+}
+
 /****** Simulation *******/
 
 Simulation::Simulation(const char *port, int type)
@@ -598,8 +962,14 @@ Simulation::Simulation(const char *port, int type)
       m_grab_stiffness("grab/stiffness", this),
       m_grab_damping("grab/damping", this),
       m_grab_feedback("grab/feedback", this),
+      m_haptics_margin("haptics/margin", this),
       m_workspace_size("workspace/size", this),
-      m_workspace_center("workspace/center", this)
+      m_workspace_center("workspace/center", this),
+      m_physics_threads("physics/threads", this),
+      m_physics_step_time("physics/step_time", this),
+      m_physics_substeps("physics/substeps", this),
+      m_attraction("attraction", this),
+      m_attraction_theta("attraction/theta", this)
 {
     m_addr = lo_address_new("localhost", port);
     m_type = type;
@@ -623,8 +993,22 @@ Simulation::Simulation(const char *port, int type)
     m_grab_damping.setSetCallback(set_grab_damping, this);
     m_grab_feedback.setSetCallback(set_grab_feedback, this);
 
+    m_haptics_margin.setValue(0.05);
+    m_haptics_margin.setSetCallback(set_haptics_margin, this);
+
     m_workspace_size.setSetCallback(set_workspace_size, this);
     m_workspace_center.setSetCallback(set_workspace_center, this);
+
+    m_physics_threads.setValue(1);
+    m_physics_threads.setSetCallback(set_physics_threads, this);
+    m_physics_step_time.setSetCallback(set_physics_step_time, this);
+    m_physics_substeps.setValue(1);
+    m_physics_substeps.setSetCallback(set_physics_substeps, this);
+
+    m_attraction.setValue(0);
+    m_attraction.setSetCallback(set_attraction, this);
+    m_attraction_theta.setValue(0.5);
+    m_attraction_theta.setSetCallback(set_attraction_theta, this);
 }
 
 Simulation::~Simulation()
@@ -647,8 +1031,14 @@ Simulation::~Simulation()
     m_grab_stiffness.m_server = 0;
     m_grab_damping.m_server = 0;
     m_grab_feedback.m_server = 0;
+    m_haptics_margin.m_server = 0;
     m_workspace_size.m_server = 0;
     m_workspace_center.m_server = 0;
+    m_physics_threads.m_server = 0;
+    m_physics_step_time.m_server = 0;
+    m_physics_substeps.m_server = 0;
+    m_attraction.m_server = 0;
+    m_attraction_theta.m_server = 0;
 }
 
 void Simulation::add_receiver(Simulation *sim, const char *spec,
@@ -657,7 +1047,7 @@ void Simulation::add_receiver(Simulation *sim, const char *spec,
 {
     SimulationReceiver *r = NULL;
     if (sim)
-        r = new SimulationReceiver(*sim);
+        r = new SimulationReceiver(*sim, m_type == ST_HAPTICS);
     else if (spec[0] != '\0') {
         // Check that we don't already have it in the list
         std::vector<SimulationReceiver*>::iterator it;
@@ -773,6 +1163,10 @@ void Simulation::initialize()
     addHandler("workspace/learn", "", Simulation::workspace_learn_handler);
     addHandler("workspace/freeze", "", Simulation::workspace_freeze_handler);
     addHandler("workspace/standard", "", Simulation::workspace_standard_handler);
+    addHandler("thread/priority", "si", Simulation::thread_priority_handler);
+    addHandler("thread/priority", "sis", Simulation::thread_priority_handler);
+    addHandler("thread/cpus", "ss", Simulation::thread_cpus_handler);
+    addHandler("thread/lock_memory", "", Simulation::thread_lock_memory_handler);
 }
 
 void* Simulation::run(void* param)
@@ -781,6 +1175,16 @@ void* Simulation::run(void* param)
 
     me->initialize();
 
+    // Helper threads inherit the scheduling of this one, so they are
+    // started before it is made real-time.
+    me->m_loader.start();
+
+    // Failures are reported, but the simulation runs regardless.
+    if (me->m_threadOptions.priority > 0)
+        me->apply_thread_priority();
+    if (!me->m_threadOptions.cpus.empty())
+        me->apply_thread_cpus();
+
     if (me->m_bDone)
         printf("[%s] Error initialization simulation, port %u.\n",
                me->type_str(), lo_server_get_port(me->m_server));
@@ -800,26 +1204,60 @@ void* Simulation::run(void* param)
 
     std::vector<LoQueue*>::iterator qit;
 
-    int step_ms = (int)(me->m_fTimestep*1000);
-    int step_us = (int)(me->m_fTimestep*1000000);
-    int step_left = step_ms;
+    /* Each step begins at a deadline one timestep after the last
+     * one, rather than one timestep after the last step ended, so
+     * that time spent dispatching messages and stepping does not
+     * accumulate as drift.  Until shortly before the deadline the
+     * thread waits for OSC messages, then sleeps, and optionally
+     * busy-waits for the last few microseconds, since sleeping
+     * may overshoot. */
+    typedef std::chrono::steady_clock clock;
+    const clock::duration period =
+        std::chrono::duration_cast<clock::duration>(
+            std::chrono::duration<double>(me->m_fTimestep));
+    const clock::duration spin =
+        std::chrono::microseconds(me->m_threadOptions.spin_us);
+    const double step_ms = me->m_fTimestep*1000;
+
+    clock::time_point deadline = clock::now();
     while (!me->m_bDone)
     {
-        me->m_clock.reset();
-        me->m_clock.setTimeoutPeriodSeconds(me->m_fTimestep);
-        me->m_clock.start();
-        step_left = me->m_bSelfTimed ? step_ms : 0;
-        while (lo_server_recv_noblock(me->m_server, step_left) > 0) {
-            step_left = step_ms-(me->m_clock.getCurrentTimeSeconds()/1000);
-            if (step_left < 0) step_left = 0;
+        deadline += period;
+        clock::time_point now = clock::now();
+
+        // After falling more than a step behind, for example while
+        // loading a mesh, skip the missed steps instead of running
+        // them all at once.
+        if (now > deadline + period)
+            deadline = now;
+
+        if (me->m_bSelfTimed) {
+            clock::time_point wake = deadline - spin;
+            while (now < wake) {
+                int wait_ms = (int)std::chrono::duration_cast<
+                    std::chrono::milliseconds>(wake - now).count();
+                if (wait_ms < 1) {
+                    // Less than the resolution of the receive timeout.
+                    while (lo_server_recv_noblock(me->m_server, 0) > 0) {}
+                    std::this_thread::sleep_until(wake);
+                    break;
+                }
+                lo_server_recv_noblock(me->m_server, wait_ms);
+                now = clock::now();
+            }
+            while (clock::now() < deadline) {}
         }
+        else
+            while (lo_server_recv_noblock(me->m_server, 0) > 0) {}
+
 #ifdef USE_QUEUES
         for (qit=me->m_queueList.begin();
              qit!=me->m_queueList.end(); qit++) {
             while ((*qit)->read_and_dispatch(me->m_server)) {}
         }
 #endif
-        me->m_clock.stop();
+        me->collect_deleted();
+        me->m_loader.finish();
         me->step();
         me->m_valueTimer.onTimer(step_ms);
     }
@@ -834,19 +1272,35 @@ bool Simulation::add_object(OscObject& obj)
 {
     world_objects[obj.name()] = &obj;
 
+    // The path is cached now so that no real-time loop builds it.
+    obj.path();
+
     printf("[%s] Added object %s\n", type_str(), obj.c_name());
     return true;
 }
 
 bool Simulation::delete_object(OscObject& obj)
 {
+    // The object may already have been destroyed during this step.
+    object_iterator it = world_objects.find(obj.name());
+    if (it == world_objects.end() || it->second != &obj)
+        return false;
+
     printf("[%s] Removing object %s\n", type_str(), obj.c_name());
 
     if (m_pGrabbedObject == &obj)
         set_grabbed(NULL);
 
-    world_objects.erase(obj.name());
-    delete &obj;
+    // Constraints are destroyed now, so that they are freed before
+    // the object they refer to.
+    while (!obj.m_constraintList.empty()) {
+        OscConstraint *c = obj.m_constraintList.front();
+        obj.m_constraintList.pop_front();
+        c->on_destroy();
+    }
+
+    world_objects.erase(it);
+    m_deletedObjects.push_back(&obj);
 
     return true;
 }
@@ -869,14 +1323,53 @@ bool Simulation::add_constraint(OscConstraint& obj)
 
 bool Simulation::delete_constraint(OscConstraint& obj)
 {
+    constraint_iterator it = world_constraints.find(obj.name());
+    if (it == world_constraints.end() || it->second != &obj)
+        return false;
+
     printf("[%s] Removing constraint %s\n", type_str(), obj.c_name());
 
-    world_constraints.erase(obj.name());
-    delete &obj;
+    if (obj.object1())
+        obj.object1()->m_constraintList.remove(&obj);
+    if (obj.object2())
+        obj.object2()->m_constraintList.remove(&obj);
+
+    world_constraints.erase(it);
+    m_deletedConstraints.push_back(&obj);
 
     return true;
 }
 
+static bool created_before(const OscBase *a, const OscBase *b)
+{
+    return a->serial() < b->serial();
+}
+
+void Simulation::collect_deleted()
+{
+    // Deleting an object destroys its constraints, so repeat until
+    // nothing more is destroyed.
+    while (!m_deletedObjects.empty() || !m_deletedConstraints.empty())
+    {
+        /* liblo searches its list of methods from the oldest, so
+         * removing methods in the order they were added keeps
+         * deleting many objects linear. */
+        std::vector<OscConstraint*> constraints;
+        constraints.swap(m_deletedConstraints);
+        std::sort(constraints.begin(), constraints.end(), created_before);
+        std::vector<OscConstraint*>::iterator cit;
+        for (cit=constraints.begin(); cit!=constraints.end(); cit++)
+            delete *cit;
+
+        std::vector<OscObject*> objects;
+        objects.swap(m_deletedObjects);
+        std::sort(objects.begin(), objects.end(), created_before);
+        std::vector<OscObject*>::iterator oit;
+        for (oit=objects.begin(); oit!=objects.end(); oit++)
+            delete *oit;
+    }
+}
+
 // from liblo internals:
 // eventually this will be a public function in liblo,
 // but for now we'll reproduce it here.
@@ -1027,6 +1520,160 @@ void Simulation::sendtotype(int type, bool throttle, const char *path, const cha
     lo_message_free(msg);
 }
 
+int Simulation::thread_priority_handler(const char *path, const char *types,
+                                        lo_arg **argv, int argc, void *data,
+                                        void *user_data)
+{
+    Simulation *me = static_cast<Simulation*>(user_data);
+    me->m_msg = data;
+    me->on_thread_priority(&argv[0]->s, argv[1]->i,
+                           argc > 2 ? &argv[2]->s : "fifo");
+    return 0;
+}
+
+void Simulation::on_thread_priority(const char *sim, int priority,
+                                    const char *policy)
+{
+    if (str_type(sim) != m_type)
+        return;
+
+    m_threadOptions.priority = priority;
+    m_threadOptions.policy = policy;
+    apply_thread_priority();
+}
+
+void Simulation::on_thread_cpus(const char *sim, const char *cpus)
+{
+    if (str_type(sim) != m_type)
+        return;
+
+    m_threadOptions.cpus = cpus;
+    apply_thread_cpus();
+}
+
+bool Simulation::apply_thread_priority()
+{
+    const ThreadOptions &o = m_threadOptions;
+
+#ifdef WIN32
+    printf("[%s] Setting thread priority is not supported on this "
+           "platform.\n", type_str());
+    return false;
+#else
+    int policy = SCHED_OTHER;
+    if (o.priority > 0) {
+        if (o.policy == "fifo")
+            policy = SCHED_FIFO;
+        else if (o.policy == "rr")
+            policy = SCHED_RR;
+        else {
+            printf("[%s] Unknown scheduling policy '%s', "
+                   "expected 'fifo' or 'rr'.\n", type_str(), o.policy.c_str());
+            return false;
+        }
+    }
+
+    struct sched_param param;
+    param.sched_priority = 0;
+    if (o.priority > 0)
+        param.sched_priority = std::max(sched_get_priority_min(policy),
+                                        std::min(sched_get_priority_max(policy),
+                                                 o.priority));
+
+    int rc = pthread_setschedparam(pthread_self(), policy, &param);
+    if (rc) {
+        printf("[%s] Unable to set thread priority %d: %s\n",
+               type_str(), param.sched_priority, strerror(rc));
+        if (rc == EPERM)
+            printf("[%s] Real-time priorities need privileges, such as "
+                   "an rtprio limit or CAP_SYS_NICE.\n", type_str());
+        return false;
+    }
+
+    if (o.priority > 0)
+        printf("[%s] Thread running at %s priority %d.\n", type_str(),
+               o.policy.c_str(), param.sched_priority);
+    else
+        printf("[%s] Thread running at normal priority.\n", type_str());
+    return true;
+#endif
+}
+
+bool Simulation::apply_thread_cpus()
+{
+    const std::string &cpus = m_threadOptions.cpus;
+
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+
+    if (cpus.empty()) {
+        for (int i=0; i < CPU_SETSIZE; i++)
+            CPU_SET(i, &set);
+    }
+    else {
+        // A comma-separated list of CPUs and ranges, e.g. "0-1,3".
+        const char *s = cpus.c_str();
+        while (*s) {
+            char *end;
+            long first = strtol(s, &end, 10), last = first;
+            if (end == s)
+                break;
+            s = end;
+            if (*s == '-') {
+                last = strtol(s+1, &end, 10);
+                if (end == s+1)
+                    break;
+                s = end;
+            }
+            if (first < 0 || last < first || last >= CPU_SETSIZE)
+                break;
+            for (long i=first; i <= last; i++)
+                CPU_SET(i, &set);
+            if (*s == ',')
+                s++;
+            else if (*s)
+                break;
+        }
+        if (*s || CPU_COUNT(&set) == 0) {
+            printf("[%s] Error parsing CPU list '%s'.\n", type_str(),
+                   cpus.c_str());
+            return false;
+        }
+    }
+
+    int rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (rc) {
+        printf("[%s] Unable to set thread CPUs '%s': %s\n", type_str(),
+               cpus.c_str(), strerror(rc));
+        return false;
+    }
+
+    printf("[%s] Thread running on CPUs %s.\n", type_str(),
+           cpus.empty() ? "(any)" : cpus.c_str());
+    return true;
+#else
+    printf("[%s] Setting thread CPUs is not supported on this "
+           "platform.\n", type_str());
+    return false;
+#endif
+}
+
+bool Simulation::lock_memory()
+{
+#ifndef WIN32
+    if (mlockall(MCL_CURRENT | MCL_FUTURE)) {
+        printf("Unable to lock memory: %s\n", strerror(errno));
+        return false;
+    }
+    printf("Memory locked.\n");
+    return true;
+#else
+    printf("Locking memory is not supported on this platform.\n");
+    return false;
+#endif
+}
+
 const char* Simulation::type_str()
 {
     return type_str(m_type);
@@ -1065,15 +1712,29 @@ void Simulation::on_clear()
 {
     on_drop();
 
+    /* Everything is removed in bulk rather than through each
+     * object's on_destroy(), which would report each object to the
+     * other simulations; they each receive /world/clear instead.
+     * Constraints go first, so objects need not remove them from
+     * each other's constraint lists. */
+    printf("[%s] Clearing %d objects and %d constraints\n", type_str(),
+           (int)world_objects.size(), (int)world_constraints.size());
+
+    constraint_iterator cit;
+    for (cit=world_constraints.begin(); cit!=world_constraints.end(); cit++)
+        m_deletedConstraints.push_back(cit->second);
+    world_constraints.clear();
+
     object_iterator it = world_objects.begin();
     while (it != world_objects.end())
     {
+        it->second->m_constraintList.clear();
         if (it->second->name() == "cursor"
             || it->second->name() == "device")
             it++;
         else {
-            it->second->on_destroy();
-            it = world_objects.begin();
+            m_deletedObjects.push_back(it->second);
+            world_objects.erase(it++);
         }
     }
 }
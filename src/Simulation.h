@@ -9,12 +9,19 @@
 
 #include "OscValue.h"
 #include "ValueTimer.h"
-#include "timers/CPrecisionClock.h"
 #include "LoQueue.h"
+#include "AssetLoader.h"
 
 class SphereFactory;
 class PrismFactory;
 class MeshFactory;
+class ParticlesFactory;
+class PlaneFactory;
+class CapsuleFactory;
+class CylinderFactory;
+class HeightfieldFactory;
+class CompositeFactory;
+class FieldFactory;
 class HingeFactory;
 class Hinge2Factory;
 class FixedFactory;
@@ -23,29 +30,55 @@ class BallJointFactory;
 class SlideFactory;
 class PistonFactory;
 class UniversalFactory;
+class SpatialQuery;
 
 class OscObject;
 class OscConstraint;
 
+//! Scheduling options for a simulation's thread.
+struct ThreadOptions
+{
+    ThreadOptions() : priority(0), policy("fifo"), spin_us(0) {}
+
+    //! Real-time priority, or 0 for normal scheduling.
+    int priority;
+    //! Real-time policy, "fifo" or "rr".
+    std::string policy;
+    //! CPUs the thread may run on, such as "2,3" or "0-1", or empty
+    //! for any CPU.
+    std::string cpus;
+    //! Time before each step's deadline spent busy-waiting rather
+    //! than sleeping, in microseconds.
+    int spin_us;
+};
+
 //! SimulationReceiver contains copies of information needed to send a
 //! simulation a message or stream of messages.
 class SimulationReceiver
 {
 public:
     SimulationReceiver(const char *url, int type);
-    SimulationReceiver(Simulation &sim);
+    /*! A receiver for a simulation in this process.  If outbox is
+     *  true, the sending simulation also sends from an Outbox thread,
+     *  which is given its own queue. */
+    SimulationReceiver(Simulation &sim, bool outbox=false);
 
     lo_address addr() { return m_addr; }
-    float timestep() { return m_fTimestep; }
+    double timestep() { return m_fTimestep; }
     int type() { return m_type; }
 
     LoQueue m_queue;
+    //! Queue written by the sending simulation's Outbox thread, so
+    //! that each queue has a single writer.
+    LoQueue m_outboxQueue;
 
     void send_lo_message(const char *path, lo_message msg);
+    //! Send a message from the sending simulation's Outbox thread.
+    void send_outbox_message(const char *path, lo_message msg);
 
 protected:
     lo_address m_addr;
-    float m_fTimestep;
+    double m_fTimestep;
     int m_type;
     bool m_bUseQueue;
 };
@@ -87,11 +120,20 @@ class Simulation : public OscBase
     bool add_constraint(OscConstraint& obj);
     bool delete_constraint(OscConstraint& obj);
 
+    /*! Free objects and constraints destroyed since this was last
+     *  called.  Destroyed objects are removed from the world
+     *  immediately but kept in memory until no message handler can
+     *  be using them (thread context). */
+    void collect_deleted();
+
     //! Set the grabbed object or ungrab by setting to NULL.
     virtual void set_grabbed(OscObject *pGrabbed)
         { m_pGrabbedObject = pGrabbed; }
 
-    float timestep() { return m_fTimestep; }
+    double timestep() { return m_fTimestep; }
+
+    //! Return the loader for files needed by this simulation's objects.
+    AssetLoader& loader() { return m_loader; }
 
     //! Return the list of receivers for messages from this simulation.
     const std::vector<SimulationReceiver*>& simulationList()
@@ -129,6 +171,7 @@ class Simulation : public OscBase
     OSCSCALAR(Simulation, grab_stiffness) {};
     OSCSCALAR(Simulation, grab_damping) {};
     OSCSCALAR(Simulation, grab_feedback) {};
+    OSCSCALAR(Simulation, haptics_margin) {};
 
     OSCVECTOR3(Simulation, workspace_size) {};
     OSCVECTOR3(Simulation, workspace_center) {};
@@ -136,9 +179,29 @@ class Simulation : public OscBase
     OSCMETHOD0(Simulation, workspace_freeze) {};
     OSCMETHOD0(Simulation, workspace_standard) {};
 
+    OSCSCALAR(Simulation, physics_threads) {};
+    OSCSCALAR(Simulation, physics_step_time) {};
+    OSCSCALAR(Simulation, physics_substeps) {};
+
+    OSCSCALAR(Simulation, attraction) {};
+    OSCSCALAR(Simulation, attraction_theta) {};
+
     void run_unthreaded()
       { run(this); }
 
+    //! Scheduling options, applied when the simulation starts.
+    ThreadOptions m_threadOptions;
+
+    //! Lock all current and future memory of the process into RAM.
+    static bool lock_memory();
+
+    //! Set the named simulation's real-time priority and policy.
+    virtual void on_thread_priority(const char *sim, int priority,
+                                    const char *policy);
+    //! Set the CPUs that the named simulation's thread may run on.
+    OSCMETHOD2S(Simulation, thread_cpus);
+    OSCMETHOD0(Simulation, thread_lock_memory) { lock_memory(); }
+
   protected:
     std::thread m_thread;
     std::mutex m_mutex;
@@ -146,7 +209,7 @@ class Simulation : public OscBase
     bool m_bStarted;
     bool m_bDone;
     int m_type;
-    float m_fTimestep;
+    double m_fTimestep;
 
     /*! True if this simulation should time itself according to m_fTimestep.
      * 
@@ -159,6 +222,13 @@ class Simulation : public OscBase
     PrismFactory *m_pPrismFactory;
     SphereFactory *m_pSphereFactory;
     MeshFactory *m_pMeshFactory;
+    ParticlesFactory *m_pParticlesFactory;
+    PlaneFactory *m_pPlaneFactory;
+    CapsuleFactory *m_pCapsuleFactory;
+    CylinderFactory *m_pCylinderFactory;
+    HeightfieldFactory *m_pHeightfieldFactory;
+    CompositeFactory *m_pCompositeFactory;
+    FieldFactory *m_pFieldFactory;
     HingeFactory *m_pHingeFactory;
     Hinge2Factory *m_pHinge2Factory;
     FixedFactory *m_pFixedFactory;
@@ -167,6 +237,7 @@ class Simulation : public OscBase
     SlideFactory *m_pSlideFactory;
     PistonFactory *m_pPistonFactory;
     UniversalFactory *m_pUniversalFactory;
+    SpatialQuery *m_pSpatialQuery;
 
     //! Track the grabbed object
     OscObject *m_pGrabbedObject;
@@ -178,6 +249,15 @@ class Simulation : public OscBase
     //! Override for a single step of the simulation (thread context).
     virtual void step() = 0;
 
+    //! Apply the scheduling options to the calling thread, which
+    //! must be this simulation's thread.
+    bool apply_thread_priority();
+    bool apply_thread_cpus();
+
+    static int thread_priority_handler(const char *path, const char *types,
+                                       lo_arg **argv, int argc, void *data,
+                                       void *user_data);
+
     //! LibLo address for receiving messages here.
     lo_address m_addr;
 
@@ -188,18 +268,22 @@ class Simulation : public OscBase
     typedef std::map<std::string,OscObject*>::iterator object_iterator;
     typedef std::map<std::string,OscConstraint*>::iterator constraint_iterator;
 
+    //! Objects and constraints waiting for collect_deleted().
+    std::vector<OscObject*> m_deletedObjects;
+    std::vector<OscConstraint*> m_deletedConstraints;
+
     //! List of other simulations that may receive messages from this one.
     std::vector<SimulationReceiver*> m_receiverList;
 
     //! List of FIFO queues to check for incoming messages.
     std::vector<LoQueue*> m_queueList;
 
-    //! Timer to ensure simulation steps are distributed in real time.
-    cPrecisionClock m_clock;
-
     //! Object to track values that need to be sent at regular intervals.
     ValueTimer m_valueTimer;
 
+    //! Loads files in the background, finished between steps.
+    AssetLoader m_loader;
+
     //! Map for collecting sent messages, for the purpose of throttling.
     std::map<std::string, int> sent_messages;
     typedef std::map<std::string, int>::iterator sent_messages_iterator;
@@ -266,6 +350,114 @@ protected:
                         float x, float y, float z) = 0;
 };
 
+class ParticlesFactory : public ShapeFactory
+{
+public:
+    ParticlesFactory(Simulation *parent);
+    virtual ~ParticlesFactory();
+
+protected:
+    // message handlers
+    static int create_handler(const char *path, const char *types, lo_arg **argv,
+                              int argc, void *data, void *user_data);
+
+    // override these functions with a specific factory subclass
+    virtual bool create(const char *name, int count,
+                        float x, float y, float z) = 0;
+};
+
+class PlaneFactory : public ShapeFactory
+{
+public:
+    PlaneFactory(Simulation *parent);
+    virtual ~PlaneFactory();
+
+protected:
+    // message handlers
+    static int create_handler(const char *path, const char *types, lo_arg **argv,
+                              int argc, void *data, void *user_data);
+
+    // override these functions with a specific factory subclass
+    virtual bool create(const char *name, float x, float y, float z) = 0;
+};
+
+class CapsuleFactory : public ShapeFactory
+{
+public:
+    CapsuleFactory(Simulation *parent);
+    virtual ~CapsuleFactory();
+
+protected:
+    // message handlers
+    static int create_handler(const char *path, const char *types, lo_arg **argv,
+                              int argc, void *data, void *user_data);
+
+    // override these functions with a specific factory subclass
+    virtual bool create(const char *name, float x, float y, float z) = 0;
+};
+
+class CylinderFactory : public ShapeFactory
+{
+public:
+    CylinderFactory(Simulation *parent);
+    virtual ~CylinderFactory();
+
+protected:
+    // message handlers
+    static int create_handler(const char *path, const char *types, lo_arg **argv,
+                              int argc, void *data, void *user_data);
+
+    // override these functions with a specific factory subclass
+    virtual bool create(const char *name, float x, float y, float z) = 0;
+};
+
+class HeightfieldFactory : public ShapeFactory
+{
+public:
+    HeightfieldFactory(Simulation *parent);
+    virtual ~HeightfieldFactory();
+
+protected:
+    // message handlers
+    static int create_handler(const char *path, const char *types, lo_arg **argv,
+                              int argc, void *data, void *user_data);
+
+    // override these functions with a specific factory subclass
+    virtual bool create(const char *name, int columns, int rows,
+                        float x, float y, float z) = 0;
+};
+
+class CompositeFactory : public ShapeFactory
+{
+public:
+    CompositeFactory(Simulation *parent);
+    virtual ~CompositeFactory();
+
+protected:
+    // message handlers
+    static int create_handler(const char *path, const char *types, lo_arg **argv,
+                              int argc, void *data, void *user_data);
+
+    // override these functions with a specific factory subclass
+    virtual bool create(const char *name, float x, float y, float z) = 0;
+};
+
+class FieldFactory : public ShapeFactory
+{
+public:
+    FieldFactory(Simulation *parent);
+    virtual ~FieldFactory();
+
+protected:
+    // message handlers
+    static int create_handler(const char *path, const char *types, lo_arg **argv,
+                              int argc, void *data, void *user_data);
+
+    // override these functions with a specific factory subclass
+    virtual bool create(const char *name, const char *type,
+                        float x, float y, float z) = 0;
+};
+
 class HingeFactory : public ShapeFactory
 {
 public:
@@ -396,4 +588,30 @@ protected:
                         double a2x, double a2y, double a2z) = 0;
 };
 
+/*! Queries for the objects in a region of the world, at
+ *  /world/query.  Each query is answered with a single message. */
+class SpatialQuery : public OscBase
+{
+public:
+    SpatialQuery(Simulation *parent);
+    virtual ~SpatialQuery();
+
+    virtual Simulation* simulation() { return static_cast<Simulation*>(m_parent); }
+
+protected:
+    // message handlers
+    static int raycast_handler(const char *path, const char *types, lo_arg **argv,
+                               int argc, void *data, void *user_data);
+    static int sphere_handler(const char *path, const char *types, lo_arg **argv,
+                              int argc, void *data, void *user_data);
+    static int nearest_handler(const char *path, const char *types, lo_arg **argv,
+                               int argc, void *data, void *user_data);
+
+    // override these functions with a specific query subclass
+    virtual void raycast(float x, float y, float z,
+                         float dx, float dy, float dz, float length) = 0;
+    virtual void sphere(float x, float y, float z, float radius) = 0;
+    virtual void nearest(float x, float y, float z, int count) = 0;
+};
+
 #endif // _SIMULATION_H_
@@ -0,0 +1,221 @@
+// -*- mode:c++; indent-tabs-mode:nil; c-basic-offset:4; -*-
+//======================================================================================
+/*
+    This file is part of DIMPLE, the Dynamic Interactive Musically PhysicaL Environment,
+
+    This code is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License("GPL") version 2
+    as published by the Free Software Foundation.  See the file LICENSE
+    for more information.
+
+    sinclair@music.mcgill.ca
+    http://www.music.mcgill.ca/~sinclair/content/dimple
+*/
+//======================================================================================
+
+#ifndef _SPATIAL_HASH_H_
+#define _SPATIAL_HASH_H_
+
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <cmath>
+#include <stdint.h>
+
+/*! Class for finding items whose bounding boxes overlap a region,
+ *  without looking at items far from it.  Each item is stored in
+ *  every cell of a uniform grid that its box touches.  Cells are
+ *  hashed into a fixed number of buckets, so the grid is unbounded,
+ *  and moving an item only touches the cells it leaves and enters.
+ *
+ *  Memory is only allocated when an item is inserted, or when a
+ *  bucket holds more entries than it ever has before, so that moving
+ *  and finding items can be done in a real-time loop.
+ *
+ *  Items covering more than a maximum number of cells, such as
+ *  planes, are kept in a separate list and always returned. */
+
+template <class T>
+class SpatialHash
+{
+  public:
+    SpatialHash(double cellSize, int maxCells=512, int buckets=4096)
+        : m_cellSize(cellSize), m_maxCells(maxCells), m_buckets(buckets)
+    {
+        for (int i=0; i < buckets; i++)
+            m_buckets[i].reserve(4);
+    }
+
+    //! Add an item without bounds, to be given by update().
+    void insert(T item)
+    {
+        Range r;
+        r.lo[0] = r.lo[1] = r.lo[2] = 0;
+        r.hi[0] = r.hi[1] = r.hi[2] = -1;
+        r.large = false;
+        m_items.insert(std::make_pair(item, r));
+        m_large.reserve(m_items.size());
+    }
+
+    //! Move an item to a new bounding box, adding it if needed.
+    void update(T item, const double lo[3], const double hi[3])
+    {
+        Range r;
+        range(lo, hi, r);
+
+        typename std::map<T, Range>::iterator it = m_items.find(item);
+        if (it == m_items.end()) {
+            insert(item);
+            it = m_items.find(item);
+        }
+        else if (it->second == r)
+            return;
+
+        unlink(item, it->second);
+        it->second = r;
+        link(item, r);
+    }
+
+    void remove(T item)
+    {
+        typename std::map<T, Range>::iterator it = m_items.find(item);
+        if (it == m_items.end())
+            return;
+        unlink(item, it->second);
+        m_items.erase(it);
+    }
+
+    int size() { return m_items.size(); }
+
+    /*! Call f(item) for the items whose boxes may overlap the given
+     *  box.  Items spanning several cells may be given more than
+     *  once. */
+    template <class F>
+    void query(const double lo[3], const double hi[3], F &f)
+    {
+        Range r;
+        range(lo, hi, r);
+        if (r.large) {
+            all(f);
+            return;
+        }
+
+        for (unsigned int i=0; i < m_large.size(); i++)
+            f(m_large[i]);
+
+        for (int x=r.lo[0]; x<=r.hi[0]; x++)
+            for (int y=r.lo[1]; y<=r.hi[1]; y++)
+                for (int z=r.lo[2]; z<=r.hi[2]; z++) {
+                    uint64_t k = key(x,y,z);
+                    const Bucket &b = bucket(k);
+                    for (unsigned int i=0; i < b.size(); i++)
+                        if (b[i].key == k)
+                            f(b[i].item);
+                }
+    }
+
+    //! Call f(item) for every item.
+    template <class F>
+    void all(F &f)
+    {
+        typename std::map<T, Range>::iterator it;
+        for (it=m_items.begin(); it!=m_items.end(); it++)
+            f(it->first);
+    }
+
+  protected:
+    struct Range
+    {
+        int lo[3], hi[3];
+        bool large;
+        bool operator==(const Range &o) const {
+            if (large || o.large) return large == o.large;
+            for (int k=0; k<3; k++)
+                if (lo[k] != o.lo[k] || hi[k] != o.hi[k])
+                    return false;
+            return true;
+        }
+    };
+
+    //! An item in one cell.
+    struct Entry
+    {
+        uint64_t key;
+        T item;
+    };
+    typedef std::vector<Entry> Bucket;
+
+    double m_cellSize;
+    int m_maxCells;
+    std::map<T, Range> m_items;
+    std::vector<Bucket> m_buckets;
+    std::vector<T> m_large;
+
+    static uint64_t key(int x, int y, int z)
+    {
+        return ((uint64_t)(x & 0x1fffff) << 42)
+             | ((uint64_t)(y & 0x1fffff) << 21)
+             |  (uint64_t)(z & 0x1fffff);
+    }
+
+    Bucket &bucket(uint64_t k)
+    {
+        // Mix the coordinates so that neighbouring cells fall in
+        // different buckets.
+        k *= 0x9e3779b97f4a7c15ULL;
+        return m_buckets[(k >> 32) % m_buckets.size()];
+    }
+
+    void range(const double lo[3], const double hi[3], Range &r)
+    {
+        double cells = 1;
+        for (int k=0; k<3; k++) {
+            double a = floor(lo[k] / m_cellSize);
+            double b = floor(hi[k] / m_cellSize);
+            cells *= b - a + 1;
+            r.lo[k] = (int)std::max(a, -1e6);
+            r.hi[k] = (int)std::min(b, 1e6);
+        }
+        r.large = !(cells <= m_maxCells);
+    }
+
+    void link(T item, const Range &r)
+    {
+        if (r.large) {
+            m_large.push_back(item);
+            return;
+        }
+        for (int x=r.lo[0]; x<=r.hi[0]; x++)
+            for (int y=r.lo[1]; y<=r.hi[1]; y++)
+                for (int z=r.lo[2]; z<=r.hi[2]; z++) {
+                    Entry e;
+                    e.key = key(x,y,z);
+                    e.item = item;
+                    bucket(e.key).push_back(e);
+                }
+    }
+
+    void unlink(T item, const Range &r)
+    {
+        if (r.large) {
+            m_large.erase(std::find(m_large.begin(), m_large.end(), item));
+            return;
+        }
+        for (int x=r.lo[0]; x<=r.hi[0]; x++)
+            for (int y=r.lo[1]; y<=r.hi[1]; y++)
+                for (int z=r.lo[2]; z<=r.hi[2]; z++) {
+                    uint64_t k = key(x,y,z);
+                    Bucket &b = bucket(k);
+                    // Order within a bucket does not matter, and
+                    // the bucket keeps its capacity.
+                    for (unsigned int i=0; i < b.size(); i++)
+                        if (b[i].key == k && b[i].item == item) {
+                            b[i] = b.back();
+                            b.pop_back();
+                            break;
+                        }
+                }
+    }
+};
+
+#endif // _SPATIAL_HASH_H_
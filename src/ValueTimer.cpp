@@ -43,7 +43,7 @@ void ValueTimer::removeValue(OscValue* oscval)
     }
 }
     
-void ValueTimer::onTimer(int interval_ms)
+void ValueTimer::onTimer(double interval_ms)
 {
     value_iter it;
     for (it=m_values.begin(); it!=m_values.end(); it++)
@@ -53,6 +53,7 @@ void ValueTimer::onTimer(int interval_ms)
         v->current_ms -= interval_ms;
         if (v->current_ms <= 0) {
             v->current_ms = v->interval_ms;
+            it->first->refresh();
             it->first->send();
         }
     }
@@ -22,7 +22,7 @@ class OscValue;
 
 struct ValueTimerPair
 {
-    int current_ms;
+    double current_ms;
     int interval_ms;
 };
 
@@ -35,7 +35,7 @@ class ValueTimer
     void addValue(OscValue* oscval, int interval_ms);
     void removeValue(OscValue* oscval);
 
-    void onTimer(int interval_ms);
+    void onTimer(double interval_ms);
 
   protected:
     std::map<OscValue*, struct ValueTimerPair*> m_values;
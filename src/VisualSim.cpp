@@ -9,6 +9,7 @@
 #include <graphics/CFont.h>
 #include <resources/CFontCalibri20.h>
 #include <math/CQuaternion.h>
+#include <graphics/CDraw3D.h>
 
 #include <GL/glut.h>
 #ifdef USE_FREEGLUT
@@ -69,6 +70,75 @@ bool VisualMeshFactory::create(const char *name, const char *filename,
     return true;
 }
 
+bool VisualParticlesFactory::create(const char *name, int count,
+                                    float x, float y, float z)
+{
+    OscParticlesCHAI *obj = new OscParticlesCHAI(simulation()->world(),
+                                                 name, count, m_parent);
+
+    if (!(obj && simulation()->add_object(*obj)))
+            return false;
+
+    // Positions of the particles come from the physics simulation.
+    obj->m_position.setValue(x, y, z, false);
+
+    return true;
+}
+
+bool VisualPlaneFactory::create(const char *name, float x, float y, float z)
+{
+    OscPlaneCHAI *obj = new OscPlaneCHAI(simulation()->world(),
+                                         name, m_parent);
+
+    if (!(obj && simulation()->add_object(*obj)))
+            return false;
+
+    obj->m_position.setValue(x, y, z);
+
+    return true;
+}
+
+bool VisualCapsuleFactory::create(const char *name, float x, float y, float z)
+{
+    OscCapsuleCHAI *obj = new OscCapsuleCHAI(simulation()->world(),
+                                             name, m_parent);
+
+    if (!(obj && simulation()->add_object(*obj)))
+            return false;
+
+    obj->m_position.setValue(x, y, z);
+
+    return true;
+}
+
+bool VisualCylinderFactory::create(const char *name, float x, float y, float z)
+{
+    OscCylinderCHAI *obj = new OscCylinderCHAI(simulation()->world(),
+                                               name, m_parent);
+
+    if (!(obj && simulation()->add_object(*obj)))
+            return false;
+
+    obj->m_position.setValue(x, y, z);
+
+    return true;
+}
+
+bool VisualHeightfieldFactory::create(const char *name, int columns, int rows,
+                                      float x, float y, float z)
+{
+    OscHeightfieldCHAI *obj = new OscHeightfieldCHAI(simulation()->world(),
+                                                     name, columns, rows,
+                                                     m_parent);
+
+    if (!(obj && simulation()->add_object(*obj)))
+            return false;
+
+    obj->m_position.setValue(x, y, z);
+
+    return true;
+}
+
 int VisualVirtdevFactory::create_handler(const char *path, const char *types, lo_arg **argv,
                                          int argc, void *data, void *user_data)
 {
@@ -170,6 +240,11 @@ VisualSim::VisualSim(const char *port)
     m_pPrismFactory = new VisualPrismFactory(this);
     m_pSphereFactory = new VisualSphereFactory(this);
     m_pMeshFactory = new VisualMeshFactory(this);
+    m_pParticlesFactory = new VisualParticlesFactory(this);
+    m_pPlaneFactory = new VisualPlaneFactory(this);
+    m_pCapsuleFactory = new VisualCapsuleFactory(this);
+    m_pCylinderFactory = new VisualCylinderFactory(this);
+    m_pHeightfieldFactory = new VisualHeightfieldFactory(this);
     m_pVirtdevFactory = new VisualVirtdevFactory(this);
 
     m_fTimestep = visual_timestep_ms/1000.0;
@@ -222,7 +297,7 @@ void VisualSim::initGlutWindow()
     glutAttachMenu(GLUT_RIGHT_BUTTON);
     */
 
-    glutTimerFunc(visual_timestep_ms, updateDisplay, 0);
+    glutTimerFunc((unsigned int)visual_timestep_ms, updateDisplay, 0);
 }
 
 void VisualSim::updateDisplay(int data)
@@ -239,15 +314,17 @@ void VisualSim::updateDisplay(int data)
     }
 #endif
 
-    int step_ms = (int)(me->m_fTimestep*1000);
-    me->m_valueTimer.onTimer(step_ms);
+    me->collect_deleted();
+    me->m_loader.finish();
+
+    me->m_valueTimer.onTimer(me->m_fTimestep*1000);
 
     if (me->m_bDone) {}  // TODO
 
     glutPostRedisplay();
 
     // update again in a few ms
-    glutTimerFunc(visual_timestep_ms, updateDisplay, 0);
+    glutTimerFunc((unsigned int)visual_timestep_ms, updateDisplay, 0);
 }
 
 void VisualSim::initialize()
@@ -333,6 +410,10 @@ void VisualSim::draw()
         syncPoses();
     */
 
+    // meshes may be scaled by their transform, so normals must be
+    // renormalized for lighting
+    glEnable(GL_NORMALIZE);
+
     // render world
     me->m_chaiWorld->updateShadowMaps(false, false);
     me->m_camera->object()->renderView(me->m_nWidth, me->m_nHeight);
@@ -707,3 +788,78 @@ OscCameraCHAI::~OscCameraCHAI()
     if (m_pCamera)
         m_pCamera->getParent()->deleteChild(m_pCamera);
 }
+
+/****** OscParticlesCHAI ******/
+
+cParticleCloud::cParticleCloud(int count, double radius)
+    : m_positions(count*3, 0), m_radius(radius),
+      m_displayList(0), m_bUpdateList(true)
+{
+}
+
+cParticleCloud::~cParticleCloud()
+{
+    if (m_displayList)
+        glDeleteLists(m_displayList, 1);
+}
+
+void cParticleCloud::render(cRenderOptions& a_options)
+{
+#ifdef C_USE_OPENGL
+    if (!SECTION_RENDER_OPAQUE_PARTS_ONLY(a_options))
+        return;
+
+    if (m_bUpdateList) {
+        if (!m_displayList)
+            m_displayList = glGenLists(1);
+        glNewList(m_displayList, GL_COMPILE);
+        cDrawSphere(m_radius, 8, 8);
+        glEndList();
+        m_bUpdateList = false;
+    }
+
+    m_material->render(a_options);
+
+    int count = m_positions.size() / 3;
+    const float *pos = &m_positions[0];
+    for (int i=0; i<count; i++) {
+        glPushMatrix();
+        glTranslatef(pos[i*3+0], pos[i*3+1], pos[i*3+2]);
+        glCallList(m_displayList);
+        glPopMatrix();
+    }
+#endif
+}
+
+OscParticlesCHAI::OscParticlesCHAI(cWorld *world, const char *name, int count,
+                                   OscBase *parent)
+    : OscParticles(NULL, name, count, parent)
+{
+    m_pCloud = new cParticleCloud(count, m_radius.m_value);
+    world->addChild(m_pCloud);
+
+    addHandler("positions", "ib", OscParticlesCHAI::positions_handler);
+}
+
+OscParticlesCHAI::~OscParticlesCHAI()
+{
+    if (m_pCloud)
+        m_pCloud->getParent()->deleteChild(m_pCloud);
+}
+
+int OscParticlesCHAI::positions_handler(const char *path, const char *types,
+                                        lo_arg **argv, int argc, void *data,
+                                        void *user_data)
+{
+    OscParticlesCHAI *me = static_cast<OscParticlesCHAI*>(user_data);
+
+    // Copy a chunk of positions starting at the given particle.
+    int first = argv[0]->i;
+    int n = lo_blob_datasize((lo_blob)argv[1]) / (3*sizeof(float));
+    if (first < 0 || first + n > me->m_count)
+        return 0;
+
+    memcpy(&me->m_pCloud->m_positions[first*3],
+           lo_blob_dataptr((lo_blob)argv[1]), n*3*sizeof(float));
+    return 0;
+}
@@ -10,6 +10,7 @@
 #include <display/CCamera.h>
 #include <lighting/CSpotLight.h>
 #include <widgets/CLabel.h>
+#include <graphics/CRenderOptions.h>
 
 class OscCameraCHAI;
 class VisualVirtdevFactory;
@@ -106,6 +107,67 @@ protected:
                 float x, float y, float z);
 };
 
+class VisualParticlesFactory : public ParticlesFactory
+{
+public:
+    VisualParticlesFactory(Simulation *parent) : ParticlesFactory(parent) {}
+    virtual ~VisualParticlesFactory() {}
+
+    virtual VisualSim* simulation() { return static_cast<VisualSim*>(m_parent); }
+
+protected:
+    bool create(const char *name, int count, float x, float y, float z);
+};
+
+class VisualPlaneFactory : public PlaneFactory
+{
+public:
+    VisualPlaneFactory(Simulation *parent) : PlaneFactory(parent) {}
+    virtual ~VisualPlaneFactory() {}
+
+    virtual VisualSim* simulation() { return static_cast<VisualSim*>(m_parent); }
+
+protected:
+    bool create(const char *name, float x, float y, float z);
+};
+
+class VisualCapsuleFactory : public CapsuleFactory
+{
+public:
+    VisualCapsuleFactory(Simulation *parent) : CapsuleFactory(parent) {}
+    virtual ~VisualCapsuleFactory() {}
+
+    virtual VisualSim* simulation() { return static_cast<VisualSim*>(m_parent); }
+
+protected:
+    bool create(const char *name, float x, float y, float z);
+};
+
+class VisualCylinderFactory : public CylinderFactory
+{
+public:
+    VisualCylinderFactory(Simulation *parent) : CylinderFactory(parent) {}
+    virtual ~VisualCylinderFactory() {}
+
+    virtual VisualSim* simulation() { return static_cast<VisualSim*>(m_parent); }
+
+protected:
+    bool create(const char *name, float x, float y, float z);
+};
+
+class VisualHeightfieldFactory : public HeightfieldFactory
+{
+public:
+    VisualHeightfieldFactory(Simulation *parent) : HeightfieldFactory(parent) {}
+    virtual ~VisualHeightfieldFactory() {}
+
+    virtual VisualSim* simulation() { return static_cast<VisualSim*>(m_parent); }
+
+protected:
+    bool create(const char *name, int columns, int rows,
+                float x, float y, float z);
+};
+
 class VisualVirtdevFactory : public ShapeFactory
 {
 public:
@@ -159,4 +221,50 @@ protected:
     cGenericObject *m_pHandleXZ;     //! virtual device handle for XZ plane
 };
 
+/*! A CHAI object drawing many identical spheres.  Positions are in
+ *  world coordinates, 3 floats per sphere.  The sphere geometry is
+ *  compiled once into a display list and drawn at each position. */
+class cParticleCloud : public cGenericObject
+{
+public:
+    cParticleCloud(int count, double radius);
+    virtual ~cParticleCloud();
+
+    std::vector<float> m_positions;
+
+    void setRadius(double radius)
+        { m_radius = radius; m_bUpdateList = true; }
+
+protected:
+    virtual void render(cRenderOptions& a_options);
+
+    double m_radius;
+    GLuint m_displayList;
+    bool m_bUpdateList;
+};
+
+class OscParticlesCHAI : public OscParticles
+{
+public:
+    OscParticlesCHAI(cWorld *world, const char *name, int count,
+                     OscBase *parent=NULL);
+    virtual ~OscParticlesCHAI();
+
+    cParticleCloud *object() { return m_pCloud; }
+
+protected:
+    virtual void on_radius()
+        { m_pCloud->setRadius(m_radius.m_value); }
+    virtual void on_color()
+        { object()->m_material->m_diffuse.set(m_color.x(), m_color.y(), m_color.z()); }
+    virtual void on_visible()
+        { object()->setShowEnabled(m_visible.m_value, true); }
+
+    static int positions_handler(const char *path, const char *types,
+                                 lo_arg **argv, int argc, void *data,
+                                 void *user_data);
+
+    cParticleCloud *m_pCloud;
+};
+
 #endif // _VISUAL_SIM_H_
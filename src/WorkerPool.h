@@ -0,0 +1,146 @@
+// -*- mode:c++; indent-tabs-mode:nil; c-basic-offset:4; -*-
+//======================================================================================
+/*
+    This file is part of DIMPLE, the Dynamic Interactive Musically PhysicaL Environment,
+
+    This code is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License("GPL") version 2
+    as published by the Free Software Foundation.  See the file LICENSE
+    for more information.
+
+    sinclair@music.mcgill.ca
+    http://www.music.mcgill.ca/~sinclair/content/dimple
+*/
+//======================================================================================
+
+#ifndef _WORKER_POOL_H_
+#define _WORKER_POOL_H_
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+
+/*! Class for running a batch of numbered tasks across a fixed set of
+ *  worker threads.  The thread calling run() also works on the batch
+ *  and returns once every task has completed, so a pool of N threads
+ *  starts N-1 workers.  Tasks are handed out in order but may finish
+ *  in any order; callers needing deterministic results should write
+ *  each task's output to its own buffer. */
+
+class WorkerPool
+{
+  public:
+    typedef void TaskFunction(void *data, int task);
+    typedef void ThreadFunction();
+
+    /*! Start the worker threads.  The optional start and finish
+     *  functions are called in each worker thread when it begins and
+     *  before it exits, for setting up per-thread library state. */
+    WorkerPool(int threads, ThreadFunction *start=NULL,
+               ThreadFunction *finish=NULL)
+        : m_start(start), m_finish(finish), m_func(NULL), m_data(NULL),
+          m_tasks(0), m_nextTask(0), m_pending(0), m_generation(0),
+          m_bDone(false)
+    {
+        for (int i=1; i < threads; i++)
+            m_threads.push_back(std::thread(worker, this));
+    }
+
+    ~WorkerPool()
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_bDone = true;
+        }
+        m_startCond.notify_all();
+
+        std::vector<std::thread>::iterator it;
+        for (it=m_threads.begin(); it!=m_threads.end(); it++)
+            it->join();
+    }
+
+    //! Return the number of threads, including the calling thread.
+    int threads() { return m_threads.size()+1; }
+
+    /*! Call func(data, task) for each task in [0, tasks) and wait for
+     *  all of them to complete. */
+    void run(TaskFunction *func, void *data, int tasks)
+    {
+        if (tasks <= 0)
+            return;
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_func = func;
+        m_data = data;
+        m_tasks = tasks;
+        m_nextTask = 0;
+        m_pending = tasks;
+        m_generation++;
+        m_startCond.notify_all();
+
+        while (runTask(lock)) {}
+
+        while (m_pending > 0)
+            m_doneCond.wait(lock);
+    }
+
+  protected:
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    std::condition_variable m_startCond;
+    std::condition_variable m_doneCond;
+
+    ThreadFunction *m_start;
+    ThreadFunction *m_finish;
+
+    TaskFunction *m_func;
+    void *m_data;
+    int m_tasks;
+    int m_nextTask;
+    int m_pending;
+    unsigned int m_generation;
+    bool m_bDone;
+
+    /*! Take the next task of the current batch and run it with the
+     *  lock released.  Return false if no tasks remain. */
+    bool runTask(std::unique_lock<std::mutex> &lock)
+    {
+        if (m_nextTask >= m_tasks)
+            return false;
+
+        int task = m_nextTask++;
+        lock.unlock();
+        m_func(m_data, task);
+        lock.lock();
+
+        if (--m_pending == 0)
+            m_doneCond.notify_all();
+        return true;
+    }
+
+    static void worker(WorkerPool *me)
+    {
+        if (me->m_start)
+            me->m_start();
+
+        unsigned int generation = 0;
+        std::unique_lock<std::mutex> lock(me->m_mutex);
+        while (true)
+        {
+            while (!me->m_bDone && generation == me->m_generation)
+                me->m_startCond.wait(lock);
+            if (me->m_bDone)
+                break;
+
+            generation = me->m_generation;
+            while (me->runTask(lock)) {}
+        }
+        lock.unlock();
+
+        if (me->m_finish)
+            me->m_finish();
+    }
+};
+
+#endif // _WORKER_POOL_H_
@@ -30,9 +30,9 @@
 
 /** Defaults for global variables **/
 int visual_fps = 30;
-int visual_timestep_ms = (int)((1.0/visual_fps)*1000.0);
-int physics_timestep_ms = 10;
-int haptics_timestep_ms = 1;
+double visual_timestep_ms = (1.0/visual_fps)*1000.0;
+double physics_timestep_ms = 10;
+double haptics_timestep_ms = 1;
 int msg_queue_size = DEFAULT_QUEUE_SIZE*1024;
 bool force_enabled = true;
 const char *interface_port_str = "7774";
@@ -41,6 +41,11 @@ static struct {
     const char *visual, *haptics, *physics;
 } sim_spec = { "", "", "" };
 
+static struct {
+    ThreadOptions visual, haptics, physics, interface;
+} thread_spec;
+bool memory_locked = false;
+
 const char *address_send_url = "osc.udp://localhost:%u";
 
 lo_address address_send;
@@ -67,7 +72,61 @@ void help()
            "             to 7774.  Ports for physics, haptics and visual\n"
            "             simulations are consecutive following this number,\n"
            "             respectively.\n\n");
-    printf("--noforce (-n)  Disable force output to haptic device.\n");
+    printf("--noforce (-n)  Disable force output to haptic device.\n\n");
+    printf("--timestep (-t)  Set the timestep of simulations in\n"
+           "                 milliseconds, given as letters as for --sim,\n"
+           "                 then '=' and the timestep, which may be\n"
+           "                 fractional.  Defaults to p=10 and h=1.\n"
+           "                 Example: -t h=0.25 for haptics at 4 kHz\n\n");
+    printf("--priority (-r)  Run simulations at a real-time priority,\n"
+           "                 given as letters as for --sim, `i' for\n"
+           "                 interface, then '=' and the priority,\n"
+           "                 optionally followed by \":rr\" for round-robin\n"
+           "                 rather than FIFO scheduling.\n"
+           "                 Example: -r h=80 -r p=70:rr\n\n");
+    printf("--spin (-w)  Busy-wait for the last part of each step, in\n"
+           "             microseconds, rather than sleeping, for less\n"
+           "             jitter at the cost of a busy CPU.  Given as\n"
+           "             letters as for --priority, then '=' and the\n"
+           "             time.  Example: -w h=100\n\n");
+    printf("--cpus (-a)  Restrict simulations to a list of CPUs, given\n"
+           "             as letters as for --priority, then '=' and\n"
+           "             the list.  Example: -a h=3 -a vpi=0-2\n\n");
+    printf("--lock-memory (-m)  Lock all memory into RAM so that the\n"
+           "                    simulations are never paged out.\n");
+}
+
+/* Parse "<sims>=<value>", setting the bits of sims for each
+ * simulation named, and return the value. */
+const char *parse_sim_value(const char *arg, const char *opt, int &sims)
+{
+    const char *s = arg;
+    sims = 0;
+    while (*s != 0 && *s != '=' && sims >= 0) {
+        switch (*s++) {
+        case 'v': sims |= Simulation::ST_VISUAL; break;
+        case 'h': sims |= Simulation::ST_HAPTICS; break;
+        case 'p': sims |= Simulation::ST_PHYSICS; break;
+        case 'i': sims |= Simulation::ST_INTERFACE; break;
+        default: sims = -1; break;
+        }
+    }
+    if (sims <= 0 || *s != '=' || s[1] == 0) {
+        printf("Error parsing --%s option, "
+               "expected <sims>=<value>.\n", opt);
+        exit(1);
+    }
+    return s+1;
+}
+
+//! Return the thread options of each simulation in sims, followed by 0.
+void thread_options(int sims, ThreadOptions **options)
+{
+    if (sims & Simulation::ST_VISUAL) *options++ = &thread_spec.visual;
+    if (sims & Simulation::ST_HAPTICS) *options++ = &thread_spec.haptics;
+    if (sims & Simulation::ST_PHYSICS) *options++ = &thread_spec.physics;
+    if (sims & Simulation::ST_INTERFACE) *options++ = &thread_spec.interface;
+    *options = 0;
 }
 
 void parse_command_line(int argc, char* argv[])
@@ -83,13 +142,18 @@ void parse_command_line(int argc, char* argv[])
         { "port",       required_argument, 0, 'p' },
         { "connect",    required_argument, 0, 'c' },
         { "noforce",    no_argument,       0, 'n' },
+        { "timestep",   required_argument, 0, 't' },
+        { "priority",   required_argument, 0, 'r' },
+        { "spin",       required_argument, 0, 'w' },
+        { "cpus",       required_argument, 0, 'a' },
+        { "lock-memory", no_argument,      0, 'm' },
         {0, 0, 0, 0}
     };
 
     while (c!=-1) {
         int option_index = 0;
 
-        c = getopt_long (argc, argv, "hu:q:s:p:c:n",
+        c = getopt_long (argc, argv, "hu:q:s:p:c:nt:r:w:a:m",
                          long_options, &option_index);
 
         switch (c) {
@@ -132,6 +196,63 @@ void parse_command_line(int argc, char* argv[])
         case 'n':
             force_enabled = false;
             break;
+        case 't': {
+            int sims;
+            const char *v = parse_sim_value(optarg, "timestep", sims);
+            double step = atof(v);
+            if (step <= 0 || (sims & Simulation::ST_INTERFACE)) {
+                printf("Error parsing --timestep option, "
+                       "must be a number of milliseconds > 0 for "
+                       "`v', `p' or `h'.\n");
+                exit(1);
+            }
+            if (sims & Simulation::ST_VISUAL) visual_timestep_ms = step;
+            if (sims & Simulation::ST_PHYSICS) physics_timestep_ms = step;
+            if (sims & Simulation::ST_HAPTICS) haptics_timestep_ms = step;
+            break;
+        }
+        case 'r': {
+            int sims;
+            ThreadOptions *options[5];
+            const char *v = parse_sim_value(optarg, "priority", sims);
+            int priority = atoi(v);
+            const char *policy = strchr(v, ':');
+            if (priority <= 0
+                || (policy && strcmp(policy, ":rr") && strcmp(policy, ":fifo")))
+            {
+                printf("Error parsing --priority option, "
+                       "must be an integer > 0, optionally followed "
+                       "by \":rr\".\n");
+                exit(1);
+            }
+            thread_options(sims, options);
+            for (int i=0; options[i]; i++) {
+                options[i]->priority = priority;
+                options[i]->policy = policy ? policy+1 : "fifo";
+            }
+            break;
+        }
+        case 'w': {
+            int sims;
+            ThreadOptions *options[5];
+            const char *v = parse_sim_value(optarg, "spin", sims);
+            thread_options(sims, options);
+            for (int i=0; options[i]; i++)
+                options[i]->spin_us = atoi(v);
+            break;
+        }
+        case 'a': {
+            int sims;
+            ThreadOptions *options[5];
+            const char *v = parse_sim_value(optarg, "cpus", sims);
+            thread_options(sims, options);
+            for (int i=0; options[i]; i++)
+                options[i]->cpus = v;
+            break;
+        }
+        case 'm':
+            memory_locked = true;
+            break;
         case 'h':
             help();
             exit(0);
@@ -188,6 +309,11 @@ int main(int argc, char* argv[])
      parse_command_line(argc, argv);
 #endif
 
+     // Done before any simulation starts so that their threads'
+     // stacks are locked as well.
+     if (memory_locked)
+         Simulation::lock_memory();
+
      unsigned int interface_port = atoi(interface_port_str);
 
      char address_send_url_fmt[256];
@@ -251,6 +377,11 @@ int main(int argc, char* argv[])
      interface.add_receiver( haptics, sim_spec.haptics, Simulation::ST_HAPTICS, true );
      interface.add_receiver( visual,  sim_spec.visual,  Simulation::ST_VISUAL,  true );
 
+     interface.m_threadOptions = thread_spec.interface;
+     if (physics) physics->m_threadOptions = thread_spec.physics;
+     if (haptics) haptics->m_threadOptions = thread_spec.haptics;
+     if (visual) visual->m_threadOptions = thread_spec.visual;
+
      // Start all simulations
      bool rc = true;
      if (physics) rc &= physics->start();
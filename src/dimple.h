@@ -34,9 +34,9 @@
 /** Global options **/
 
 extern int visual_fps;
-extern int visual_timestep_ms;
-extern int physics_timestep_ms;
-extern int haptics_timestep_ms;
+extern double visual_timestep_ms;
+extern double physics_timestep_ms;
+extern double haptics_timestep_ms;
 extern int msg_queue_size;
 
 /** Miscellaneous macros **/
@@ -0,0 +1,146 @@
+// -*- mode:c++; indent-tabs-mode:nil; c-basic-offset:4; -*-
+//======================================================================================
+/*
+    This file is part of DIMPLE, the Dynamic Interactive Musically PhysicaL Environment,
+
+    This code is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License("GPL") version 2
+    as published by the Free Software Foundation.  See the file LICENSE
+    for more information.
+
+    sinclair@music.mcgill.ca
+    http://www.music.mcgill.ca/~sinclair/content/dimple
+*/
+//======================================================================================
+
+/* Writes the binary cache of every mesh file found in the given files
+ * and directories, so that DIMPLE loads them without parsing. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <string>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "MeshCache.h"
+
+static int compiled = 0, current = 0, skipped = 0, failed = 0;
+static bool force = false;
+
+static bool is_mesh(const std::string &path)
+{
+    const char *ext[] = { ".3ds", ".obj", ".stl", NULL };
+    for (int i=0; ext[i]; i++) {
+        size_t n = strlen(ext[i]);
+        if (path.size() < n)
+            continue;
+        const char *s = path.c_str() + path.size() - n;
+        int k=0;
+        while (ext[i][k] && tolower(s[k]) == ext[i][k])
+            k++;
+        if (!ext[i][k])
+            return true;
+    }
+    return false;
+}
+
+static void precompile(const std::string &path)
+{
+    if (!force) {
+        cMultiMesh cached;
+        if (MeshCache::load(path, &cached)) {
+            current++;
+            return;
+        }
+    }
+
+    cMultiMesh mesh;
+    if (!mesh.loadFromFile(path)) {
+        printf("Unable to load %s\n", path.c_str());
+        failed++;
+        return;
+    }
+
+    // Meshes with textures or vertex colors are always parsed.
+    if (!MeshCache::cacheable(&mesh)) {
+        printf("Skipping %s, which cannot be cached\n", path.c_str());
+        skipped++;
+        return;
+    }
+
+    if (!MeshCache::save(path, &mesh)) {
+        printf("Unable to write %s\n", MeshCache::path(path).c_str());
+        failed++;
+        return;
+    }
+
+    printf("%s\n", MeshCache::path(path).c_str());
+    compiled++;
+}
+
+static void scan(const std::string &path)
+{
+    struct stat st;
+    if (stat(path.c_str(), &st)) {
+        printf("Unable to read %s\n", path.c_str());
+        failed++;
+        return;
+    }
+
+    if (!S_ISDIR(st.st_mode)) {
+        if (is_mesh(path))
+            precompile(path);
+        return;
+    }
+
+    DIR *dir = opendir(path.c_str());
+    if (!dir) {
+        printf("Unable to read %s\n", path.c_str());
+        failed++;
+        return;
+    }
+
+    struct dirent *e;
+    while ((e = readdir(dir)))
+        if (strcmp(e->d_name, ".") && strcmp(e->d_name, ".."))
+            scan(path + "/" + e->d_name);
+    closedir(dir);
+}
+
+void help()
+{
+    printf("Usage: dimple-precompile [options] <file or directory>...\n\n"
+           "Writes a binary cache beside each .3ds, .obj and .stl file\n"
+           "found, so that DIMPLE loads it without parsing.  Directories\n"
+           "are searched recursively.  Files with an up-to-date cache\n"
+           "and files with textures or vertex colors are skipped.\n\n");
+    printf("--force (-f)  Write the cache of every file, even if it is\n"
+           "              up to date.\n");
+}
+
+int main(int argc, char* argv[])
+{
+    int first = 1;
+    for (; first < argc && argv[first][0] == '-'; first++) {
+        if (strcmp(argv[first], "-f")==0 || strcmp(argv[first], "--force")==0)
+            force = true;
+        else {
+            help();
+            return strcmp(argv[first], "-h") && strcmp(argv[first], "--help");
+        }
+    }
+
+    if (first >= argc) {
+        help();
+        return 1;
+    }
+
+    for (int i=first; i < argc; i++)
+        scan(argv[i]);
+
+    printf("%d compiled, %d up to date, %d skipped, %d failed.\n",
+           compiled, current, skipped, failed);
+    return failed ? 1 : 0;
+}
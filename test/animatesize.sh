@@ -0,0 +1,32 @@
+#!/bin/sh
+
+# This test file relies on the programs 'oscdump' and 'oscsend' which
+# are available as part of the LibLo distribution.  Currently they are
+# present in the LibLo svn repository, but not yet part of a stable
+# release.
+
+# This script assumes Dimple is already running.
+
+# Disable path mangling in MSYS2
+export MSYS2_ARG_CONV_EXCL="/world"
+
+# Listen on port 7778.  We'll assume this is the only oscdump instance
+# running, and we don't want to run it if it's already running in
+# another terminal.
+if ! ((ps -A 2>/dev/null || ps -W 2>/dev/null || ps aux 2>/dev/null) | grep oscdump >/dev/null 2>&1 ); then (oscdump 7778 &); fi
+
+# Animate the size of a mesh and a prism.  The visual display should
+# follow smoothly, without reloading or rescaling the mesh.
+CYL=$(readlink -f $(dirname "$0")/cylinder.3ds)
+
+oscsend localhost 7774 /world/clear
+oscsend localhost 7774 /world/gravity fff 0 0 0
+oscsend localhost 7774 /world/mesh/create ssfff m $CYL -0.3 0 0
+oscsend localhost 7774 /world/prism/create sfff p 0.3 0 0
+
+sleep 1
+for i in 0 1 2 3 4 5 6 7 8 9 8 7 6 5 4 3 2 1 0; do
+    oscsend localhost 7774 /world/m/size fff 0.1 0.1 0.1$i
+    oscsend localhost 7774 /world/p/size fff 0.1 0.1 0.1$i
+    sleep 0.05
+done
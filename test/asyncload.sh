@@ -0,0 +1,37 @@
+#!/bin/sh
+
+# This test file relies on the programs 'oscdump' and 'oscsend' which
+# are available as part of the LibLo distribution.  Currently they are
+# present in the LibLo svn repository, but not yet part of a stable
+# release.
+
+# This script assumes Dimple is already running.
+
+# Disable path mangling in MSYS2
+export MSYS2_ARG_CONV_EXCL="/world"
+
+# Listen on port 7778.  We'll assume this is the only oscdump instance
+# running, and we don't want to run it if it's already running in
+# another terminal.
+if ! ((ps -A 2>/dev/null || ps -W 2>/dev/null || ps aux 2>/dev/null) | grep oscdump >/dev/null 2>&1 ); then (oscdump 7778 &); fi
+
+# Load several meshes and textures while touching a sphere.  The
+# haptic loop should not stall, and oscdump should show a
+# /world/<name>/loaded or /world/<name>/texture/image/loaded message
+# for each, including the failure of a missing file.
+CYL=$(readlink -f $(dirname "$0")/cylinder.3ds)
+MARBLE=$(readlink -f $(dirname "$0")/../textures/marble.png)
+
+oscsend localhost 7774 /world/clear
+oscsend localhost 7774 /world/sphere/create sfff s1 0 0 0
+oscsend localhost 7774 /world/s1/radius f 0.1
+oscsend localhost 7774 /world/fixed/create sss s1c s1 world
+
+for i in 1 2 3 4 5; do
+    oscsend localhost 7774 /world/mesh/create ssfff cyl$i $CYL -0.$i 0.3 0
+    oscsend localhost 7774 /world/cyl$i/size fff 0.1 0.1 0.1
+    oscsend localhost 7774 /world/cyl$i/texture/image s $MARBLE
+done
+
+oscsend localhost 7774 /world/s1/texture/image s $MARBLE
+oscsend localhost 7774 /world/mesh/create ssfff missing /nonexistent.3ds 0 -0.3 0
@@ -0,0 +1,39 @@
+#!/bin/sh
+
+# This test file relies on the programs 'oscdump' and 'oscsend' which
+# are available as part of the LibLo distribution.  Currently they are
+# present in the LibLo svn repository, but not yet part of a stable
+# release.
+
+# This script assumes Dimple is already running.
+
+# Disable path mangling in MSYS2
+export MSYS2_ARG_CONV_EXCL="/world"
+
+# Listen on port 7778.  We'll assume this is the only oscdump instance
+# running, and we don't want to run it if it's already running in
+# another terminal.
+if ! ((ps -A 2>/dev/null || ps -W 2>/dev/null || ps aux 2>/dev/null) | grep oscdump >/dev/null 2>&1 ); then (oscdump 7778 &); fi
+
+# A cloud of particles collapses under its own attraction while a
+# heavy sphere orbits through it, then the sphere is excluded.
+oscsend localhost 7774 /world/clear
+oscsend localhost 7774 /world/gravity fff 0 0 0
+oscsend localhost 7774 /world/particles/create sifff cloud 1000 0 0 0
+oscsend localhost 7774 /world/cloud/radius f 0.003
+
+oscsend localhost 7774 /world/sphere/create sfff sun 0.15 0 0
+oscsend localhost 7774 /world/sun/radius f 0.02
+oscsend localhost 7774 /world/sun/charge f 20
+oscsend localhost 7774 /world/sun/velocity fff 0 0.05 0
+
+oscsend localhost 7774 /world/attraction f 0.0005
+oscsend localhost 7774 /world/physics/step_time/get
+
+sleep 4
+oscsend localhost 7774 /world/attraction/theta f 1
+oscsend localhost 7774 /world/physics/step_time/get
+
+sleep 2
+oscsend localhost 7774 /world/sun/charge f 0
+oscsend localhost 7774 /world/attraction/get
@@ -0,0 +1,31 @@
+#!/bin/sh
+
+# This test file relies on the programs 'oscdump' and 'oscsend' which
+# are available as part of the LibLo distribution.  Currently they are
+# present in the LibLo svn repository, but not yet part of a stable
+# release.
+
+# This script assumes Dimple is already running.
+
+# Disable path mangling in MSYS2
+export MSYS2_ARG_CONV_EXCL="/world"
+
+# Listen on port 7778.  We'll assume this is the only oscdump instance
+# running, and we don't want to run it if it's already running in
+# another terminal.
+if ! ((ps -A 2>/dev/null || ps -W 2>/dev/null || ps aux 2>/dev/null) | grep oscdump >/dev/null 2>&1 ); then (oscdump 7778 &); fi
+
+# Fill the world with many spheres joined in pairs, then clear it.
+# The clear should be reported by each simulation at once.
+oscsend localhost 7774 /world/clear
+
+for i in $(seq 1 2500); do
+    oscsend localhost 7774 /world/sphere/create sfff a$i 0 0 0
+    oscsend localhost 7774 /world/sphere/create sfff b$i 0.01 0 0
+    oscsend localhost 7774 /world/ball/create sssfff j$i a$i b$i 0.005 0 0
+done
+
+oscsend localhost 7774 /world/clear
+
+# Names are free again immediately.
+oscsend localhost 7774 /world/sphere/create sfff a1 0 0 0
@@ -0,0 +1,44 @@
+#!/bin/sh
+
+# This test file relies on the programs 'oscdump' and 'oscsend' which
+# are available as part of the LibLo distribution.  Currently they are
+# present in the LibLo svn repository, but not yet part of a stable
+# release.
+
+# This script assumes Dimple is already running.
+
+# Disable path mangling in MSYS2
+export MSYS2_ARG_CONV_EXCL="/world"
+
+# Listen on port 7778.  We'll assume this is the only oscdump instance
+# running, and we don't want to run it if it's already running in
+# another terminal.
+if ! ((ps -A 2>/dev/null || ps -W 2>/dev/null || ps aux 2>/dev/null) | grep oscdump >/dev/null 2>&1 ); then (oscdump 7778 &); fi
+
+# A dumbbell made of two spheres and a bar falls onto a floor as one
+# body, then one end is released.
+oscsend localhost 7774 /world/clear
+oscsend localhost 7774 /world/plane/create sfff floor 0 0 -0.3
+
+oscsend localhost 7774 /world/sphere/create sfff a -0.08 0 0.1
+oscsend localhost 7774 /world/a/radius f 0.03
+oscsend localhost 7774 /world/a/color fff 0.9 0.2 0.2
+
+oscsend localhost 7774 /world/sphere/create sfff b 0.08 0 0.1
+oscsend localhost 7774 /world/b/radius f 0.02
+oscsend localhost 7774 /world/b/color fff 0.2 0.2 0.9
+
+oscsend localhost 7774 /world/prism/create sfff bar 0 0 0.1
+oscsend localhost 7774 /world/bar/size fff 0.16 0.01 0.01
+
+oscsend localhost 7774 /world/composite/create sfff dumbbell 0 0 0.1
+oscsend localhost 7774 /world/dumbbell/add s a
+oscsend localhost 7774 /world/dumbbell/add s b
+oscsend localhost 7774 /world/dumbbell/add s bar
+oscsend localhost 7774 /world/dumbbell/mass/get
+
+oscsend localhost 7774 /world/gravity fff 0 0 -1
+
+sleep 3
+oscsend localhost 7774 /world/dumbbell/remove s b
+oscsend localhost 7774 /world/b/velocity fff 0 0 0.5
@@ -0,0 +1,52 @@
+#!/bin/sh
+
+# This test file relies on the programs 'oscdump' and 'oscsend' which
+# are available as part of the LibLo distribution.  Currently they are
+# present in the LibLo svn repository, but not yet part of a stable
+# release.
+
+# This script assumes Dimple is already running.
+
+# Disable path mangling in MSYS2
+export MSYS2_ARG_CONV_EXCL="/world"
+
+# Listen on port 7778.  We'll assume this is the only oscdump instance
+# running, and we don't want to run it if it's already running in
+# another terminal.
+if ! ((ps -A 2>/dev/null || ps -W 2>/dev/null || ps aux 2>/dev/null) | grep oscdump >/dev/null 2>&1 ); then (oscdump 7778 &); fi
+
+# A cloud of particles is swirled by a vortex, blown by a moving drag
+# field and stirred by noise, then a radial field pulls a few spheres
+# towards the center.
+oscsend localhost 7774 /world/clear
+oscsend localhost 7774 /world/particles/create sifff dust 200 0 0 0
+oscsend localhost 7774 /world/dust/radius f 0.004
+
+for i in 1 2 3 4; do
+    oscsend localhost 7774 /world/sphere/create sfff s$i -0.1$i 0.05 0
+    oscsend localhost 7774 /world/s$i/radius f 0.01
+done
+
+oscsend localhost 7774 /world/field/create ssfff swirl vortex 0 0 0
+oscsend localhost 7774 /world/swirl/radius f 0.2
+oscsend localhost 7774 /world/swirl/falloff f 2
+oscsend localhost 7774 /world/swirl/strength f 0.05
+
+sleep 2
+oscsend localhost 7774 /world/field/create ss wind drag
+oscsend localhost 7774 /world/wind/velocity fff 0.1 0 0
+oscsend localhost 7774 /world/wind/strength f 0.5
+
+sleep 2
+oscsend localhost 7774 /world/wind/destroy
+oscsend localhost 7774 /world/field/create ss stir noise
+oscsend localhost 7774 /world/stir/frequency f 20
+oscsend localhost 7774 /world/stir/strength f 0.02
+
+sleep 2
+oscsend localhost 7774 /world/swirl/destroy
+oscsend localhost 7774 /world/stir/destroy
+oscsend localhost 7774 /world/field/create ssfff pull radial 0 0 0
+oscsend localhost 7774 /world/pull/radius f 0.3
+oscsend localhost 7774 /world/pull/strength f -0.1
+oscsend localhost 7774 /world/pull/strength/get
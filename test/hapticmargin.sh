@@ -0,0 +1,35 @@
+#!/bin/sh
+
+# This test file relies on the programs 'oscdump' and 'oscsend' which
+# are available as part of the LibLo distribution.  Currently they are
+# present in the LibLo svn repository, but not yet part of a stable
+# release.
+
+# This script assumes Dimple is already running.
+
+# Disable path mangling in MSYS2
+export MSYS2_ARG_CONV_EXCL="/world"
+
+# Listen on port 7778.  We'll assume this is the only oscdump instance
+# running, and we don't want to run it if it's already running in
+# another terminal.
+if ! ((ps -A 2>/dev/null || ps -W 2>/dev/null || ps aux 2>/dev/null) | grep oscdump >/dev/null 2>&1 ); then (oscdump 7778 &); fi
+
+# A large field of spheres, of which only those near the cursor are
+# felt.  Move the cursor through the field to check that nearby
+# spheres are still felt, then check again with culling disabled.
+oscsend localhost 7774 /world/clear
+oscsend localhost 7774 /world/gravity fff 0 0 0
+
+for x in 0 1 2 3 4 5 6 7 8 9; do
+    for y in 0 1 2 3 4 5 6 7 8 9; do
+        oscsend localhost 7774 /world/sphere/create sfff s$x$y -0.$x -0.$y 0
+        oscsend localhost 7774 /world/s$x$y/radius f 0.02
+    done
+done
+
+oscsend localhost 7774 /world/haptics/margin f 0.03
+oscsend localhost 7774 /world/haptics/margin/get
+
+sleep 10
+oscsend localhost 7774 /world/haptics/margin f 0
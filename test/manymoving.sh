@@ -0,0 +1,35 @@
+#!/bin/sh
+
+# This test file relies on the programs 'oscdump' and 'oscsend' which
+# are available as part of the LibLo distribution.  Currently they are
+# present in the LibLo svn repository, but not yet part of a stable
+# release.
+
+# This script assumes Dimple is already running.
+
+# Disable path mangling in MSYS2
+export MSYS2_ARG_CONV_EXCL="/world"
+
+# Listen on port 7778.  We'll assume this is the only oscdump instance
+# running, and we don't want to run it if it's already running in
+# another terminal.
+if ! ((ps -A 2>/dev/null || ps -W 2>/dev/null || ps aux 2>/dev/null) | grep oscdump >/dev/null 2>&1 ); then (oscdump 7778 &); fi
+
+# Many resting blocks and a few moving spheres.  Only the moving
+# spheres need their transforms updated in the haptic loop, so the
+# cursor should stay smooth while touching them.
+oscsend localhost 7774 /world/clear
+oscsend localhost 7774 /world/plane/create sfff floor 0 0 -0.1
+
+for x in 0 1 2 3 4 5 6 7 8 9; do
+    for y in 0 1 2 3 4 5 6 7 8 9; do
+        oscsend localhost 7774 /world/prism/create sfff b$x$y -0.$x -0.$y -0.09
+        oscsend localhost 7774 /world/b$x$y/size fff 0.01 0.01 0.01
+    done
+done
+
+for i in 1 2 3; do
+    oscsend localhost 7774 /world/sphere/create sfff s$i 0.0$i 0.05 0
+    oscsend localhost 7774 /world/s$i/radius f 0.01
+    oscsend localhost 7774 /world/s$i/velocity fff 0.0$i 0 0.1
+done
@@ -0,0 +1,37 @@
+#!/bin/sh
+
+# This test file relies on the programs 'oscdump' and 'oscsend' which
+# are available as part of the LibLo distribution.  Currently they are
+# present in the LibLo svn repository, but not yet part of a stable
+# release.
+
+# This script assumes Dimple is already running.
+
+# Disable path mangling in MSYS2
+export MSYS2_ARG_CONV_EXCL="/world"
+
+# Listen on port 7778.  We'll assume this is the only oscdump instance
+# running, and we don't want to run it if it's already running in
+# another terminal.
+if ! ((ps -A 2>/dev/null || ps -W 2>/dev/null || ps aux 2>/dev/null) | grep oscdump >/dev/null 2>&1 ); then (oscdump 7778 &); fi
+
+# Two meshes dropped onto a floor: one colliding with its convex hull
+# (the default) and one with its triangles.
+CYL=$(readlink -f $(dirname "$0")/cylinder.3ds)
+
+oscsend localhost 7774 /world/clear
+oscsend localhost 7774 /world/prism/create sfff floor 0 0 -0.2
+oscsend localhost 7774 /world/floor/size fff 1 1 0.01
+oscsend localhost 7774 /world/floor/color fff 0.8 0.9 0.1
+oscsend localhost 7774 /world/fixed/create sss c1 floor world
+
+oscsend localhost 7774 /world/mesh/create ssfff hull $CYL -0.1 0 0
+oscsend localhost 7774 /world/hull/size fff 0.1 0.1 0.1
+oscsend localhost 7774 /world/hull/color fff 1 0.2 0.3
+
+oscsend localhost 7774 /world/mesh/create ssfff tri $CYL 0.1 0 0
+oscsend localhost 7774 /world/tri/convex i 0
+oscsend localhost 7774 /world/tri/size fff 0.1 0.1 0.1
+oscsend localhost 7774 /world/tri/color fff 0.2 0.3 1
+
+oscsend localhost 7774 /world/gravity fff 0 0 -1
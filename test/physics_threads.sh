@@ -0,0 +1,38 @@
+#!/bin/sh
+
+# This test file relies on the programs 'oscdump' and 'oscsend' which
+# are available as part of the LibLo distribution.  Currently they are
+# present in the LibLo svn repository, but not yet part of a stable
+# release.
+
+# This script assumes Dimple is already running.
+
+# Builds a large pile of spheres and reports the average physics step
+# time for each thread count up to the given maximum.
+
+# Disable path mangling in MSYS2
+export MSYS2_ARG_CONV_EXCL="/world"
+
+# Listen on port 7778.  We'll assume this is the only oscdump instance
+# running, and we don't want to run it if it's already running in
+# another terminal.
+if ! ((ps -A 2>/dev/null || ps -W 2>/dev/null || ps aux 2>/dev/null) | grep oscdump >/dev/null 2>&1 ); then (oscdump 7778 &); fi
+
+if [ x$1 = x ]; then
+    THREADS=4
+else
+    THREADS=$1
+fi
+
+# Separate groups of spheres form independent islands which can be
+# stepped in parallel.
+$(dirname $0)/manyspheres.sh 12
+
+for t in $(seq 1 $THREADS); do
+    oscsend localhost 7774 /world/physics/threads i $t
+    sleep 5
+    echo "threads: $t"
+    oscsend localhost 7774 /world/physics/step_time/get
+done
+
+oscsend localhost 7774 /world/physics/threads i 1
@@ -0,0 +1,42 @@
+#!/bin/sh
+
+# This test file relies on the programs 'oscdump' and 'oscsend' which
+# are available as part of the LibLo distribution.  Currently they are
+# present in the LibLo svn repository, but not yet part of a stable
+# release.
+
+# This script assumes Dimple is already running.
+
+# Disable path mangling in MSYS2
+export MSYS2_ARG_CONV_EXCL="/world"
+
+# Listen on port 7778.  We'll assume this is the only oscdump instance
+# running, and we don't want to run it if it's already running in
+# another terminal.
+if ! ((ps -A 2>/dev/null || ps -W 2>/dev/null || ps aux 2>/dev/null) | grep oscdump >/dev/null 2>&1 ); then (oscdump 7778 &); fi
+
+# A capsule and a cylinder rolling down a bumpy heightfield onto a
+# floor plane.
+oscsend localhost 7774 /world/clear
+oscsend localhost 7774 /world/plane/create sfff floor 0 0 -0.3
+oscsend localhost 7774 /world/floor/color fff 0.8 0.9 0.1
+
+oscsend localhost 7774 /world/heightfield/create siifff hill 5 5 0 0 -0.2
+oscsend localhost 7774 /world/hill/size fff 0.5 0.5 0.1
+oscsend localhost 7774 /world/hill/height iif 2 2 1
+oscsend localhost 7774 /world/hill/height iif 1 2 0.5
+oscsend localhost 7774 /world/hill/height iif 3 2 0.5
+oscsend localhost 7774 /world/hill/height iif 2 1 0.5
+oscsend localhost 7774 /world/hill/height iif 2 3 0.5
+
+oscsend localhost 7774 /world/capsule/create sfff c 0.05 0 0.1
+oscsend localhost 7774 /world/c/radius f 0.02
+oscsend localhost 7774 /world/c/length f 0.06
+oscsend localhost 7774 /world/c/color fff 0.9 0.2 0.2
+
+oscsend localhost 7774 /world/cylinder/create sfff d -0.05 0 0.1
+oscsend localhost 7774 /world/d/radius f 0.03
+oscsend localhost 7774 /world/d/length f 0.02
+oscsend localhost 7774 /world/d/color fff 0.2 0.2 0.9
+
+oscsend localhost 7774 /world/gravity fff 0 0 -1
@@ -0,0 +1,37 @@
+#!/bin/sh
+
+# This test file relies on the programs 'oscdump' and 'oscsend' which
+# are available as part of the LibLo distribution.  Currently they are
+# present in the LibLo svn repository, but not yet part of a stable
+# release.
+
+# This script assumes Dimple is already running.
+
+# Disable path mangling in MSYS2
+export MSYS2_ARG_CONV_EXCL="/world"
+
+# Listen on port 7778.  We'll assume this is the only oscdump instance
+# running, and we don't want to run it if it's already running in
+# another terminal.
+if ! ((ps -A 2>/dev/null || ps -W 2>/dev/null || ps aux 2>/dev/null) | grep oscdump >/dev/null 2>&1 ); then (oscdump 7778 &); fi
+
+# A row of spheres above a floor, queried by ray, by region and by
+# distance.  Replies are printed by oscdump.
+oscsend localhost 7774 /world/clear
+oscsend localhost 7774 /world/plane/create sfff floor 0 0 -0.3
+
+for i in 0 1 2 3 4; do
+    oscsend localhost 7774 /world/sphere/create sfff s$i -0.$i 0 0
+    oscsend localhost 7774 /world/s$i/radius f 0.02
+done
+
+# Should hit s0 from the right, then the floor from above.
+oscsend localhost 7774 /world/query/raycast ffffff 0.5 0 0 -1 0 0
+oscsend localhost 7774 /world/query/raycast ffffff 0.5 0.5 0 0 0 -1
+
+# Should find s1 and s2.
+oscsend localhost 7774 /world/query/sphere ffff -0.15 0 0 0.04
+
+# Should find s3, s4 and s2, then nothing within a short ray.
+oscsend localhost 7774 /world/query/nearest fffi -0.32 0 0 3
+oscsend localhost 7774 /world/query/raycast fffffff 0.5 0 0 -1 0 0 0.1
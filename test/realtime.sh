@@ -0,0 +1,36 @@
+#!/bin/sh
+
+# This test file relies on the programs 'oscdump' and 'oscsend' which
+# are available as part of the LibLo distribution.  Currently they are
+# present in the LibLo svn repository, but not yet part of a stable
+# release.
+
+# This script assumes Dimple is already running.
+
+# Disable path mangling in MSYS2
+export MSYS2_ARG_CONV_EXCL="/world"
+
+# Listen on port 7778.  We'll assume this is the only oscdump instance
+# running, and we don't want to run it if it's already running in
+# another terminal.
+if ! ((ps -A 2>/dev/null || ps -W 2>/dev/null || ps aux 2>/dev/null) | grep oscdump >/dev/null 2>&1 ); then (oscdump 7778 &); fi
+
+# Give the haptics thread the highest priority and its own CPU, and
+# physics a lower round-robin priority, while a scene is running.
+# Without privileges, the errors should be printed and the
+# simulations should continue at normal priority.
+oscsend localhost 7774 /world/clear
+oscsend localhost 7774 /world/sphere/create sfff s1 0 0 0
+oscsend localhost 7774 /world/s1/radius f 0.05
+
+oscsend localhost 7774 /world/thread/lock_memory
+oscsend localhost 7774 /world/thread/priority si haptics 80
+oscsend localhost 7774 /world/thread/priority sis physics 70 rr
+oscsend localhost 7774 /world/thread/cpus ss haptics 1
+oscsend localhost 7774 /world/thread/cpus ss physics 0
+
+sleep 10
+oscsend localhost 7774 /world/thread/priority si haptics 0
+oscsend localhost 7774 /world/thread/priority si physics 0
+oscsend localhost 7774 /world/thread/cpus ss haptics ""
+oscsend localhost 7774 /world/thread/cpus ss physics ""
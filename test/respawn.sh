@@ -0,0 +1,37 @@
+#!/bin/sh
+
+# This test file relies on the programs 'oscdump' and 'oscsend' which
+# are available as part of the LibLo distribution.  Currently they are
+# present in the LibLo svn repository, but not yet part of a stable
+# release.
+
+# This script assumes Dimple is already running.
+
+# Disable path mangling in MSYS2
+export MSYS2_ARG_CONV_EXCL="/world"
+
+# Listen on port 7778.  We'll assume this is the only oscdump instance
+# running, and we don't want to run it if it's already running in
+# another terminal.
+if ! ((ps -A 2>/dev/null || ps -W 2>/dev/null || ps aux 2>/dev/null) | grep oscdump >/dev/null 2>&1 ); then (oscdump 7778 &); fi
+
+# Notes falling onto a floor, each destroyed and created again under
+# the same name, sometimes within a single step.  Destroying a
+# constraint and then its object must also be safe.
+oscsend localhost 7774 /world/clear
+oscsend localhost 7774 /world/plane/create sfff floor 0 0 -0.3
+oscsend localhost 7774 /world/gravity fff 0 0 -1
+
+for i in $(seq 1 200); do
+    n=note$((i % 8))
+    oscsend localhost 7774 /world/$n/destroy
+    oscsend localhost 7774 /world/sphere/create sfff $n 0.$((i % 8)) 0 0.1
+    oscsend localhost 7774 /world/$n/radius f 0.01
+done
+
+oscsend localhost 7774 /world/sphere/create sfff a 0 0 0
+oscsend localhost 7774 /world/sphere/create sfff b 0.1 0 0
+oscsend localhost 7774 /world/hinge/create sssffffff h a b 0.05 0 0 0 1 0
+oscsend localhost 7774 /world/h/destroy
+oscsend localhost 7774 /world/a/destroy
+oscsend localhost 7774 /world/b/destroy
@@ -0,0 +1,40 @@
+#!/bin/sh
+
+# This test file relies on the programs 'oscdump' and 'oscsend' which
+# are available as part of the LibLo distribution.  Currently they are
+# present in the LibLo svn repository, but not yet part of a stable
+# release.
+
+# This script assumes Dimple is already running.
+
+# Disable path mangling in MSYS2
+export MSYS2_ARG_CONV_EXCL="/world"
+
+# Listen on port 7778.  We'll assume this is the only oscdump instance
+# running, and we don't want to run it if it's already running in
+# another terminal.
+if ! ((ps -A 2>/dev/null || ps -W 2>/dev/null || ps aux 2>/dev/null) | grep oscdump >/dev/null 2>&1 ); then (oscdump 7778 &); fi
+
+# Create fifty copies of the same mesh and texture.  The file should
+# be loaded once, and after the first copy each should appear almost
+# at once.  Half are then resized to a common size, which is scaled
+# once and shared by all of them.
+CYL=$(readlink -f $(dirname "$0")/cylinder.3ds)
+MARBLE=$(readlink -f $(dirname "$0")/../textures/marble.png)
+
+oscsend localhost 7774 /world/clear
+oscsend localhost 7774 /world/gravity fff 0 0 0
+
+for x in 0 1 2 3 4 5 6 7 8 9; do
+    for y in 0 1 2 3 4; do
+        oscsend localhost 7774 /world/mesh/create ssfff m$x$y $CYL -0.$x 0.$y 0
+        oscsend localhost 7774 /world/m$x$y/texture/image s $MARBLE
+    done
+done
+
+sleep 2
+for x in 0 2 4 6 8; do
+    for y in 0 1 2 3 4; do
+        oscsend localhost 7774 /world/m$x$y/size fff 0.05 0.05 0.1
+    done
+done
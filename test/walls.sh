@@ -0,0 +1,36 @@
+#!/bin/sh
+
+# This test file relies on the programs 'oscdump' and 'oscsend' which
+# are available as part of the LibLo distribution.  Currently they are
+# present in the LibLo svn repository, but not yet part of a stable
+# release.
+
+# This script assumes Dimple is already running.
+
+# Disable path mangling in MSYS2
+export MSYS2_ARG_CONV_EXCL="/world"
+
+# Listen on port 7778.  We'll assume this is the only oscdump instance
+# running, and we don't want to run it if it's already running in
+# another terminal.
+if ! ((ps -A 2>/dev/null || ps -W 2>/dev/null || ps aux 2>/dev/null) | grep oscdump >/dev/null 2>&1 ); then (oscdump 7778 &); fi
+
+# A maze of fixed walls and loose blocks, to feel many prisms at once
+# without overrunning the haptic loop.
+oscsend localhost 7774 /world/clear
+oscsend localhost 7774 /world/gravity fff 0 0 0
+
+for i in 0 1 2 3 4 5 6 7; do
+    oscsend localhost 7774 /world/prism/create sfff wallx$i -0.08 -0.0$i 0
+    oscsend localhost 7774 /world/wallx$i/size fff 0.005 0.008 0.04
+    oscsend localhost 7774 /world/fixed/create sss fixx$i wallx$i world
+    oscsend localhost 7774 /world/prism/create sfff wally$i 0.0$i 0.08 0
+    oscsend localhost 7774 /world/wally$i/size fff 0.008 0.005 0.04
+    oscsend localhost 7774 /world/fixed/create sss fixy$i wally$i world
+    oscsend localhost 7774 /world/prism/create sfff block$i 0.0$i 0 0
+    oscsend localhost 7774 /world/block$i/size fff 0.006 0.006 0.006
+    oscsend localhost 7774 /world/block$i/color fff 0.9 0.$i 0.2
+done
+
+sleep 1
+oscsend localhost 7774 /world/block0/size fff 0.02 0.01 0.005